@@ -120,4 +120,29 @@ static inline int clock_nanosleep(clockid_t clock_id, int flags,
 
 #include <semaphore.h>
 sem_t *apple_sem(int init);
+
+//
+// MacOS does not have sem_timedwait, it is emulated by polling
+// with sem_trywait in steps of 1 msec until the (CLOCK_REALTIME)
+// deadline has passed.
+//
+#include <errno.h>
+
+static inline int sem_timedwait(sem_t *sem, const struct timespec *abstime) {
+  const struct timespec pause = { 0, 1000000 };
+  struct timespec now;
+
+  while (sem_trywait(sem) != 0) {
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if (now.tv_sec > abstime->tv_sec || (now.tv_sec == abstime->tv_sec && now.tv_nsec >= abstime->tv_nsec)) {
+      errno = ETIMEDOUT;
+      return -1;
+    }
+
+    nanosleep(&pause, NULL);
+  }
+
+  return 0;
+}
 #endif // __APPLE__
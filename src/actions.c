@@ -53,6 +53,7 @@
 #include "message.h"
 #include "dxcluster.h"
 #include "rx_panadapter.h"
+#include "waterfall.h"
 
 //
 // The "short button text" (button_str) needs to be present in ALL cases, and must be different
@@ -2200,11 +2201,13 @@ int process_action(void *data) {
   case WATERFALL_HIGH:
     value = KnobOrWheel(a, active_receiver->waterfall_high, -100.0, 0.0, 1.0);
     active_receiver->waterfall_high = (int)value;
+    waterfall_regenerate(active_receiver);
     break;
 
   case WATERFALL_LOW:
     value = KnobOrWheel(a, active_receiver->waterfall_low, -150.0, -50.0, 1.0);
     active_receiver->waterfall_low = (int)value;
+    waterfall_regenerate(active_receiver);
     break;
 
   case XIT:
@@ -530,28 +530,11 @@ int cw_audio_write(RECEIVER *rx, float sample) {
 }
 
 //
-// if rx == active_receiver and while transmitting, DO NOTHING
-// since cw_audio_write may be active
+// Put one stereo sample into the local audio buffer, and send the buffer
+// to the device if it is full. Must be called with rx->local_audio_mutex locked.
 //
-
-int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
+static int audio_put_sample(RECEIVER *rx, float left_sample, float right_sample) {
   snd_pcm_sframes_t delay;
-  int txmode = vfo_get_tx_mode();
-
-  //
-  // We have to stop the stream here if a CW side tone may occur.
-  // This might cause underflows, but we cannot use audio_write
-  // and cw_audio_write simultaneously on the same device.
-  // Instead, the side tone version will take over.
-  // If *not* doing CW, the stream continues because we might wish
-  // to listen to this rx while transmitting.
-  //
-  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
-    return 0;
-  }
-
-  // lock AFTER checking the "quick return" condition but BEFORE checking the pointers
-  g_mutex_lock(&rx->local_audio_mutex);
 
   if (rx->playback_handle != NULL && rx->local_audio_buffer != NULL) {
     switch (rx->local_audio_format) {
@@ -639,7 +622,6 @@ int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
             if ((rc = snd_pcm_prepare (rx->playback_handle)) < 0) {
               t_print("%s: cannot prepare audio interface for use %ld (%s)\n", __FUNCTION__, rc, snd_strerror (rc));
               rx->local_audio_buffer_offset = 0;
-              g_mutex_unlock(&rx->local_audio_mutex);
               return rc;
             }
 
@@ -658,10 +640,66 @@ int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
     }
   }
 
-  g_mutex_unlock(&rx->local_audio_mutex);
   return 0;
 }
 
+//
+// if rx == active_receiver and while transmitting, DO NOTHING
+// since cw_audio_write may be active
+//
+
+int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
+  int txmode = vfo_get_tx_mode();
+
+  //
+  // We have to stop the stream here if a CW side tone may occur.
+  // This might cause underflows, but we cannot use audio_write
+  // and cw_audio_write simultaneously on the same device.
+  // Instead, the side tone version will take over.
+  // If *not* doing CW, the stream continues because we might wish
+  // to listen to this rx while transmitting.
+  //
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    return 0;
+  }
+
+  // lock AFTER checking the "quick return" condition but BEFORE checking the pointers
+  g_mutex_lock(&rx->local_audio_mutex);
+
+  int rc = audio_put_sample(rx, left_sample, right_sample);
+  g_mutex_unlock(&rx->local_audio_mutex);
+  return rc;
+}
+
+//
+// Block version of audio_write: lr contains frames interleaved
+// stereo samples. The mutex is only taken once per block.
+//
+int audio_write_block(RECEIVER *rx, const float *lr, int frames) {
+  int txmode = vfo_get_tx_mode();
+
+  // see audio_write() for this "quick return" condition
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    return 0;
+  }
+
+  g_mutex_lock(&rx->local_audio_mutex);
+  int rc = 0;
+
+  //
+  // As with audio_write() for each sample, an error does not stop the
+  // block: all samples are written, and the first error code is returned.
+  //
+  for (int i = 0; i < frames; i++) {
+    int err = audio_put_sample(rx, lr[2 * i], lr[2 * i + 1]);
+
+    if (rc == 0) { rc = err; }
+  }
+
+  g_mutex_unlock(&rx->local_audio_mutex);
+  return rc;
+}
+
 static void *mic_read_thread(gpointer arg) {
   int rc;
   const float *float_buffer;
@@ -0,0 +1,346 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ *
+ * CAT load test for the rigctl TCP server.
+ *
+ * This program connects to a running deskHPSDR and polls it with
+ * read-only CAT queries (as loggers and SO2R controllers do), measuring
+ * the round-trip time of each query. Optionally, a second connection
+ * keeps the GUI busy by continuously re-tuning VFO-B, so that each of
+ * its commands causes work (and redraws) in the GTK main loop.
+ *
+ * Usage: catload [-h host] [-p port] [-n queries] [-r rate] [-b rate] [-q "FA;IF;SM0;"]
+ *
+ *  -h host      host running deskHPSDR (default 127.0.0.1)
+ *  -p port      rigctl TCP port (default 19090)
+ *  -n queries   number of queries to send (default 2000)
+ *  -r rate      queries per second, 0 means as fast as possible (default 100)
+ *  -b rate      VFO-B tuning commands per second on the "busy" connection (default 0 = off)
+ *  -q list      queries to cycle through (default "FA;FB;IF;MD;SM0;")
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+static const char *host = "127.0.0.1";
+static int port = 19090;
+static volatile int busy_running = 0;
+static int busy_rate = 0;
+static long busy_count = 0;
+
+static double now_usec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1.0E6 * ts.tv_sec + 1.0E-3 * ts.tv_nsec;
+}
+
+static int cat_connect() {
+  struct addrinfo hints, *res;
+  char service[16];
+  int fd;
+  int on = 1;
+  struct timeval tv = { 1, 0 };
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(service, sizeof(service), "%d", port);
+
+  if (getaddrinfo(host, service, &hints, &res) != 0) {
+    fprintf(stderr, "catload: cannot resolve %s\n", host);
+    return -1;
+  }
+
+  fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+
+  if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+    perror("catload: connect");
+
+    if (fd >= 0) { close(fd); }
+
+    freeaddrinfo(res);
+    return -1;
+  }
+
+  freeaddrinfo(res);
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *)&on, sizeof(on));
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+static int cat_send(int fd, const char *cmd) {
+  size_t len = strlen(cmd);
+
+  while (len > 0) {
+    ssize_t rc = write(fd, cmd, len);
+
+    if (rc < 0) {
+      if (errno == EINTR) { continue; }
+
+      return -1;
+    }
+
+    len -= rc;
+    cmd += rc;
+  }
+
+  return 0;
+}
+
+//
+// Read one response (terminated by ';'). Returns the length, or -1
+// upon time-out or error.
+//
+static int cat_recv(int fd, char *buf, int size) {
+  int n = 0;
+
+  while (n < size - 1) {
+    ssize_t rc = read(fd, buf + n, 1);
+
+    if (rc <= 0) {
+      if (rc < 0 && errno == EINTR) { continue; }
+
+      return -1;
+    }
+
+    if (buf[n++] == ';') { break; }
+  }
+
+  buf[n] = 0;
+  return n;
+}
+
+//
+// The "busy" connection re-tunes VFO-B in 1 kHz steps back and forth,
+// each command makes deskHPSDR update the VFO bar and the panadapter.
+// The initial VFO-B frequency is restored at the end.
+//
+static void *busy_thread(void *data) {
+  int fd = cat_connect();
+  char buf[64];
+  long long f0;
+  double next;
+  int step = 0;
+
+  if (fd < 0) { return NULL; }
+
+  if (cat_send(fd, "FB;") < 0 || cat_recv(fd, buf, sizeof(buf)) < 13) {
+    fprintf(stderr, "catload: cannot read VFO-B frequency\n");
+    close(fd);
+    return NULL;
+  }
+
+  f0 = atoll(buf + 2);
+  next = now_usec();
+
+  while (busy_running) {
+    snprintf(buf, sizeof(buf), "FB%011lld;", f0 + 1000LL * (step & 15));
+    step++;
+
+    if (cat_send(fd, buf) < 0) { break; }
+
+    busy_count++;
+    next += 1.0E6 / busy_rate;
+    double wait = next - now_usec();
+
+    if (wait > 0) { usleep((useconds_t) wait); }
+  }
+
+  snprintf(buf, sizeof(buf), "FB%011lld;", f0);
+  cat_send(fd, buf);
+  usleep(100000);
+  close(fd);
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+  int count = 2000;
+  int rate = 100;
+  const char *queries = "FA;FB;IF;MD;SM0;";
+  char *list[64];
+  int nlist = 0;
+  char *qcopy;
+  char *p;
+  int opt;
+  int fd;
+  int timeouts = 0;
+  int errors = 0;
+  int done = 0;
+  double *rtt;
+  double sum = 0.0;
+  double next;
+  double start;
+  pthread_t busy_id;
+
+  while ((opt = getopt(argc, argv, "h:p:n:r:b:q:")) != -1) {
+    switch (opt) {
+    case 'h':
+      host = optarg;
+      break;
+
+    case 'p':
+      port = atoi(optarg);
+      break;
+
+    case 'n':
+      count = atoi(optarg);
+      break;
+
+    case 'r':
+      rate = atoi(optarg);
+      break;
+
+    case 'b':
+      busy_rate = atoi(optarg);
+      break;
+
+    case 'q':
+      queries = optarg;
+      break;
+
+    default:
+      fprintf(stderr, "Usage: %s [-h host] [-p port] [-n queries] [-r rate] [-b busyrate] [-q \"FA;IF;SM0;\"]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (count <= 0) { count = 1; }
+
+  //
+  // Split the query list into single commands, each ending with ';'
+  //
+  qcopy = strdup(queries);
+  p = qcopy;
+
+  while (*p && nlist < 64) {
+    char *q = strchr(p, ';');
+
+    if (q == NULL) { break; }
+
+    list[nlist] = strndup(p, q - p + 1);
+    nlist++;
+    p = q + 1;
+  }
+
+  free(qcopy);
+
+  if (nlist == 0) {
+    fprintf(stderr, "catload: no queries given\n");
+    return 1;
+  }
+
+  fd = cat_connect();
+
+  if (fd < 0) { return 1; }
+
+  if (busy_rate > 0) {
+    busy_running = 1;
+
+    if (pthread_create(&busy_id, NULL, busy_thread, NULL) != 0) {
+      busy_running = 0;
+    }
+
+    usleep(500000);  // let the GUI get busy
+  }
+
+  rtt = malloc(count * sizeof(double));
+  start = next = now_usec();
+
+  for (int i = 0; i < count; i++) {
+    char buf[256];
+    const char *cmd = list[i % nlist];
+    double t0 = now_usec();
+
+    if (cat_send(fd, cmd) < 0) {
+      fprintf(stderr, "catload: send failed\n");
+      break;
+    }
+
+    if (cat_recv(fd, buf, sizeof(buf)) < 0) {
+      timeouts++;
+      continue;
+    }
+
+    rtt[done] = now_usec() - t0;
+    sum += rtt[done];
+    done++;
+
+    if (!strcmp(buf, "?;") || strncmp(buf, cmd, 2)) {
+      errors++;
+    }
+
+    if (rate > 0) {
+      next += 1.0E6 / rate;
+      double wait = next - now_usec();
+
+      if (wait > 0) { usleep((useconds_t) wait); }
+    }
+  }
+
+  double elapsed = now_usec() - start;
+
+  if (busy_rate > 0 && busy_running) {
+    busy_running = 0;
+    pthread_join(busy_id, NULL);
+  }
+
+  close(fd);
+
+  if (done > 0) {
+    qsort(rtt, done, sizeof(double), compare_double);
+    printf("queries=%d answered=%d timeouts=%d errors=%d in %.2f sec\n", count, done, timeouts, errors,
+           1.0E-6 * elapsed);
+
+    if (busy_rate > 0) {
+      printf("busy connection: %ld VFO-B commands (%d/sec)\n", busy_count, busy_rate);
+    }
+
+    printf("RTT usec: min=%.0f avg=%.0f p50=%.0f p90=%.0f p99=%.0f max=%.0f\n",
+           rtt[0], sum / done, rtt[done / 2], rtt[(done * 9) / 10], rtt[(done * 99) / 100], rtt[done - 1]);
+  } else {
+    printf("queries=%d: no answers (timeouts=%d)\n", count, timeouts);
+  }
+
+  free(rtt);
+
+  for (int i = 0; i < nlist; i++) {
+    free(list[i]);
+  }
+
+  return (done > 0) ? 0 : 1;
+}
@@ -32,6 +32,8 @@
 #include "old_protocol.h"
 #include "radio.h"
 #include "ext.h"
+#include "waterfall.h"
+#include "message.h"
 
 enum _containers {
   GENERAL_CONTAINER = 1,
@@ -232,10 +234,12 @@ static void panadapter_autoscale_toggle_cb(GtkWidget *widget, gpointer data) {
 
 static void waterfall_high_value_changed_cb(GtkWidget *widget, gpointer data) {
   active_receiver->waterfall_high = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(widget));
+  waterfall_regenerate(active_receiver);
 }
 
 static void waterfall_low_value_changed_cb(GtkWidget *widget, gpointer data) {
   active_receiver->waterfall_low = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(widget));
+  waterfall_regenerate(active_receiver);
 }
 
 static void waterfall_automatic_cb(GtkWidget *widget, gpointer data) {
@@ -243,6 +247,33 @@ static void waterfall_automatic_cb(GtkWidget *widget, gpointer data) {
   active_receiver->waterfall_automatic = val;
   gtk_widget_set_sensitive(waterfall_high_r, !val);
   gtk_widget_set_sensitive(waterfall_low_r, !val);
+  waterfall_regenerate(active_receiver);
+}
+
+static void history_mb_value_changed_cb(GtkWidget *widget, gpointer data) {
+  RECEIVER *rx = active_receiver;
+  g_mutex_lock(&rx->display_mutex);
+  rx->history_mb = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(widget));
+  spectrum_history_free(rx->history);
+  rx->history = spectrum_history_new(rx->history_mb);
+  g_mutex_unlock(&rx->display_mutex);
+}
+
+//
+// Write the complete spectrum history of the active receiver
+// to a time-stamped file in the working directory
+//
+static void history_save_cb(GtkWidget *widget, gpointer data) {
+  RECEIVER *rx = active_receiver;
+  char filename[128];
+  GDateTime *now = g_date_time_new_now_local();
+  gchar *stamp = g_date_time_format(now, "%Y%m%d_%H%M%S");
+  snprintf(filename, sizeof(filename), "spectrum_rx%d_%s.bin", rx->id + 1, stamp);
+  g_free(stamp);
+  g_date_time_unref(now);
+  g_mutex_lock(&rx->display_mutex);
+  spectrum_history_dump(rx->history, filename, 0, G_MAXINT64);
+  g_mutex_unlock(&rx->display_mutex);
 }
 
 static void display_waterfall_cb(GtkWidget *widget, gpointer data) {
@@ -445,6 +476,23 @@ void display_menu(GtkWidget *parent) {
   gtk_widget_show(waterfall_automatic_b);
   gtk_grid_attach(GTK_GRID(general_grid), waterfall_automatic_b, col, row, 1, 1);
   g_signal_connect(waterfall_automatic_b, "toggled", G_CALLBACK(waterfall_automatic_cb), NULL);
+  row++;
+  col = 0;
+  label = gtk_label_new("Spectrum History (MB):");
+  gtk_widget_set_name (label, "boldlabel");
+  gtk_widget_set_halign(label, GTK_ALIGN_END);
+  gtk_grid_attach(GTK_GRID(general_grid), label, col, row, 1, 1);
+  col++;
+  GtkWidget *history_mb_r = gtk_spin_button_new_with_range(0.0, 256.0, 1.0);
+  gtk_spin_button_set_value(GTK_SPIN_BUTTON(history_mb_r), (double)active_receiver->history_mb);
+  gtk_widget_show(history_mb_r);
+  gtk_grid_attach(GTK_GRID(general_grid), history_mb_r, col, row, 1, 1);
+  g_signal_connect(history_mb_r, "value_changed", G_CALLBACK(history_mb_value_changed_cb), NULL);
+  col++;
+  GtkWidget *history_save_b = gtk_button_new_with_label("Save History");
+  gtk_widget_show(history_save_b);
+  gtk_grid_attach(GTK_GRID(general_grid), history_save_b, col, row, 1, 1);
+  g_signal_connect(history_save_b, "clicked", G_CALLBACK(history_save_cb), NULL);
 
   //--------------------------------------------------------------------------------------------------------------
   if (device == DEVICE_HERMES_LITE2 || device == NEW_DEVICE_HERMES_LITE2) {
@@ -0,0 +1,171 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define IQCONV_X86
+#endif
+#if defined(__aarch64__)
+  #include <arm_neon.h>
+  #define IQCONV_NEON
+#endif
+
+#include "iqconv.h"
+
+//
+// The "obscure" constant 1.1920928955078125E-7 is 1/(2^23)
+//
+#define IQCONV_SCALE 1.1920928955078125E-7
+
+//
+// Scalar version, also used for the tail of the SIMD versions
+//
+static void unpack24_scalar(const unsigned char *src, double *dst, int n) {
+  for (int i = 0; i < n; i++) {
+    int sample;
+    sample  = (int)((signed char) src[0]) << 16;
+    sample |= (int)((((unsigned char)src[1]) << 8) & 0xFF00);
+    sample |= (int)((unsigned char)src[2] & 0xFF);
+    *dst++ = (double)sample * IQCONV_SCALE;
+    src += 3;
+  }
+}
+
+#ifdef IQCONV_X86
+//
+// Move each 3-byte big-endian value into the upper three bytes of
+// a 32-bit lane, then an arithmetic right shift by 8 does the sign
+// extension. A 16-byte load covers four values (12 bytes), so the
+// loop conditions make sure we never read beyond the end of the data.
+//
+__attribute__((target("ssse3")))
+static void unpack24_ssse3(const unsigned char *src, double *dst, int n) {
+  const __m128i shuf = _mm_setr_epi8(-128, 2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9);
+  const __m128d scale = _mm_set1_pd(IQCONV_SCALE);
+  int i = 0;
+
+  for (; i + 6 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+    v = _mm_srai_epi32(_mm_shuffle_epi8(v, shuf), 8);
+    _mm_storeu_pd(dst + i,     _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+    _mm_storeu_pd(dst + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), scale));
+  }
+
+  unpack24_scalar(src + 3 * i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void unpack24_avx2(const unsigned char *src, double *dst, int n) {
+  const __m128i shuf = _mm_setr_epi8(-128, 2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9);
+  const __m256d scale = _mm256_set1_pd(IQCONV_SCALE);
+  int i = 0;
+
+  for (; i + 10 <= n; i += 8) {
+    __m128i v0 = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(src + 3 * i + 12));
+    v0 = _mm_srai_epi32(_mm_shuffle_epi8(v0, shuf), 8);
+    v1 = _mm_srai_epi32(_mm_shuffle_epi8(v1, shuf), 8);
+    _mm256_storeu_pd(dst + i,     _mm256_mul_pd(_mm256_cvtepi32_pd(v0), scale));
+    _mm256_storeu_pd(dst + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(v1), scale));
+  }
+
+  unpack24_ssse3(src + 3 * i, dst + i, n - i);
+}
+#endif
+
+#ifdef IQCONV_NEON
+//
+// vld3q de-interleaves 16 values into MSB, middle and LSB bytes.
+// 24-bit integers are exactly representable as float, so the
+// conversion int32 -> float -> double is exact.
+//
+static inline void neon_store4(int16x4_t hi, uint16x4_t lo, float64x2_t scale, double *dst) {
+  int32x4_t v = vorrq_s32(vshlq_n_s32(vmovl_s16(hi), 16), vreinterpretq_s32_u32(vmovl_u16(lo)));
+  float32x4_t f = vcvtq_f32_s32(v);
+  vst1q_f64(dst,     vmulq_f64(vcvt_f64_f32(vget_low_f32(f)), scale));
+  vst1q_f64(dst + 2, vmulq_f64(vcvt_high_f64_f32(f), scale));
+}
+
+static void unpack24_neon(const unsigned char *src, double *dst, int n) {
+  const float64x2_t scale = vdupq_n_f64(IQCONV_SCALE);
+  int i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    uint8x16x3_t t = vld3q_u8(src + 3 * i);
+    int8x16_t hi = vreinterpretq_s8_u8(t.val[0]);
+    int16x8_t hi_l = vmovl_s8(vget_low_s8(hi));
+    int16x8_t hi_h = vmovl_high_s8(hi);
+    uint16x8_t lo_l = vorrq_u16(vshll_n_u8(vget_low_u8(t.val[1]), 8), vmovl_u8(vget_low_u8(t.val[2])));
+    uint16x8_t lo_h = vorrq_u16(vshll_high_n_u8(t.val[1], 8), vmovl_high_u8(t.val[2]));
+    neon_store4(vget_low_s16(hi_l),  vget_low_u16(lo_l),  scale, dst + i);
+    neon_store4(vget_high_s16(hi_l), vget_high_u16(lo_l), scale, dst + i + 4);
+    neon_store4(vget_low_s16(hi_h),  vget_low_u16(lo_h),  scale, dst + i + 8);
+    neon_store4(vget_high_s16(hi_h), vget_high_u16(lo_h), scale, dst + i + 12);
+  }
+
+  unpack24_scalar(src + 3 * i, dst + i, n - i);
+}
+#endif
+
+//
+// Kernel selection. On x86 this is done at run-time upon first use
+// (a harmless race if two threads do this simultaneously, since
+// both come to the same result), on aarch64 NEON is always there.
+//
+typedef void (*unpack24_fn)(const unsigned char *, double *, int);
+
+static unpack24_fn unpack24_kernel = NULL;
+static const char *unpack24_name = "scalar";
+
+static unpack24_fn unpack24_select() {
+#ifdef IQCONV_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    unpack24_name = "AVX2";
+    return unpack24_avx2;
+  }
+
+  if (__builtin_cpu_supports("ssse3")) {
+    unpack24_name = "SSSE3";
+    return unpack24_ssse3;
+  }
+
+#endif
+#ifdef IQCONV_NEON
+  unpack24_name = "NEON";
+  return unpack24_neon;
+#endif
+  return unpack24_scalar;
+}
+
+void iqconv_unpack24(const unsigned char *src, double *dst, int n) {
+  if (unpack24_kernel == NULL) {
+    unpack24_kernel = unpack24_select();
+  }
+
+  unpack24_kernel(src, dst, n);
+}
+
+const char *iqconv_kernel_name() {
+  if (unpack24_kernel == NULL) {
+    unpack24_kernel = unpack24_select();
+  }
+
+  return unpack24_name;
+}
@@ -0,0 +1,36 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _IQCONV_H
+#define _IQCONV_H
+
+//
+// Sample conversion kernels shared by the protocol modules.
+//
+// iqconv_unpack24 converts n consecutive 24-bit big-endian signed
+// integers (as they arrive from the radio) into doubles in the
+// range [-1.0, 1.0), that is, scaled with 1/(2^23).
+// There are SIMD versions (SSSE3/AVX2 on x86, NEON on aarch64) and
+// a scalar fallback. On x86 the kernel is chosen at run time, upon
+// first use, from the CPU features (__builtin_cpu_supports); on
+// aarch64 NEON is always used. iqconv_kernel_name reports the choice.
+//
+extern void iqconv_unpack24(const unsigned char *src, double *dst, int n);
+extern const char *iqconv_kernel_name(void);
+
+#endif
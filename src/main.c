@@ -184,8 +184,12 @@ static void* wisdom_thread(void *arg) {
   if (wdsp_subversion < 26) {
     WDSPwisdom ((char *)arg);
   } else {
-    if (WDSPwisdom ((char *)arg)) {
-      t_print("WDSP wisdom file has been rebuilt.\n");
+    //
+    // If there is no wisdom yet, WDSP starts with FFTW_ESTIMATE plans
+    // and builds the wisdom in the background, so we need not wait
+    //
+    if (WDSPwisdom_tiered ((char *)arg)) {
+      t_print("WDSP wisdom is being built in the background.\n");
     } else {
       t_print("Re-using existing WDSP wisdom file.\n");
     }
@@ -196,6 +200,45 @@ static void* wisdom_thread(void *arg) {
   return NULL;
 }
 
+#ifndef EXTNR
+//
+// Once WDSP has completed the wisdom, the analyzers are re-planned
+// such that they use it (the filters are refined by WDSP itself).
+//
+static gboolean wisdom_refined_cb(gpointer data) {
+  if (WDSPwisdom_refining()) {
+    return G_SOURCE_CONTINUE;
+  }
+
+  t_print("%s: %s\n", __FUNCTION__, wisdom_get_status());
+
+  for (int i = 0; i < receivers; i++) {
+    RECEIVER *rx = receiver[i];
+
+    if (rx == NULL) { continue; }
+
+    g_mutex_lock(&rx->mutex);
+    rx_set_analyzer(rx);
+    g_mutex_unlock(&rx->mutex);
+  }
+
+  if (can_transmit && transmitter != NULL) {
+    RECEIVER *rx = receiver[PS_RX_FEEDBACK];
+    g_mutex_lock(&transmitter->display_mutex);
+    tx_set_analyzer(transmitter);
+    g_mutex_unlock(&transmitter->display_mutex);
+
+    if (rx != NULL && (protocol == ORIGINAL_PROTOCOL || protocol == NEW_PROTOCOL)) {
+      g_mutex_lock(&rx->mutex);
+      rx_set_analyzer(rx);
+      g_mutex_unlock(&rx->mutex);
+    }
+  }
+
+  return G_SOURCE_REMOVE;
+}
+#endif
+
 const char* get_current_gtk_theme(void) {
   GtkSettings *settings = gtk_settings_get_default();
   gchar *theme_name = NULL;
@@ -739,6 +782,13 @@ static int init(void *data) {
     status_text(text);
   }
 
+#ifndef EXTNR
+
+  if (WDSPwisdom_refining()) {
+    g_timeout_add(2000, wisdom_refined_cb, NULL);
+  }
+
+#endif
   //
   // When widsom plans are complete, start discovery process
   //
@@ -19,6 +19,10 @@
 *
 */
 
+#ifdef __linux__
+  #define _GNU_SOURCE  // needed for recvmmsg()
+#endif
+
 #include <gtk/gtk.h>
 
 #include <errno.h>
@@ -41,6 +45,7 @@
 #include <math.h>
 #include <sys/select.h>
 #include <signal.h>
+#include <stdatomic.h>
 
 #include "main.h"
 #include "alex.h"
@@ -60,6 +65,7 @@
 #include "iambic.h"
 #include "rigctl.h"
 #include "message.h"
+#include "iqconv.h"
 
 #ifdef SATURN
   #include "saturnmain.h"
@@ -202,40 +208,138 @@ static pthread_mutex_t send_rxaudio_mutex   = PTHREAD_MUTEX_INITIALIZER;
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// PEDESTRIAN BUFFER MANAGEMENT
+// NETWORK BUFFER POOL
 //
 ////////////////////////////////////////////////////////////////////////////
 //
 // Instead of allocating and free-ing (malloc/free) the network buffers
-// at a very high rate, we do it the "pedestrian" way, which may
-// alleviate the system load a little.
+// at a very high rate, we allocate a fixed pool of (cache-aligned)
+// network buffers *once*.
+//
+// The free buffers are kept in a lock-free stack of buffer indices.
+// Buffers are only taken from the stack in new_protocol_thread(), but
+// they are returned from many threads (iq_thread, mic_line_thread,
+// high_priority_thread, and new_protocol_thread itself). Since there
+// is only a single consumer, a simple CAS loop on the stack head is
+// sufficient (no ABA problem: an index on the stack cannot be popped
+// and re-pushed behind the back of the only thread that pops).
 //
-// Therefore we allocate a pool of network buffers *once*, make
-// them a linked list, and simply maintain a "free" flag.
+// If the pool runs dry, the packet is received into a spare buffer
+// and dropped. The number of such "misses" and the maximum number
+// of buffers in use at a time are recorded for statistics, so the
+// pool size can be adjusted if necessary.
 //
-// This ONLY applies to the network buffers filled with data in
-// new_protocol_thread(), so this need not be thread-safe.
+// In XDMA mode (SATURN), the buffers come from saturnmain.c, and are
+// released by simply setting the "free" flag.
 //
 ////////////////////////////////////////////////////////////////////////////
 
-//
-// number of buffers allocated (for statistics)
-//
-static int num_buf = 0;
+#define P2_NUM_BUFFERS 2048
 
-//
-// head of buffer list
-//
-static mybuffer *buflist = NULL;
+static mybuffer *pool = NULL;
+static mybuffer pool_spare;
+static int pool_next[P2_NUM_BUFFERS];
+static _Alignas(64) atomic_int pool_head = -1;
+static _Alignas(64) atomic_int pool_inuse;
+static int pool_highwater = 0;
+static atomic_long pool_misses;
+
+static void release_my_buffer(mybuffer *mybuf) {
+  mybuf->free = 1;
+
+  if (mybuf >= pool && mybuf < pool + P2_NUM_BUFFERS) {
+    int i = (int)(mybuf - pool);
+    int head = atomic_load_explicit(&pool_head, memory_order_relaxed);
+
+    do {
+      pool_next[i] = head;
+    } while (!atomic_compare_exchange_weak_explicit(&pool_head, &head, i,
+             memory_order_release, memory_order_relaxed));
+
+    atomic_fetch_sub_explicit(&pool_inuse, 1, memory_order_relaxed);
+  }
+}
+
+static void init_my_buffers() {
+  if (pool != NULL) { return; }
+
+  if (posix_memalign((void **)&pool, 64, P2_NUM_BUFFERS * sizeof(mybuffer)) != 0) {
+    t_print("%s: could not allocate network buffers\n", __FUNCTION__);
+    g_idle_add(fatal_error, "FATAL: P2 buffer allocation failed");
+    pool = NULL;
+    return;
+  }
+
+  atomic_store(&pool_inuse, P2_NUM_BUFFERS);
+
+  for (int i = 0; i < P2_NUM_BUFFERS; i++) {
+    pool[i].next = NULL;
+    release_my_buffer(&pool[i]);
+  }
+
+  t_print("%s: %d network buffers allocated\n", __FUNCTION__, P2_NUM_BUFFERS);
+}
+
+void new_protocol_buffer_stats(int *capacity, int *inuse, int *highwater, long *misses) {
+  *capacity = P2_NUM_BUFFERS;
+  *inuse = atomic_load_explicit(&pool_inuse, memory_order_relaxed);
+  *highwater = pool_highwater;
+  *misses = atomic_load_explicit(&pool_misses, memory_order_relaxed);
+}
 
 //
-// The buffers used by new_protocol_thread
+// The rings between new_protocol_thread (producer) and the
+// DDC IQ threads (consumer), one per DDC.
 //
-#define RXIQRINGBUFLEN 512
-static volatile mybuffer *iq_buffer[MAX_DDC][RXIQRINGBUFLEN];
-static volatile int iq_inptr[MAX_DDC] = { 0 };
-static volatile int iq_outptr[MAX_DDC] = { 0 };
-static volatile int iq_count[MAX_DDC] = { 0 };
+// This is a single-producer/single-consumer ring, synchronized
+// with acquire/release atomics on head and tail.
+// The consumer drains *all* queued buffers per wake-up and only
+// sleeps if the ring is empty. Before sleeping, it raises the "sleeping"
+// flag and then checks the ring again. The producer only posts the
+// semaphore if it finds the flag raised (and the number of queued buffers
+// has reached p2_iq_wake_level), so under load most packets are handed
+// over without any system call.
+// Both the flag store/head load (consumer) and the head store/flag
+// load (producer) are sequentially consistent so that a wake-up
+// cannot be lost.
+// If p2_iq_wake_level is larger than one, the last few packets of a burst
+// may not reach the wake level, so the consumer then sleeps with a
+// time-out (IQ_WAIT_MSEC) such that a partly filled ring is always drained.
+//
+#define IQ_WAIT_MSEC 5
+
+typedef struct _iq_ring {
+  _Alignas(64) atomic_int head;       // written by producer only
+  _Alignas(64) atomic_int tail;       // written by consumer only
+  atomic_int sleeping;                // consumer waits on semaphore
+  int skip;                           // drop this many packets after an overflow
+  long packets;                       // statistics (producer)
+  long overflows;
+  long wakeups;
+  mybuffer *slot[RXIQRINGBUFLEN];
+} IQ_RING;
+
+static IQ_RING iq_ring[MAX_DDC];
+
+static inline int iq_ring_fill(const IQ_RING *ring) {
+  int fill = atomic_load_explicit(&ring->head, memory_order_seq_cst) -
+             atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+  if (fill < 0) { fill += RXIQRINGBUFLEN; }
+
+  return fill;
+}
+
+void new_protocol_iq_ring_stats(int ddc, long *packets, long *overflows, long *wakeups) {
+  if (ddc < 0 || ddc >= MAX_DDC) {
+    *packets = *overflows = *wakeups = 0;
+    return;
+  }
+
+  *packets = iq_ring[ddc].packets;
+  *overflows = iq_ring[ddc].overflows;
+  *wakeups = iq_ring[ddc].wakeups;
+}
 
 static mybuffer *high_priority_buffer;
 
@@ -284,40 +388,30 @@ static void  process_high_priority(void);
 static void  process_mic_data(const unsigned char *buffer);
 
 //
-// Obtain a free buffer. If no one is available allocate
-// 5 new ones. The buffers are *never* released to the
-// operating system, but marked free upon a protocol restart.
+// Obtain a free buffer. Only called from new_protocol_thread.
+// If the pool is empty, return the spare buffer (which is then
+// dropped by the caller).
 //
 static mybuffer *get_my_buffer() {
-  int i;
-  mybuffer *bp = buflist;
+  int head = atomic_load_explicit(&pool_head, memory_order_acquire);
 
-  while (bp) {
-    if (bp->free) {
-      // found free buffer. Mark as used and return that one.
-      bp->free = 0;
-      return bp;
-    }
+  while (head >= 0) {
+    if (atomic_compare_exchange_weak_explicit(&pool_head, &head, pool_next[head],
+        memory_order_acquire, memory_order_acquire)) {
+      int inuse = atomic_fetch_add_explicit(&pool_inuse, 1, memory_order_relaxed) + 1;
 
-    bp = bp->next;
+      if (inuse > pool_highwater) { pool_highwater = inuse; }
+
+      pool[head].free = 0;
+      return &pool[head];
+    }
   }
 
-  //
-  // no free buffer found, allocate some extra ones
-  // and add to the head of the list
-  //
-  for (i = 0; i < 25; i++) {
-    bp = malloc(sizeof(mybuffer));
-    bp->free = 1;
-    bp->next = buflist;
-    buflist = bp;
-    num_buf++;
+  if (atomic_fetch_add_explicit(&pool_misses, 1, memory_order_relaxed) == 0) {
+    t_print("%s: network buffer pool exhausted, dropping packets\n", __FUNCTION__);
   }
 
-  t_print("NewProtocol: number of buffers increased to %d\n", num_buf);
-  // Mark the first buffer in list as used and return that one.
-  buflist->free = 0;
-  return buflist;
+  return &pool_spare;
 }
 
 void schedule_high_priority() {
@@ -465,6 +559,8 @@ void new_protocol_init() {
 
   TXIQRINGBUF = g_new(unsigned char, TXIQRINGBUFLEN);
   RXAUDIORINGBUF = g_new(unsigned char, RXAUDIORINGBUFLEN);
+  init_my_buffers();
+  t_print("%s: using %s kernel for RX IQ conversion\n", __FUNCTION__, iqconv_kernel_name());
 
   if (transmitter->local_microphone) {
     if (audio_open_input() != 0) {
@@ -544,7 +640,9 @@ void new_protocol_init() {
     //            we set them to: RCVBUF: 0x40000, SNDBUF: 0x10000
     // then getsockopt() returns: RCVBUF: 0x40000, SNDBUF: 0x10000
     //
-    optval = 0x40000;
+    // The receive buffer size can be changed through the props file (udp_rcvbuf).
+    //
+    optval = udp_rcvbuf;
 
     if (setsockopt(data_socket, SOL_SOCKET, SO_RCVBUF, &optval, optlen) < 0) {
       t_perror("data_socket: set SO_RCVBUF");
@@ -556,6 +654,18 @@ void new_protocol_init() {
       t_perror("data_socket: set SO_SNDBUF");
     }
 
+#ifdef SO_BUSY_POLL
+
+    if (udp_busy_poll > 0) {
+      optval = udp_busy_poll;
+
+      if (setsockopt(data_socket, SOL_SOCKET, SO_BUSY_POLL, &optval, optlen) < 0) {
+        t_perror("data_socket: set SO_BUSY_POLL");
+      }
+    }
+
+#endif
+
     optlen = sizeof(optval);
 
     if (getsockopt(data_socket, SOL_SOCKET, SO_RCVBUF, &optval, &optlen) < 0) {
@@ -1723,18 +1833,28 @@ void new_protocol_menu_start() {
   update_action_table();
 
   //
-  // Mark all buffers free.
+  // Mark all buffers free. The network buffers from the pool are
+  // always returned by the threads using them, so only report statistics.
   //
   if (have_saturn_xdma) {
 #ifdef SATURN
     saturn_free_buffers();
 #endif
   } else {
-    mybuffer *mybuf = buflist;
-
-    while (mybuf) {
-      mybuf->free = 1;
-      mybuf = mybuf->next;
+    int capacity, inuse, highwater;
+    long misses;
+    new_protocol_buffer_stats(&capacity, &inuse, &highwater, &misses);
+    t_print("%s: network buffers: capacity=%d inuse=%d highwater=%d misses=%ld\n", __FUNCTION__,
+            capacity, inuse, highwater, misses);
+
+    for (int ddc = 0; ddc < MAX_DDC; ddc++) {
+      long packets, overflows, wakeups;
+      new_protocol_iq_ring_stats(ddc, &packets, &overflows, &wakeups);
+
+      if (packets > 0) {
+        t_print("%s: DDC(%d) packets=%ld overflows=%ld wakeups=%ld\n", __FUNCTION__,
+                ddc, packets, overflows, wakeups);
+      }
     }
   }
 
@@ -2000,9 +2120,143 @@ static gpointer new_protocol_txiq_thread(gpointer data) {
   return NULL;
 }
 
+//
+// Hand over a received packet to the thread that processes it.
+// This is the same for the single-packet and for the batched receive.
+//
+static void new_protocol_dispatch(mybuffer *mybuf, int bytesread, const struct sockaddr_in *from) {
+  int ddc;
+  short sourceport = ntohs(from->sin_port);
+
+  //t_print("new_protocol_thread: recvd %d bytes on port %d\n",bytesread,sourceport);
+  switch (sourceport) {
+  case RX_IQ_TO_HOST_PORT_0:
+  case RX_IQ_TO_HOST_PORT_1:
+  case RX_IQ_TO_HOST_PORT_2:
+  case RX_IQ_TO_HOST_PORT_3:
+  case RX_IQ_TO_HOST_PORT_4:
+  case RX_IQ_TO_HOST_PORT_5:
+  case RX_IQ_TO_HOST_PORT_6:
+  case RX_IQ_TO_HOST_PORT_7:
+    ddc = sourceport - RX_IQ_TO_HOST_PORT_0;
+    saturn_post_iq_data(ddc, mybuf);
+    break;
+
+  case COMMAND_RESPONSE_TO_HOST_PORT:
+    //
+    // Ignore these packets silently. They occur when
+    // flashing a new firmware using the new protocol
+    // programmer. But this should be done in a separate
+    // program.
+    //
+    release_my_buffer(mybuf);
+    break;
+
+  case HIGH_PRIORITY_TO_HOST_PORT:
+    saturn_post_high_priority(mybuf);
+    break;
+
+  case MIC_LINE_TO_HOST_PORT:
+    saturn_post_micaudio(bytesread, mybuf);
+    break;
+
+  default:
+    t_print("new_protocol_thread: Unknown port %d\n", sourceport);
+    release_my_buffer(mybuf);
+    break;
+  }
+}
+
+//
+// Statistics for the receive thread: number of receive calls and
+// number of packets received. Their ratio is the average batch size
+// (which is 1.0 without batching).
+//
+static long recv_calls = 0;
+static long recv_packets = 0;
+
+double new_protocol_avg_batch() {
+  return recv_calls > 0 ? (double) recv_packets / (double) recv_calls : 0.0;
+}
+
+#ifdef __linux__
+//
+// Batched receive: with a single recvmmsg() call, fetch all packets that
+// are queued in the socket (up to P2_RECV_BATCH), each into its own buffer
+// from the pool. Buffers that have not been filled are kept for the next call.
+//
+#define P2_RECV_BATCH 32
+
+static void new_protocol_batch_receive() {
+  struct mmsghdr msgs[P2_RECV_BATCH];
+  struct iovec iovs[P2_RECV_BATCH];
+  struct sockaddr_in from[P2_RECV_BATCH];
+  mybuffer *bufs[P2_RECV_BATCH];
+  int i, n;
+  t_print("%s: using recvmmsg() with up to %d packets\n", __FUNCTION__, P2_RECV_BATCH);
+
+  for (i = 0; i < P2_RECV_BATCH; i++) {
+    bufs[i] = NULL;
+  }
+
+  while (P2running) {
+    for (i = 0; i < P2_RECV_BATCH; i++) {
+      if (bufs[i] == NULL || bufs[i] == &pool_spare) {
+        bufs[i] = get_my_buffer();
+      }
+
+      iovs[i].iov_base = bufs[i]->buffer;
+      iovs[i].iov_len = NET_BUFFER_SIZE;
+      memset(&msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+      msgs[i].msg_hdr.msg_name = &from[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+    }
+
+    n = recvmmsg(data_socket, msgs, P2_RECV_BATCH, MSG_WAITFORONE, NULL);
+
+    if (!P2running) {
+      break;
+    }
+
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+
+      t_perror("recvmmsg socket failed for new_protocol_thread:");
+      g_idle_add(fatal_error, "P2 receive (Network problem?)");
+      P2running = 0;
+      break;
+    }
+
+    recv_calls++;
+    recv_packets += n;
+
+    for (i = 0; i < n; i++) {
+      mybuffer *mybuf = bufs[i];
+      bufs[i] = NULL;
+
+      if (mybuf == &pool_spare) {
+        // buffer pool exhausted, drop this packet
+        continue;
+      }
+
+      new_protocol_dispatch(mybuf, msgs[i].msg_len, &from[i]);
+    }
+  }
+
+  for (i = 0; i < P2_RECV_BATCH; i++) {
+    if (bufs[i] != NULL && bufs[i] != &pool_spare) {
+      release_my_buffer(bufs[i]);
+    }
+  }
+}
+#endif
+
 static gpointer new_protocol_thread(gpointer data) {
   t_print("new_protocol_thread\n");
-
+  recv_calls = 0;
+  recv_packets = 0;
   //
   // This thread should do as little work as possible and avoid any blocking.
   // Ideally, all data is just copied into ring buffers, and other threads
@@ -2010,9 +2264,17 @@ static gpointer new_protocol_thread(gpointer data) {
   // DDC-IQ and Microphone packets since they eventually get stuck in WDSP
   // (fexchange calls).
   //
+#ifdef __linux__
+
+  if (udp_batch_receive) {
+    new_protocol_batch_receive();
+    t_print("%s: average batch size: %.2f\n", __FUNCTION__, new_protocol_avg_batch());
+    return NULL;
+  }
+
+#endif
+
   while (P2running) {
-    int ddc;
-    short sourceport;
     int bytesread;
     mybuffer *mybuf;
     unsigned char *buffer;
@@ -2026,56 +2288,26 @@ static gpointer new_protocol_thread(gpointer data) {
       // we were doing "recvfrom". In this case, we want to let the main
       // thread terminate gracefully, including writing the props files.
       //
-      mybuf->free = 1;
+      release_my_buffer(mybuf);
       break;
     }
 
     if (bytesread < 0) {
       t_perror("recvfrom socket failed for new_protocol_thread:");
       g_idle_add(fatal_error, "P2 receive (Network problem?)");
+      release_my_buffer(mybuf);
       P2running = 0;
       break;
     }
 
-    sourceport = ntohs(addr.sin_port);
-
-    //t_print("new_protocol_thread: recvd %d bytes on port %d\n",bytesread,sourceport);
-    switch (sourceport) {
-    case RX_IQ_TO_HOST_PORT_0:
-    case RX_IQ_TO_HOST_PORT_1:
-    case RX_IQ_TO_HOST_PORT_2:
-    case RX_IQ_TO_HOST_PORT_3:
-    case RX_IQ_TO_HOST_PORT_4:
-    case RX_IQ_TO_HOST_PORT_5:
-    case RX_IQ_TO_HOST_PORT_6:
-    case RX_IQ_TO_HOST_PORT_7:
-      ddc = sourceport - RX_IQ_TO_HOST_PORT_0;
-      saturn_post_iq_data(ddc, mybuf);
-      break;
-
-    case COMMAND_RESPONSE_TO_HOST_PORT:
-      //
-      // Ignore these packets silently. They occur when
-      // flashing a new firmware using the new protocol
-      // programmer. But this should be done in a separate
-      // program.
-      //
-      mybuf->free = 1;
-      break;
-
-    case HIGH_PRIORITY_TO_HOST_PORT:
-      saturn_post_high_priority(mybuf);
-      break;
-
-    case MIC_LINE_TO_HOST_PORT:
-      saturn_post_micaudio(bytesread, mybuf);
-      break;
-
-    default:
-      t_print("new_protocol_thread: Unknown port %d\n", sourceport);
-      mybuf->free = 1;
-      break;
+    if (mybuf == &pool_spare) {
+      // buffer pool exhausted, drop this packet
+      continue;
     }
+
+    recv_calls++;
+    recv_packets++;
+    new_protocol_dispatch(mybuf, bytesread, &addr);
   }
 
   return NULL;
@@ -2093,7 +2325,7 @@ static gpointer high_priority_thread(gpointer data) {
     sem_wait(&high_priority_sem_buffer);
 #endif
     process_high_priority();
-    high_priority_buffer->free = 1;
+    release_my_buffer(high_priority_buffer);
   }
 
   return NULL;
@@ -2126,7 +2358,7 @@ static gpointer mic_line_thread(gpointer data) {
     if (mybuf->free) { continue; }
 
     process_mic_data(mybuf->buffer);
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
   }
 
   return NULL;
@@ -2155,13 +2387,13 @@ void saturn_post_high_priority(mybuffer *buffer) {
 
 void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
   if (!P2running) {
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
     return;
   }
 
   if (mic_count < 0) {
     mic_count++;
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
     return;
   }
 
@@ -2180,7 +2412,7 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
     mic_inptr = nptr;
   } else {
     t_print("%s: buffer overflow.\n", __FUNCTION__);
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
     // skip 16 mic buffers (21 msec)
     mic_count = -16;
   }
@@ -2189,18 +2421,18 @@ void saturn_post_micaudio(int bytesread, mybuffer *mybuf) {
 void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
   if (ddc < 0 || ddc >= MAX_DDC) {
     t_print("%s: invalid DDC(%d) seen!\n", __FUNCTION__, ddc);
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
     return;
   }
 
   if (!P2running) {
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
     return;
   }
 
-  if (iq_count[ddc] < 0) {
-    iq_count[ddc]++;
-    mybuf->free = 1;
+  if (iq_ring[ddc].skip > 0) {
+    iq_ring[ddc].skip--;
+    release_my_buffer(mybuf);
     return;
   }
 
@@ -2219,25 +2451,37 @@ void saturn_post_iq_data(int ddc, mybuffer *mybuf) {
   }
 
   ddc_sequence[ddc] = sequence + 1;
-  int iptr = iq_inptr[ddc];
-  int nptr = iptr + 1;
+  IQ_RING *ring = &iq_ring[ddc];
+  int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  int next = head + 1;
 
-  if (nptr >= RXIQRINGBUFLEN) { nptr = 0; }
+  if (next >= RXIQRINGBUFLEN) { next = 0; }
 
-  if (nptr != iq_outptr[ddc]) {
-    iq_buffer[ddc][iptr] = mybuf;
-    MEMORY_BARRIER;
-    iq_inptr[ddc] = nptr;
+  if (next == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+    //
+    // Ring full: the DDC thread cannot keep up.
+    //
+    ring->overflows++;
+    t_print("%s: DDC(%d) buffer overflow (total %ld).\n", __FUNCTION__, ddc, ring->overflows);
+    release_my_buffer(mybuf);
+    // skip 128 incoming buffers
+    ring->skip = 128;
+    return;
+  }
+
+  ring->slot[head] = mybuf;
+  ring->packets++;
+  atomic_store_explicit(&ring->head, next, memory_order_seq_cst);
+
+  if (atomic_load_explicit(&ring->sleeping, memory_order_seq_cst) &&
+      (p2_iq_wake_level <= 1 || iq_ring_fill(ring) >= p2_iq_wake_level) &&
+      atomic_exchange_explicit(&ring->sleeping, 0, memory_order_seq_cst)) {
+    ring->wakeups++;
 #ifdef __APPLE__
     sem_post(iq_sem[ddc]);
 #else
     sem_post(&iq_sem[ddc]);
 #endif
-  } else {
-    t_print("%s: DDC(%d) buffer overflow.\n", __FUNCTION__, ddc);
-    mybuf->free = 1;
-    // skip 128 incoming buffers
-    iq_count[ddc] = -128;
   }
 }
 
@@ -2246,10 +2490,11 @@ static gpointer iq_thread(gpointer data) {
   //
   // TEMPORARY: additional sequence check here
   //
-  int nptr, optr;
+  IQ_RING *ring = &iq_ring[ddc];
+  int tail;
   long sequence;
   long expected_sequence = 0;
-  volatile mybuffer *mybuf;
+  mybuffer *mybuf;
   const unsigned char *buffer;
   t_print("iq_thread: ddc=%d\n", ddc);
 
@@ -2261,19 +2506,60 @@ static gpointer iq_thread(gpointer data) {
   // channel.
   //
   while (1) {
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+      //
+      // Ring is empty: announce that we are going to sleep, and
+      // check again to close the race with the producer.
+      //
+      atomic_store_explicit(&ring->sleeping, 1, memory_order_seq_cst);
+
+      if (tail == atomic_load_explicit(&ring->head, memory_order_seq_cst)) {
+        if (p2_iq_wake_level <= 1) {
+#ifdef __APPLE__
+          sem_wait(iq_sem[ddc]);
+#else
+          sem_wait(&iq_sem[ddc]);
+#endif
+        } else {
+          //
+          // The producer does not post the semaphore before the wake level
+          // has been reached, so do not wait longer than IQ_WAIT_MSEC.
+          // Upon a time-out, the flag is still raised, which is harmless.
+          //
+          struct timespec deadline;
+          clock_gettime(CLOCK_REALTIME, &deadline);
+          deadline.tv_nsec += IQ_WAIT_MSEC * 1000000;
+
+          if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            deadline.tv_sec++;
+          }
+
 #ifdef __APPLE__
-    sem_wait(iq_sem[ddc]);
+          sem_timedwait(iq_sem[ddc], &deadline);
 #else
-    sem_wait(&iq_sem[ddc]);
+          sem_timedwait(&iq_sem[ddc], &deadline);
 #endif
-    optr = iq_outptr[ddc];
-    nptr = optr + 1;
+        }
+      } else {
+        //
+        // Data arrived in the meantime. If the producer has already
+        // cleared the flag, a (then spurious) sem_post is pending,
+        // which only causes one extra loop iteration later.
+        //
+        atomic_store_explicit(&ring->sleeping, 0, memory_order_relaxed);
+      }
 
-    if (nptr >= RXIQRINGBUFLEN) { nptr = 0; }
+      continue;
+    }
 
-    mybuf = iq_buffer[ddc][optr];
-    MEMORY_BARRIER;
-    iq_outptr[ddc] = nptr;
+    mybuf = ring->slot[tail];
+
+    if (++tail >= RXIQRINGBUFLEN) { tail = 0; }
+
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
 
     // This can happen when restarting the protocol
     if (mybuf->free) { continue; }
@@ -2315,18 +2601,21 @@ static gpointer iq_thread(gpointer data) {
       break;
     }
 
-    mybuf->free = 1;
+    release_my_buffer(mybuf);
   }
 
   return NULL;
 }
 
-static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
-  int b;
-  int leftsample;
-  int rightsample;
-  double leftsampledouble;
-  double rightsampledouble;
+//
+// A DDC packet contains a 16-byte header followed by samplesperframe
+// I/Q pairs, each value is 24-bit big-endian. The samples are converted
+// en bloc with a SIMD kernel (see iqconv.c) and then handed over to
+// the RX (or PS) engine with a single call per packet.
+//
+#define MAX_IQ_VALUES ((NET_BUFFER_SIZE - 16) / 3)
+
+static int get_samplesperframe(const unsigned char *buffer) {
   int samplesperframe = ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF);
 #ifdef P2IQDEBUG
   long long timestamp =
@@ -2339,147 +2628,82 @@ static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
     + ((long long)(buffer[10] & 0xFF) << 8)
     + ((long long)(buffer[11] & 0xFF)   );
   int bitspersample = ((buffer[12] & 0xFF) << 8) + (buffer[13] & 0xFF);
-  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __FUNCTION__, rx->id, bitspersample, samplesperframe);
+  t_print("%s: timestamp=%lld bitspersample=%d samplesperframe=%d\n", __FUNCTION__, timestamp, bitspersample,
+          samplesperframe);
 #endif
-  b = 16;
-  int i;
 
-  for (i = 0; i < samplesperframe; i++) {
-    leftsample   = (int)((signed char) buffer[b++]) << 16;
-    leftsample  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample  = (int)((signed char)buffer[b++]) << 16;
-    rightsample |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample |= (int)((unsigned char)buffer[b++] & 0xFF);
-    // The "obscure" constant 1.1920928955078125E-7 is 1/(2^23)
-    leftsampledouble = (double)leftsample * 1.1920928955078125E-7;
-    rightsampledouble = (double)rightsample * 1.1920928955078125E-7;
-    rx_add_iq_samples(rx, leftsampledouble, rightsampledouble);
+  //
+  // Never trust the header more than the buffer size
+  //
+  if (2 * samplesperframe > MAX_IQ_VALUES) {
+    t_print("%s: invalid samplesperframe(%d)\n", __FUNCTION__, samplesperframe);
+    samplesperframe = MAX_IQ_VALUES / 2;
   }
+
+  return samplesperframe;
+}
+
+static void process_iq_data(const unsigned char *buffer, RECEIVER *rx) {
+  int samplesperframe = get_samplesperframe(buffer);
+  rx_add_iq24_block(rx, buffer + 16, samplesperframe);
 }
 
 //
-// This is the same as process_ps_iq_data except that add_div_iq_samples is called
-// at the end
+// This is the same as process_ps_iq_data except that the samples
+// go to the diversity mixer.
+// For DIV and PS, two DDCs are packed into one stream, so each
+// "frame" has four values (i0, q0, i1, q1) and there are
+// samplesperframe/2 of them.
 //
 static void process_div_iq_data(const unsigned char*buffer) {
-  int b;
-  int leftsample0;
-  int rightsample0;
-  double leftsampledouble0;
-  double rightsampledouble0;
-  int leftsample1;
-  int rightsample1;
-  double leftsampledouble1;
-  double rightsampledouble1;
-  int samplesperframe = ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF);
-#ifdef P2IQDEBUG
-  long long timestamp =
-    ((long long)(buffer[4] & 0xFF) << 56)
-    + ((long long)(buffer[5] & 0xFF) << 48)
-    + ((long long)(buffer[6] & 0xFF) << 40)
-    + ((long long)(buffer[7] & 0xFF) << 32)
-    + ((long long)(buffer[8] & 0xFF) << 24)
-    + ((long long)(buffer[9] & 0xFF) << 16)
-    + ((long long)(buffer[10] & 0xFF) << 8)
-    + ((long long)(buffer[11] & 0xFF)    );
-  int bitspersample = ((buffer[12] & 0xFF) << 8) + (buffer[13] & 0xFF);
-  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __FUNCTION__, rx->id, bitspersample, samplesperframe);
-#endif
-  b = 16;
-  int i;
+  double iq[MAX_IQ_VALUES];
+  int samplesperframe = get_samplesperframe(buffer);
+  int frames = samplesperframe / 2;
+  iqconv_unpack24(buffer + 16, iq, 4 * frames);
+  rx_add_div_iq_block(receiver[0], iq, frames);
 
-  for (i = 0; i < samplesperframe; i += 2) {
-    leftsample0   = (int)((signed char) buffer[b++]) << 16;
-    leftsample0  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample0  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample0  = (int)((signed char)buffer[b++]) << 16;
-    rightsample0 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample0 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble0 = (double)leftsample0 * 1.1920928955078125E-7;
-    rightsampledouble0 = (double)rightsample0 * 1.1920928955078125E-7;
-    leftsample1   = (int)((signed char) buffer[b++]) << 16;
-    leftsample1  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample1  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample1  = (int)((signed char)buffer[b++]) << 16;
-    rightsample1 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample1 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble1 = (double)leftsample1 * 1.1920928955078125E-7;
-    rightsampledouble1 = (double)rightsample1 * 1.1920928955078125E-7;
-    rx_add_div_iq_samples(receiver[0], leftsampledouble0, rightsampledouble0, leftsampledouble1, rightsampledouble1);
+  //
+  // if both receivers share the sample rate, we can feed data to RX2
+  //
+  if (receivers > 1 && (receiver[0]->sample_rate == receiver[1]->sample_rate)) {
+    double iq1[MAX_IQ_VALUES / 2];
 
-    //
-    // if both receivers share the sample rate, we can feed data to RX2
-    //
-    if (receivers > 1 && (receiver[0]->sample_rate == receiver[1]->sample_rate)) {
-      rx_add_iq_samples(receiver[1], leftsampledouble1, rightsampledouble1);
+    for (int i = 0; i < frames; i++) {
+      iq1[2 * i]     = iq[4 * i + 2];
+      iq1[2 * i + 1] = iq[4 * i + 3];
     }
+
+    rx_add_iq_block(receiver[1], iq1, frames);
   }
 }
 
 static void process_ps_iq_data(const unsigned char *buffer) {
-  int samplesperframe;
-  int b;
-  int leftsample0;
-  int rightsample0;
-  double leftsampledouble0;
-  double rightsampledouble0;
-  int leftsample1;
-  int rightsample1;
-  double leftsampledouble1;
-  double rightsampledouble1;
-  samplesperframe = ((buffer[14] & 0xFF) << 8) + (buffer[15] & 0xFF);
-#ifdef P2IQDEBUG
-  long long timestamp =
-    ((long long)(buffer[4] & 0xFF) << 56)
-    + ((long long)(buffer[5] & 0xFF) << 48)
-    + ((long long)(buffer[6] & 0xFF) << 40)
-    + ((long long)(buffer[7] & 0xFF) << 32)
-    + ((long long)(buffer[8] & 0xFF) << 24)
-    + ((long long)(buffer[9] & 0xFF) << 16)
-    + ((long long)(buffer[10] & 0xFF) << 8)
-    + ((long long)(buffer[11] & 0xFF)   );
-  int bitspersample = ((buffer[12] & 0xFF) << 8) + (buffer[13] & 0xFF);
-  t_print("%s: rx=%d bitspersample=%d samplesperframe=%d\n", __FUNCTION__, rx->id, bitspersample, samplesperframe);
-#endif
-  b = 16;
-  int i;
-
-  for (i = 0; i < samplesperframe; i += 2) {
-    leftsample0   = (int)((signed char) buffer[b++]) << 16;
-    leftsample0  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample0  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample0  = (int)((signed char)buffer[b++]) << 16;
-    rightsample0 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample0 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble0 = (double)leftsample0 * 1.1920928955078125E-7;
-    rightsampledouble0 = (double)rightsample0 * 1.1920928955078125E-7;
-    leftsample1   = (int)((signed char) buffer[b++]) << 16;
-    leftsample1  |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    leftsample1  |= (int)((unsigned char)buffer[b++] & 0xFF);
-    rightsample1  = (int)((signed char)buffer[b++]) << 16;
-    rightsample1 |= (int)((((unsigned char)buffer[b++]) << 8) & 0xFF00);
-    rightsample1 |= (int)((unsigned char)buffer[b++] & 0xFF);
-    leftsampledouble1 = (double)leftsample1 * 1.1920928955078125E-7;
-    rightsampledouble1 = (double)rightsample1 * 1.1920928955078125E-7;
-    tx_add_ps_iq_samples(transmitter, leftsampledouble1, rightsampledouble1, leftsampledouble0, rightsampledouble0);
-    //t_print("%06x,%06x %06x,%06x\n",leftsample0,rightsample0,leftsample1,rightsample1);
+  double iq[MAX_IQ_VALUES];
+  int samplesperframe = get_samplesperframe(buffer);
+  int frames = samplesperframe / 2;
+  iqconv_unpack24(buffer + 16, iq, 4 * frames);
+  //
+  // DDC0 delivers the RX feedback, DDC1 the TX feedback (this is
+  // the order expected by tx_add_ps_iq_block).
+  //
+  tx_add_ps_iq_block(transmitter, iq, frames);
 #if defined(DUMP_TX_DATA)
 
-    if ((DUMP_TX_DATA == DUMP_TXFDBK) && (rxiq_count < 1000000)) {
-      rxiqi[rxiq_count] = leftsample1;
-      rxiqq[rxiq_count] = rightsample1;
+  for (int i = 0; i < frames && rxiq_count < 1000000; i++) {
+    if (DUMP_TX_DATA == DUMP_TXFDBK) {
+      rxiqi[rxiq_count] = (long)(iq[4 * i + 2] * 8388608.0);
+      rxiqq[rxiq_count] = (long)(iq[4 * i + 3] * 8388608.0);
       rxiq_count++;
     }
 
-    if ((DUMP_TX_DATA == DUMP_RXFDBK) && (rxiq_count < 1000000)) {
-      rxiqi[rxiq_count] = leftsample0;
-      rxiqq[rxiq_count] = rightsample0;
+    if (DUMP_TX_DATA == DUMP_RXFDBK) {
+      rxiqi[rxiq_count] = (long)(iq[4 * i] * 8388608.0);
+      rxiqq[rxiq_count] = (long)(iq[4 * i + 1] * 8388608.0);
       rxiq_count++;
     }
+  }
 
 #endif
-  }
 }
 
 static void process_high_priority() {
@@ -2717,7 +2941,13 @@ void new_protocol_cw_audio_samples(short left_audio_sample, short right_audio_sa
   }
 }
 
-void new_protocol_audio_samples(short left_audio_sample, short right_audio_sample) {
+//
+// Send a block of RX audio samples (frames stereo samples, interleaved L/R)
+// to the radio. send_rxaudio_mutex is only taken once per block, and
+// the samples are packed into the ring buffer in runs of up to 64
+// samples (one packet).
+//
+void new_protocol_audio_block(const short *lr, int frames) {
   int txmode = vfo_get_tx_mode();
 
   //
@@ -2727,12 +2957,6 @@ void new_protocol_audio_samples(short left_audio_sample, short right_audio_sampl
 
   pthread_mutex_lock(&send_rxaudio_mutex);
 
-  if (rxaudio_count < 0) {
-    rxaudio_count++;
-    pthread_mutex_unlock(&send_rxaudio_mutex);
-    return;
-  }
-
   if (rxaudio_flag) {
     //
     // First time we arrive here after a TX(CW)->RX transition:
@@ -2743,81 +2967,139 @@ void new_protocol_audio_samples(short left_audio_sample, short right_audio_sampl
     rxaudio_flag = 0;
   }
 
-  int iptr = rxaudio_inptr + 4 * rxaudio_count;
-  RXAUDIORINGBUF[iptr++] = (left_audio_sample  >> 8) & 0xFF;
-  RXAUDIORINGBUF[iptr++] = (left_audio_sample      ) & 0xFF;
-  RXAUDIORINGBUF[iptr++] = (right_audio_sample >> 8) & 0xFF;
-  RXAUDIORINGBUF[iptr++] = (right_audio_sample     ) & 0xFF;
-  rxaudio_count++;
+  while (frames > 0) {
+    int n;
 
-  if (rxaudio_count >= 64) {
-    int nptr = rxaudio_inptr + 256;
+    if (rxaudio_count < 0) {
+      n = (-rxaudio_count < frames) ? -rxaudio_count : frames;
+      rxaudio_count += n;
+      lr += 2 * n;
+      frames -= n;
+      continue;
+    }
 
-    if (nptr >= RXAUDIORINGBUFLEN) { nptr = 0; }
+    n = 64 - rxaudio_count;
+
+    if (n > frames) { n = frames; }
+
+    unsigned char *p = &RXAUDIORINGBUF[rxaudio_inptr + 4 * rxaudio_count];
+
+    for (int i = 0; i < n; i++) {
+      *p++ = (lr[2 * i]     >> 8) & 0xFF;
+      *p++ = (lr[2 * i]         ) & 0xFF;
+      *p++ = (lr[2 * i + 1] >> 8) & 0xFF;
+      *p++ = (lr[2 * i + 1]     ) & 0xFF;
+    }
+
+    lr += 2 * n;
+    frames -= n;
+    rxaudio_count += n;
+
+    if (rxaudio_count >= 64) {
+      int nptr = rxaudio_inptr + 256;
+
+      if (nptr >= RXAUDIORINGBUFLEN) { nptr = 0; }
 
-    if (nptr != rxaudio_outptr) {
-      rxaudio_inptr = nptr;
+      if (nptr != rxaudio_outptr) {
+        rxaudio_inptr = nptr;
 #ifdef __APPLE__
-      sem_post(rxaudio_sem);
+        sem_post(rxaudio_sem);
 #else
-      sem_post(&rxaudio_sem);
+        sem_post(&rxaudio_sem);
 #endif
-      rxaudio_count = 0;
-    } else {
-      t_print("%s: buffer overflow\n", __FUNCTION__);
-      // skip some audio samples
-      rxaudio_count = -4096;
+        rxaudio_count = 0;
+      } else {
+        t_print("%s: buffer overflow\n", __FUNCTION__);
+        // skip some audio samples
+        rxaudio_count = -4096;
+      }
     }
   }
 
   pthread_mutex_unlock(&send_rxaudio_mutex);
 }
 
-void new_protocol_iq_samples(int isample, int qsample) {
-  if (txiq_count < 0) {
-    txiq_count++;
-    return;
-  }
+void new_protocol_audio_samples(short left_audio_sample, short right_audio_sample) {
+  short lr[2] = { left_audio_sample, right_audio_sample };
+  new_protocol_audio_block(lr, 1);
+}
+
+//
+// Send a block of TX IQ samples (n samples, interleaved I/Q) to the radio.
+// The samples are packed into the ring buffer in runs of up to
+// 240 samples (one packet).
+//
+void new_protocol_iq_block(const int *iq, int n) {
+  while (n > 0) {
+    int run;
+
+    if (txiq_count < 0) {
+      run = (-txiq_count < n) ? -txiq_count : n;
+      txiq_count += run;
+      iq += 2 * run;
+      n -= run;
+      continue;
+    }
+
+    run = 240 - txiq_count;
+
+    if (run > n) { run = n; }
 
 #if defined(DUMP_TX_DATA)
 
-  if ((DUMP_TX_DATA == DUMP_TXIQ) && (rxiq_count < 1000000)) {
-    rxiqi[rxiq_count] = isample;
-    rxiqq[rxiq_count] = qsample;
-    rxiq_count++;
-  }
+    if (DUMP_TX_DATA == DUMP_TXIQ) {
+      for (int i = 0; i < run && rxiq_count < 1000000; i++) {
+        rxiqi[rxiq_count] = iq[2 * i];
+        rxiqq[rxiq_count] = iq[2 * i + 1];
+        rxiq_count++;
+      }
+    }
 
 #endif
-  int iptr = txiq_inptr + 6 * txiq_count;
-  TXIQRINGBUF[iptr++] = (isample >> 16) & 0xFF;
-  TXIQRINGBUF[iptr++] = (isample >>  8) & 0xFF;
-  TXIQRINGBUF[iptr++] = (isample      ) & 0xFF;
-  TXIQRINGBUF[iptr++] = (qsample >> 16) & 0xFF;
-  TXIQRINGBUF[iptr++] = (qsample >>  8) & 0xFF;
-  TXIQRINGBUF[iptr++] = (qsample      ) & 0xFF;
-  txiq_count++;
-
-  if (txiq_count >= 240) {
-    int nptr = txiq_inptr + 1440;
+    unsigned char *p = &TXIQRINGBUF[txiq_inptr + 6 * txiq_count];
 
-    if (nptr >= TXIQRINGBUFLEN) { nptr = 0; }
+    for (int i = 0; i < run; i++) {
+      int isample = iq[2 * i];
+      int qsample = iq[2 * i + 1];
+      *p++ = (isample >> 16) & 0xFF;
+      *p++ = (isample >>  8) & 0xFF;
+      *p++ = (isample      ) & 0xFF;
+      *p++ = (qsample >> 16) & 0xFF;
+      *p++ = (qsample >>  8) & 0xFF;
+      *p++ = (qsample      ) & 0xFF;
+    }
+
+    iq += 2 * run;
+    n -= run;
+    txiq_count += run;
 
-    if (nptr != txiq_outptr) {
-      txiq_inptr = nptr;
-      txiq_count = 0;
+    if (txiq_count >= 240) {
+      int nptr = txiq_inptr + 1440;
+
+      if (nptr >= TXIQRINGBUFLEN) { nptr = 0; }
+
+      if (nptr != txiq_outptr) {
+        txiq_inptr = nptr;
+        txiq_count = 0;
 #ifdef __APPLE__
-      sem_post(txiq_sem);
+        sem_post(txiq_sem);
 #else
-      sem_post(&txiq_sem);
+        sem_post(&txiq_sem);
 #endif
-    } else {
-      t_print("%s: output buffer overflow\n", __FUNCTION__);
-      // skip 4800 samples ( 25 msec @ 192k )
-      txiq_count = -4800;
+      } else {
+        t_print("%s: output buffer overflow\n", __FUNCTION__);
+        // skip 4800 samples ( 25 msec @ 192k )
+        txiq_count = -4800;
+      }
     }
   }
 }
 
+void new_protocol_iq_samples(int isample, int qsample) {
+  int iq[2] = { isample, qsample };
+  new_protocol_iq_block(iq, 1);
+}
+
 // cppcheck-suppress constParameterCallback
 void* new_protocol_timer_thread(void* arg) {
   //
@@ -27,6 +27,12 @@
 
 #define MAX_DDC 4
 
+//
+// Number of slots in the ring buffer of each DDC IQ thread
+// (this is also the upper limit for p2_iq_wake_level)
+//
+#define RXIQRINGBUFLEN 512
+
 // port definitions from host
 #define GENERAL_REGISTERS_FROM_HOST_PORT              1024
 #define PROGRAMMING_FROM_HOST_PORT                    1024
@@ -62,7 +68,8 @@
 ////////////////////////////////////////////////////////////////////////////
 //
 // One buffer. The fences can be used to detect over-writing
-// (feature currently not used).
+// (feature currently not used). Buffers are cache-line aligned
+// since they are allocated as a contiguous pool.
 //
 ////////////////////////////////////////////////////////////////////////////
 
@@ -72,7 +79,7 @@ struct mybuffer_ {
   long            lowfence;
   unsigned char   buffer[NET_BUFFER_SIZE];
   long            highfence;
-};
+} __attribute__((aligned(64)));
 
 typedef struct mybuffer_ mybuffer;
 
@@ -91,6 +98,8 @@ extern void tuner_changed(void);
 
 extern void new_protocol_audio_samples(short left_audio_sample, short right_audio_sample);
 extern void new_protocol_iq_samples(int isample, int qsample);
+extern void new_protocol_audio_block(const short *lr, int frames);
+extern void new_protocol_iq_block(const int *iq, int n);
 extern void new_protocol_flush_iq_samples(void);
 extern void new_protocol_cw_audio_samples(short l, short r);
 
@@ -100,6 +109,10 @@ extern void saturn_post_iq_data(int ddc, mybuffer *buffer);
 extern void saturn_post_micaudio(int bytes, mybuffer *buffer);
 extern void saturn_post_high_priority(mybuffer *buffer);
 
+extern void new_protocol_buffer_stats(int *capacity, int *inuse, int *highwater, long *misses);
+extern void new_protocol_iq_ring_stats(int ddc, long *packets, long *overflows, long *wakeups);
+extern double new_protocol_avg_batch(void);
+
 //
 // if DUMP_TX_DATA is #defined, the first 1000000 samples
 // after a RXTX transition are dumped to a file at the
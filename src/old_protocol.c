@@ -19,6 +19,10 @@
 *
 */
 
+#ifdef __linux__
+  #define _GNU_SOURCE  // needed for recvmmsg()
+#endif
+
 #include <gtk/gtk.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -159,6 +163,7 @@ static int command = 1;
 
 static gpointer receive_thread(gpointer arg);
 static gpointer process_ozy_input_buffer_thread(gpointer arg);
+static gpointer p1_rx_thread(gpointer data);
 
 static void queue_two_ozy_input_buffers(unsigned const char *buf1,
                                         unsigned const char *buf2);
@@ -327,6 +332,55 @@ static atomic_int rxring_inptr;   // pointer updated when writing into the ring
 static atomic_int rxring_outptr;  // pointer updated when reading from the ring buffer
 static atomic_int rxring_count;   // a sample counter
 
+//
+// Per-receiver worker threads.
+//
+// The "P1 proc" thread parses the incoming data. If p1_rx_workers is set,
+// it does not feed the RX IQ samples to the receivers itself but collects
+// them in blocks, one stream for each of receiver[0] and receiver[1], and
+// hands these over through single-producer/single-consumer rings to one
+// worker thread per receiver ("P1 RX0", "P1 RX1"). These do the WDSP work
+// (rx_add_iq_block -> fexchange0 -> Spectrum0), so the receivers run on
+// different cores. The PureSignal feedback (whose TX and RX samples must
+// stay paired) and the microphone samples are still processed by the
+// "P1 proc" thread.
+//
+// Each ring delivers the blocks in order. The synchronization is the same
+// as for the P2 DDC rings in new_protocol.c: the worker drains all queued
+// blocks, and before sleeping raises the "sleeping" flag and checks again,
+// and the producer only posts the semaphore if the flag is raised.
+//
+#define P1_RX_WORKERS      2
+#define P1_RX_BLOCK_FRAMES 128      // at least 2*63 (max. samples/receiver in two ozy buffers)
+#define P1_RX_RINGLEN      256      // about 80 msec at 384k
+
+typedef struct _p1_rx_block {
+  int frames;
+  int div;                          // if set, frames are (i0, q0, i1, q1) for the diversity mixer
+  double iq[4 * P1_RX_BLOCK_FRAMES];
+} P1_RX_BLOCK;
+
+typedef struct _p1_rx_ring {
+  _Alignas(64) atomic_int head;     // written by producer only
+  _Alignas(64) atomic_int tail;     // written by consumer only
+  atomic_int sleeping;              // consumer waits on semaphore
+  P1_RX_BLOCK *cur;                 // block being filled by the producer (slot[head]), or NULL
+  int dropping;                     // producer found the ring full
+  long blocks;                      // statistics (producer)
+  long overflows;
+  long wakeups;
+  P1_RX_BLOCK slot[P1_RX_RINGLEN];
+} P1_RX_RING;
+
+static P1_RX_RING *p1_rx_ring[P1_RX_WORKERS];
+static int p1_rx_use_workers = 0;   // p1_rx_workers, as it was upon init
+
+#ifdef __APPLE__
+  static sem_t *p1_rx_sem[P1_RX_WORKERS];
+#else
+  static sem_t p1_rx_sem[P1_RX_WORKERS];
+#endif
+
 #ifdef __APPLE__
 void old_protocol_update_timing(void) {
   int div = atomic_load_explicit(&mic_sample_divisor, memory_order_relaxed);
@@ -533,7 +587,15 @@ void old_protocol_stop() {
   //
   if (device == DEVICE_OZY) { return; }
 
-  t_print("%s\n", __FUNCTION__);
+  t_print("%s: avg. packets per receive call: %.2f\n", __FUNCTION__, old_protocol_avg_batch());
+
+  if (p1_rx_use_workers) {
+    for (int r = 0; r < P1_RX_WORKERS; r++) {
+      t_print("%s: RX%d worker: blocks=%ld overflows=%ld wakeups=%ld\n", __FUNCTION__, r,
+              p1_rx_ring[r]->blocks, p1_rx_ring[r]->overflows, p1_rx_ring[r]->wakeups);
+    }
+  }
+
   pthread_mutex_lock(&send_ozy_mutex);
   P1running = 0;
   metis_start_stop(0);
@@ -611,6 +673,22 @@ void old_protocol_init(int rate) {
     }
   }
 
+  p1_rx_use_workers = p1_rx_workers;
+
+  if (p1_rx_use_workers) {
+    for (i = 0; i < P1_RX_WORKERS; i++) {
+      char text[16];
+      p1_rx_ring[i] = g_new0(P1_RX_RING, 1);
+#ifdef __APPLE__
+      p1_rx_sem[i] = apple_sem(0);
+#else
+      (void) sem_init(&p1_rx_sem[i], 0, 0);
+#endif
+      snprintf(text, sizeof(text), "P1 RX%d", i);
+      g_thread_new(text, p1_rx_thread, GINT_TO_POINTER(i));
+    }
+  }
+
   g_thread_new("P1 proc", process_ozy_input_buffer_thread, NULL);
 
   //
@@ -828,7 +906,9 @@ static void open_udp_socket() {
   //            we set them to: RCVBUF: 0x40000, SNDBUF: 0x10000
   // then getsockopt() returns: RCVBUF: 0x40000, SNDBUF: 0x10000
   //
-  optval = 0x40000;
+  // The receive buffer size can be changed through the props file (udp_rcvbuf).
+  //
+  optval = udp_rcvbuf;
 
   if (setsockopt(tmp, SOL_SOCKET, SO_RCVBUF, &optval, optlen) < 0) {
     t_perror("data_socket: set SO_RCVBUF");
@@ -840,6 +920,18 @@ static void open_udp_socket() {
     t_perror("data_socket: set SO_SNDBUF");
   }
 
+#ifdef SO_BUSY_POLL
+
+  if (udp_busy_poll > 0) {
+    optval = udp_busy_poll;
+
+    if (setsockopt(tmp, SOL_SOCKET, SO_BUSY_POLL, &optval, optlen) < 0) {
+      t_perror("data_socket: set SO_BUSY_POLL");
+    }
+  }
+
+#endif
+
   optlen = sizeof(optval);
 
   if (getsockopt(tmp, SOL_SOCKET, SO_RCVBUF, &optval, &optlen) < 0) {
@@ -1032,15 +1124,120 @@ static void open_tcp_socket() {
   t_print("TCP socket established: %d\n", tcp_socket);
 }
 
+//
+// Statistics for the receive thread: number of receive calls and
+// number of packets received. Their ratio is the average batch size
+// (which is 1.0 without batching).
+//
+static long recv_calls = 0;
+static long recv_packets = 0;
+
+double old_protocol_avg_batch() {
+  return recv_calls > 0 ? (double) recv_packets / (double) recv_calls : 0.0;
+}
+
 #ifndef __APPLE__
+static void process_data_packet(unsigned char *buffer, int bytes_read) {
+  int ep;
+  uint32_t sequence;
+
+  if (buffer[0] == 0xEF && buffer[1] == 0xFE) {
+    switch (buffer[2]) {
+    case 1:
+      // get the end point
+      ep = buffer[3] & 0xFF;
+      // get the sequence number
+      sequence = ((buffer[4] & 0xFF) << 24) + ((buffer[5] & 0xFF) << 16) + ((buffer[6] & 0xFF) << 8) + (buffer[7] & 0xFF);
+
+      // A sequence error with a seqnum of zero usually indicates a METIS restart
+      // and is no error condition
+      if (sequence != 0 && sequence != last_seq_num + 1) {
+        t_print("SEQ ERROR: last %ld, recvd %ld\n", (long) last_seq_num, (long) sequence);
+        sequence_errors++;
+      }
+
+      last_seq_num = sequence;
+
+      switch (ep) {
+      case 6: // EP6
+        // process the data
+        queue_two_ozy_input_buffers(&buffer[8], &buffer[520]);
+        break;
+
+      case 4: // EP4
+        // not implemented
+        break;
+
+      default:
+        t_print("unexpected EP %d length=%d\n", ep, bytes_read);
+        break;
+      }
+
+      break;
+
+    case 2:  // response to a discovery packet
+      t_print("unexepected discovery response when not in discovery mode\n");
+      break;
+
+    default:
+      t_print("unexpected packet type: 0x%02X\n", buffer[2]);
+      break;
+    }
+  } else {
+    t_print("received bad header bytes on data port %02X,%02X\n", buffer[0], buffer[1]);
+  }
+}
+
+#ifdef __linux__
+//
+// Batched UDP receive: fetch all packets queued in the socket
+// (up to P1_RECV_BATCH) with a single recvmmsg() call and process them.
+// Returns the number of packets, or -1 (with errno set) on error/timeout.
+//
+#define P1_RECV_BATCH 16
+
+static int receive_batch() {
+  static unsigned char buffers[P1_RECV_BATCH][1032];
+  struct mmsghdr msgs[P1_RECV_BATCH];
+  struct iovec iovs[P1_RECV_BATCH];
+  int i, n;
+
+  for (i = 0; i < P1_RECV_BATCH; i++) {
+    iovs[i].iov_base = buffers[i];
+    iovs[i].iov_len = sizeof(buffers[i]);
+    memset(&msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  n = recvmmsg(data_socket, msgs, P1_RECV_BATCH, MSG_WAITFORONE, NULL);
+
+  if (n <= 0) { return n; }
+
+  recv_calls++;
+  recv_packets += n;
+
+  //
+  // If the protocol has been stopped, just swallow all incoming packets
+  //
+  if (!P1running) { return n; }
+
+  for (i = 0; i < n; i++) {
+    if (msgs[i].msg_len > 0) {
+      process_data_packet(buffers[i], msgs[i].msg_len);
+    }
+  }
+
+  return n;
+}
+#endif
+
 static gpointer receive_thread(gpointer arg) {
   struct sockaddr_in addr;
   socklen_t length;
   unsigned char buffer[1032];
   int bytes_read;
   int ret, left;
-  int ep;
-  uint32_t sequence;
   t_print( "old_protocol: receive_thread\n");
   length = sizeof(addr);
 
@@ -1073,9 +1270,30 @@ static gpointer receive_thread(gpointer arg) {
             bytes_read = ret;                        // error case: discard whole packet
           }
         } else if (data_socket >= 0) {
-          bytes_read = recvfrom(data_socket, buffer, sizeof(buffer), 0, (struct sockaddr*)&addr, &length);
+#ifdef __linux__
+
+          if (udp_batch_receive) {
+            //
+            // packets are processed within receive_batch(),
+            // so we can directly go for the next batch
+            //
+            if (receive_batch() >= 0) { continue; }
+
+            if (errno != EAGAIN) { t_perror("old_protocol recvmmsg UDP:"); }
 
-          if (bytes_read < 0 && errno != EAGAIN) { t_perror("old_protocol recvfrom UDP:"); }
+            bytes_read = -1;
+          } else
+#endif
+          {
+            bytes_read = recvfrom(data_socket, buffer, sizeof(buffer), 0, (struct sockaddr*)&addr, &length);
+
+            if (bytes_read < 0 && errno != EAGAIN) { t_perror("old_protocol recvfrom UDP:"); }
+
+            if (bytes_read > 0) {
+              recv_calls++;
+              recv_packets++;
+            }
+          }
 
           //t_print("%s: bytes_read=%d\n",__FUNCTION__,bytes_read);
         } else {
@@ -1096,69 +1314,7 @@ static gpointer receive_thread(gpointer arg) {
         continue;
       }
 
-#ifdef __APPLE__
-      static struct timespec last_rx_time = {0, 0};
-      struct timespec now_rx;
-      clock_gettime(CLOCK_MONOTONIC, &now_rx);
-
-      if (last_rx_time.tv_sec != 0) {
-        long delta_us = (now_rx.tv_sec - last_rx_time.tv_sec) * 1000000 +
-                        (now_rx.tv_nsec - last_rx_time.tv_nsec) / 1000;
-
-        if (delta_us > 3000 || delta_us < 2000) { // optionaler Filter
-          t_print("RX Jitter: Δt = %.3f ms\n", delta_us / 1000.0);
-        }
-      }
-
-      last_rx_time = now_rx;
-#endif
-
-      if (buffer[0] == 0xEF && buffer[1] == 0xFE) {
-        switch (buffer[2]) {
-        case 1:
-          // get the end point
-          ep = buffer[3] & 0xFF;
-          // get the sequence number
-          sequence = ((buffer[4] & 0xFF) << 24) + ((buffer[5] & 0xFF) << 16) + ((buffer[6] & 0xFF) << 8) + (buffer[7] & 0xFF);
-
-          // A sequence error with a seqnum of zero usually indicates a METIS restart
-          // and is no error condition
-          if (sequence != 0 && sequence != last_seq_num + 1) {
-            t_print("SEQ ERROR: last %ld, recvd %ld\n", (long) last_seq_num, (long) sequence);
-            sequence_errors++;
-          }
-
-          last_seq_num = sequence;
-
-          switch (ep) {
-          case 6: // EP6
-            // process the data
-            queue_two_ozy_input_buffers(&buffer[8], &buffer[520]);
-            break;
-
-          case 4: // EP4
-            // not implemented
-            break;
-
-          default:
-            t_print("unexpected EP %d length=%d\n", ep, bytes_read);
-            break;
-          }
-
-          break;
-
-        case 2:  // response to a discovery packet
-          t_print("unexepected discovery response when not in discovery mode\n");
-          break;
-
-        default:
-          t_print("unexpected packet type: 0x%02X\n", buffer[2]);
-          break;
-        }
-      } else {
-        t_print("received bad header bytes on data port %02X,%02X\n", buffer[0], buffer[1]);
-      }
-
+      process_data_packet(buffer, bytes_read);
       break;
     }
   }
@@ -1531,20 +1687,154 @@ static int how_many_receivers() {
   return ret;
 }
 
+//
+// Producer side of the per-receiver rings (P1 proc thread)
+//
+static P1_RX_BLOCK *p1_rx_open(P1_RX_RING *ring, int div) {
+  int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  int next = head + 1;
+
+  if (next >= P1_RX_RINGLEN) { next = 0; }
+
+  if (next == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+    //
+    // Ring full: the worker cannot keep up. Drop samples until there is room again.
+    //
+    if (!ring->dropping) {
+      ring->overflows++;
+      ring->dropping = 1;
+      t_print("%s: RX worker buffer overflow (total %ld).\n", __FUNCTION__, ring->overflows);
+    }
+
+    return NULL;
+  }
+
+  ring->dropping = 0;
+  ring->cur = &ring->slot[head];
+  ring->cur->frames = 0;
+  ring->cur->div = div;
+  return ring->cur;
+}
+
+static void p1_rx_commit(int r) {
+  P1_RX_RING *ring = p1_rx_ring[r];
+
+  if (ring->cur == NULL) { return; }
+
+  int next = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+
+  if (next >= P1_RX_RINGLEN) { next = 0; }
+
+  ring->cur = NULL;
+  ring->blocks++;
+  atomic_store_explicit(&ring->head, next, memory_order_seq_cst);
+
+  if (atomic_load_explicit(&ring->sleeping, memory_order_seq_cst) &&
+      atomic_exchange_explicit(&ring->sleeping, 0, memory_order_seq_cst)) {
+    ring->wakeups++;
+#ifdef __APPLE__
+    sem_post(p1_rx_sem[r]);
+#else
+    sem_post(&p1_rx_sem[r]);
+#endif
+  }
+}
+
+static inline double *p1_rx_frame(int r, int div) {
+  P1_RX_RING *ring = p1_rx_ring[r];
+  P1_RX_BLOCK *b = ring->cur;
+
+  if (b != NULL && (b->div != div || b->frames == P1_RX_BLOCK_FRAMES)) {
+    p1_rx_commit(r);
+    b = NULL;
+  }
+
+  if (b == NULL && (b = p1_rx_open(ring, div)) == NULL) { return NULL; }
+
+  return b->iq + (div ? 4 : 2) * b->frames++;
+}
+
+static void p1_rx_iq(int r, double i, double q) {
+  if (p1_rx_use_workers) {
+    double *p = p1_rx_frame(r, 0);
+
+    if (p) {
+      p[0] = i;
+      p[1] = q;
+    }
+  } else {
+    rx_add_iq_samples(receiver[r], i, q);
+  }
+}
+
+static void p1_rx_div_iq(double i0, double q0, double i1, double q1) {
+  if (p1_rx_use_workers) {
+    double *p = p1_rx_frame(0, 1);
+
+    if (p) {
+      p[0] = i0;
+      p[1] = q0;
+      p[2] = i1;
+      p[3] = q1;
+    }
+  } else {
+    rx_add_div_iq_samples(receiver[0], i0, q0, i1, q1);
+  }
+}
+
+//
+// Consumer side: one thread per receiver
+//
+static gpointer p1_rx_thread(gpointer data) {
+  int r = GPOINTER_TO_INT(data);
+  P1_RX_RING *ring = p1_rx_ring[r];
+  int tail;
+
+  for (;;) {
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+      atomic_store_explicit(&ring->sleeping, 1, memory_order_seq_cst);
+
+      if (tail == atomic_load_explicit(&ring->head, memory_order_seq_cst)) {
+#ifdef __APPLE__
+        sem_wait(p1_rx_sem[r]);
+#else
+        sem_wait(&p1_rx_sem[r]);
+#endif
+      } else {
+        atomic_store_explicit(&ring->sleeping, 0, memory_order_relaxed);
+      }
+
+      continue;
+    }
+
+    const P1_RX_BLOCK *b = &ring->slot[tail];
+
+    if (b->div) {
+      rx_add_div_iq_block(receiver[r], b->iq, b->frames);
+    } else {
+      rx_add_iq_block(receiver[r], b->iq, b->frames);
+    }
+
+    if (++tail >= P1_RX_RINGLEN) { tail = 0; }
+
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+  }
+
+  return NULL;
+}
+
+//
+// State of the byte-by-byte parser (process_ozy_byte), which is only
+// used to re-gain sync, and of the current frame.
+//
+#define P1_MAX_RX 8
+
 static int nreceiver;
-static int left_sample;
-static int right_sample;
+static int sample;
+static double iq_row[2 * P1_MAX_RX];  // one sample of each receiver
 static short mic_sample;
-static double left_sample_double;
-static double right_sample_double;
-double left_sample_double_rx;
-double right_sample_double_rx;
-double left_sample_double_tx;
-double right_sample_double_tx;
-double left_sample_double_main;
-double right_sample_double_main;
-double left_sample_double_aux;
-double right_sample_double_aux;
 
 static int nsamples;
 static int iq_samples;
@@ -1774,12 +2064,90 @@ static void process_control_bytes() {
 //
 // These static variables are set at the beginning
 // of process_ozy_input_buffer() and "do" the communication
-// with process_ozy_byte()
+// with process_ozy_frame() and process_ozy_byte()
 //
 static int st_num_hpsdr_receivers;
 static int st_rxfdbk;
 static int st_txfdbk;
 
+//
+// These are set once per frame, after the control bytes have been processed
+//
+static int st_ps;     // transmitting with PureSignal
+static int st_div;    // receiving with DIVERSITY
+static int st_rx;     // receiving (or duplex) without DIVERSITY
+
+static void process_frame_start() {
+  process_control_bytes();
+  int xmit = radio_is_transmitting();
+  st_ps  = xmit && transmitter->puresignal;
+  st_div = !xmit && diversity_enabled && st_num_hpsdr_receivers > 1;
+  st_rx  = (!xmit || duplex) && !diversity_enabled;
+}
+
+//
+// iq contains one I/Q sample pair for each HPSDR receiver
+//
+static void process_iq_row(const double *iq) {
+  if (st_ps && st_rxfdbk < st_num_hpsdr_receivers && st_txfdbk < st_num_hpsdr_receivers) {
+    //
+    // transmitting with PureSignal. Feed TX and RX feedback sample pair to pscc
+    //
+    tx_add_ps_iq_samples(transmitter, iq[2 * st_txfdbk], iq[2 * st_txfdbk + 1], iq[2 * st_rxfdbk],
+                         iq[2 * st_rxfdbk + 1]);
+  }
+
+  if (st_div) {
+    //
+    // receiving with DIVERSITY. Feed sample pairs to the diversity mixer.
+    // If the second RX is running, feed aux samples to that receiver.
+    //
+    p1_rx_div_iq(iq[0], iq[1], iq[2], iq[3]);
+
+    if (receivers > 1) { p1_rx_iq(1, iq[2], iq[3]); }
+  }
+
+  if (st_rx) {
+    //
+    // RX without DIVERSITY. Feed samples to RX1 and RX2
+    //
+    p1_rx_iq(0, iq[0], iq[1]);
+
+    if (st_num_hpsdr_receivers > 1 && receivers > 1) { p1_rx_iq(1, iq[2], iq[3]); }
+  }
+}
+
+static void process_mic_sample(short mic) {
+  mic_samples++;
+
+  if (mic_samples >= mic_sample_divisor) { // reduce to 48000
+    //
+    // if radio_ptt is set, this usually means the PTT at the microphone connected
+    // to the SDR is pressed. In this case, we take audio from BOTH sources
+    // then we can use a "voice keyer" on some loop-back interface but at the same
+    // time use our microphone.
+    // In most situations only one source will be active so we just add.
+    //
+    float fsample;
+
+    if (radio_ptt) {
+      fsample = (float) mic * 0.00003051;
+
+      if (transmitter->local_microphone) { fsample += audio_get_next_mic_sample(); }
+    } else {
+      fsample = transmitter->local_microphone ? audio_get_next_mic_sample() : (float) mic * 0.00003051;
+    }
+
+    tx_add_mic_sample(transmitter, fsample);
+    mic_samples = 0;
+  }
+}
+
+//
+// Byte-by-byte parser. This is only used if the frame-level parser
+// finds a frame that does not start with the sync bytes, and then
+// searches for the next sync.
+//
 static void process_ozy_byte(int b) {
   switch (state) {
   case SYNC_0:
@@ -1829,7 +2197,7 @@ static void process_ozy_byte(int b) {
 
   case CONTROL_4:
     control_in[4] = b;
-    process_control_bytes();
+    process_frame_start();
     nreceiver = 0;
     iq_samples = (512 - 8) / ((st_num_hpsdr_receivers * 6) + 2);
     nsamples = 0;
@@ -1837,86 +2205,38 @@ static void process_ozy_byte(int b) {
     break;
 
   case LEFT_SAMPLE_HI:
-    left_sample = (int)((signed char)b << 16);
+    sample = (int)((signed char)b << 16);
     state++;
     break;
 
   case LEFT_SAMPLE_MID:
-    left_sample |= (int)((((unsigned char)b) << 8) & 0xFF00);
+    sample |= (int)((((unsigned char)b) << 8) & 0xFF00);
     state++;
     break;
 
   case LEFT_SAMPLE_LOW:
-    left_sample |= (int)((unsigned char)b & 0xFF);
-    left_sample_double = (double)left_sample * 1.1920928955078125E-7;
+    sample |= (int)((unsigned char)b & 0xFF);
+    iq_row[2 * nreceiver] = (double)sample * 1.1920928955078125E-7;
     state++;
     break;
 
   case RIGHT_SAMPLE_HI:
-    right_sample = (int)((signed char)b << 16);
+    sample = (int)((signed char)b << 16);
     state++;
     break;
 
   case RIGHT_SAMPLE_MID:
-    right_sample |= (int)((((unsigned char)b) << 8) & 0xFF00);
+    sample |= (int)((((unsigned char)b) << 8) & 0xFF00);
     state++;
     break;
 
   case RIGHT_SAMPLE_LOW:
-    right_sample |= (int)((unsigned char)b & 0xFF);
-    right_sample_double = (double)right_sample * 1.1920928955078125E-7;
-
-    if (radio_is_transmitting() && transmitter->puresignal) {
-      //
-      // transmitting with PureSignal. Get sample pairs and feed to pscc
-      //
-      if (nreceiver == st_rxfdbk) {
-        left_sample_double_rx = left_sample_double;
-        right_sample_double_rx = right_sample_double;
-      } else if (nreceiver == st_txfdbk) {
-        left_sample_double_tx = left_sample_double;
-        right_sample_double_tx = right_sample_double;
-      }
-
-      // this is pure paranoia, it allows for st_txfdbk < st_rxfdbk
-      if (nreceiver + 1 == st_num_hpsdr_receivers) {
-        tx_add_ps_iq_samples(transmitter, left_sample_double_tx, right_sample_double_tx, left_sample_double_rx,
-                             right_sample_double_rx);
-      }
-    }
-
-    if (!radio_is_transmitting() && diversity_enabled) {
-      //
-      // receiving with DIVERSITY. Get sample pairs and feed to diversity mixer.
-      // If the second RX is running, feed aux samples to that receiver.
-      //
-      if (nreceiver == 0) {
-        left_sample_double_main = left_sample_double;
-        right_sample_double_main = right_sample_double;
-      } else if (nreceiver == 1) {
-        left_sample_double_aux = left_sample_double;
-        right_sample_double_aux = right_sample_double;
-        rx_add_div_iq_samples(receiver[0], left_sample_double_main, right_sample_double_main, left_sample_double_aux,
-                              right_sample_double_aux);
-
-        if (receivers > 1) { rx_add_iq_samples(receiver[1], left_sample_double_aux, right_sample_double_aux); }
-      }
-    }
-
-    if ((!radio_is_transmitting() || duplex) && !diversity_enabled) {
-      //
-      // RX without DIVERSITY. Feed samples to RX1 and RX2
-      //
-      if (nreceiver == 0) {
-        rx_add_iq_samples(receiver[0], left_sample_double, right_sample_double);
-      } else if (nreceiver == 1 && receivers > 1) {
-        rx_add_iq_samples(receiver[1], left_sample_double, right_sample_double);
-      }
-    }
-
+    sample |= (int)((unsigned char)b & 0xFF);
+    iq_row[2 * nreceiver + 1] = (double)sample * 1.1920928955078125E-7;
     nreceiver++;
 
     if (nreceiver == st_num_hpsdr_receivers) {
+      process_iq_row(iq_row);
       state++;
     } else {
       state = LEFT_SAMPLE_HI;
@@ -1931,30 +2251,7 @@ static void process_ozy_byte(int b) {
 
   case MIC_SAMPLE_LOW:
     mic_sample |= (short)(b & 0xFF);
-    mic_samples++;
-
-    if (mic_samples >= mic_sample_divisor) { // reduce to 48000
-      //
-      // if radio_ptt is set, this usually means the PTT at the microphone connected
-      // to the SDR is pressed. In this case, we take audio from BOTH sources
-      // then we can use a "voice keyer" on some loop-back interface but at the same
-      // time use our microphone.
-      // In most situations only one source will be active so we just add.
-      //
-      float fsample;
-
-      if (radio_ptt) {
-        fsample = (float) mic_sample * 0.00003051;
-
-        if (transmitter->local_microphone) { fsample += audio_get_next_mic_sample(); }
-      } else {
-        fsample = transmitter->local_microphone ? audio_get_next_mic_sample() : (float) mic_sample * 0.00003051;
-      }
-
-      tx_add_mic_sample(transmitter, fsample);
-      mic_samples = 0;
-    }
-
+    process_mic_sample(mic_sample);
     nsamples++;
 
     if (nsamples == iq_samples) {
@@ -1968,6 +2265,75 @@ static void process_ozy_byte(int b) {
   }
 }
 
+//
+// Frame-level parser.
+//
+// An ozy frame has a fixed layout: 3 sync bytes, 5 control bytes, then
+// iq_samples "rows", each containing a 24-bit I and Q value for each
+// HPSDR receiver followed by a 16-bit mic sample, and some padding.
+// The byte offsets of all I/Q values and mic samples only depend on
+// the number of receivers and are put into a table. Then all I/Q values
+// of a frame are converted in one loop.
+//
+// If the byte parser is just re-gaining sync (state != SYNC_0), or
+// a frame does not start with the sync bytes, the frame is handed
+// to the byte parser which then searches for the next sync.
+//
+#define P1_FRAME_VALUES ((OZY_BUFFER_SIZE - 8) / 3)
+
+static int frame_nrx = 0;                              // table is valid for this number of receivers
+static int frame_rows;                                 // number of rows (iq_samples)
+static int frame_values;                               // number of I/Q values
+static unsigned short frame_iq_offset[P1_FRAME_VALUES];
+static unsigned short frame_mic_offset[P1_FRAME_VALUES];
+
+static void frame_build_offsets(int nrx) {
+  int stride = 6 * nrx + 2;
+  int k = 0;
+  frame_rows = (OZY_BUFFER_SIZE - 8) / stride;
+
+  for (int row = 0; row < frame_rows; row++) {
+    int offset = 8 + row * stride;
+
+    for (int i = 0; i < 2 * nrx; i++) {
+      frame_iq_offset[k++] = offset + 3 * i;
+    }
+
+    frame_mic_offset[row] = offset + 6 * nrx;
+  }
+
+  frame_values = k;
+  frame_nrx = nrx;
+}
+
+static void process_ozy_frame(const unsigned char *frame) {
+  double iq[P1_FRAME_VALUES];
+  int nrx = st_num_hpsdr_receivers;
+
+  if (state != SYNC_0 || frame[0] != SYNC || frame[1] != SYNC || frame[2] != SYNC) {
+    for (int i = 0; i < OZY_BUFFER_SIZE; i++) { process_ozy_byte(frame[i]); }
+
+    return;
+  }
+
+  memcpy(control_in, frame + 3, 5);
+  process_frame_start();
+
+  if (nrx != frame_nrx) { frame_build_offsets(nrx); }
+
+  for (int k = 0; k < frame_values; k++) {
+    const unsigned char *p = frame + frame_iq_offset[k];
+    int v = ((int)(signed char)p[0] << 16) | ((int)p[1] << 8) | (int)p[2];
+    iq[k] = (double)v * 1.1920928955078125E-7;
+  }
+
+  for (int row = 0; row < frame_rows; row++) {
+    const unsigned char *p = frame + frame_mic_offset[row];
+    process_iq_row(iq + 2 * nrx * row);
+    process_mic_sample((short)((p[0] << 8) | p[1]));
+  }
+}
+
 static void queue_two_ozy_input_buffers(unsigned const char *buf1,
                                         unsigned const char *buf2) {
   //
@@ -2026,9 +2392,9 @@ static gpointer process_ozy_input_buffer_thread(gpointer arg) {
   // This thread constantly monitors the input ring buffer and
   // processes the data whenever a bunch is available. Note this
   // thread does all the fexchange() with WDSP, since it calls
-  // (via process_ozy_byte)
+  // (via process_ozy_frame)
   //
-  // add_iq_samples   ==> RX engine(s)
+  // add_iq_samples   ==> RX engine(s), or the RX worker threads
   // add_mic_sample   ==> TX engine
   //
   for (;;) {
@@ -2049,7 +2415,12 @@ static gpointer process_ozy_input_buffer_thread(gpointer arg) {
     st_rxfdbk = rx_feedback_channel();
     st_txfdbk = tx_feedback_channel();
 
-    for (int i = 0; i < 1024; i++) { process_ozy_byte(RXRINGBUF[out + i] & 0xFF); }
+    process_ozy_frame(&RXRINGBUF[out]);
+    process_ozy_frame(&RXRINGBUF[out + OZY_BUFFER_SIZE]);
+
+    if (p1_rx_use_workers) {
+      for (int r = 0; r < P1_RX_WORKERS; r++) { p1_rx_commit(r); }
+    }
 
     MEMORY_BARRIER;
     atomic_store_explicit(&rxring_outptr, nptr, memory_order_release);
@@ -2058,210 +2429,248 @@ static gpointer process_ozy_input_buffer_thread(gpointer arg) {
   return NULL;
 }
 
-void old_protocol_audio_samples(short left_audio_sample, short right_audio_sample) {
-  if (!radio_is_transmitting()) {
-    pthread_mutex_lock(&send_audio_mutex);
-    int tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
+//
+// A complete block of TXRING_AUDIO_FRAMES_PER_BLOCK frames has been put into
+// the TX ring buffer: hand it over to the sending thread.
+// Must be called with send_audio_mutex locked.
+//
+static void txring_commit_block() {
+  int in = atomic_load_explicit(&txring_inptr, memory_order_relaxed);
+  int out = atomic_load_explicit(&txring_outptr, memory_order_acquire);
+  int nptr = in + TXRING_AUDIO_SAMPLE_BYTES * TXRING_AUDIO_FRAMES_PER_BLOCK;
 
-    if (tc < 0) {
-      (void) atomic_fetch_add_explicit(&txring_count, 1, memory_order_relaxed);
-      pthread_mutex_unlock(&send_audio_mutex);
-      return;
-    }
+  if (nptr >= TXRINGBUFLEN) { nptr = 0; }
 
+  if (nptr != out) {
 #ifdef __APPLE__
+    sem_post(txring_sem);
+#else
+    sem_post(&txring_sem);
+#endif
+    atomic_store_explicit(&txring_inptr, nptr, memory_order_release);
+    atomic_store_explicit(&txring_count, 0,   memory_order_relaxed);
+  } else {
+    t_print("%s: output buffer overflow.\n", __FUNCTION__);
+    atomic_store_explicit(&txring_count, -TXRING_AUDIO_FRAMES_PER_BLOCK * 10, memory_order_relaxed);
+  }
+}
 
-    if (atomic_load_explicit(&txring_flag, memory_order_acquire)) {
-      struct timespec ts = { .tv_sec = 0, .tv_nsec = 5000000 }; // 5ms
-      atomic_store_explicit(&txring_drain, 1, memory_order_release);
-      nanosleep(&ts, NULL);
-      atomic_store_explicit(&txring_drain, 0, memory_order_release);
-      atomic_store_explicit(&txring_flag,  0, memory_order_release);
-    }
+//
+// Determine how many of the next frames can be stored in the current
+// TX ring buffer block, and the write pointer for the first one.
+// After an overflow, a number of frames is skipped: this is done
+// here, and then the negative number of skipped frames is returned.
+// Must be called with send_audio_mutex locked.
+//
+static int txring_next_run(int frames, unsigned char **p) {
+  int tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
 
-#else
+  if (tc < 0) {
+    int n = (-tc < frames) ? -tc : frames;
+    (void) atomic_fetch_add_explicit(&txring_count, n, memory_order_relaxed);
+    return -n;
+  }
 
-    if (atomic_load_explicit(&txring_flag, memory_order_acquire)) {
-      //
-      // First time we arrive here after a TX->RX transition:
-      // set the "drain" flag, wait 5 msec, clear it
-      // This should drain the txiq ring buffer
-      //
-      atomic_store_explicit(&txring_drain, 1, memory_order_release);
-      usleep(5000);
-      atomic_store_explicit(&txring_drain, 0, memory_order_release);
-      atomic_store_explicit(&txring_flag,  0, memory_order_release);
-    }
+  int n = TXRING_AUDIO_FRAMES_PER_BLOCK - tc;
 
-#endif
-    int in = atomic_load_explicit(&txring_inptr, memory_order_relaxed);
-    tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
-    int iptr = (in + TXRING_AUDIO_SAMPLE_BYTES * tc) % TXRINGBUFLEN;
+  if (n > frames) { n = frames; }
 
-    //
-    // The HL2 makes no use of audio samples, but instead
-    // uses them to write to extended addrs which we do not
-    // want to do un-intentionally, therefore send zeros.
-    // Note special variants of the HL2 *do* have an audio codec!
-    //
-    if (device == DEVICE_HERMES_LITE2 && !hl2_audio_codec) {
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-    } else {
-      TXRINGBUF[iptr++] = left_audio_sample >> 8;
-      TXRINGBUF[iptr++] = left_audio_sample;
-      TXRINGBUF[iptr++] = right_audio_sample >> 8;
-      TXRINGBUF[iptr++] = right_audio_sample;
-    }
+  *p = &TXRINGBUF[atomic_load_explicit(&txring_inptr, memory_order_relaxed) + TXRING_AUDIO_SAMPLE_BYTES * tc];
+  return n;
+}
 
-    TXRINGBUF[iptr++] = 0;
-    TXRINGBUF[iptr++] = 0;
-    TXRINGBUF[iptr++] = 0;
-    TXRINGBUF[iptr++] = 0;
-    (void) atomic_fetch_add_explicit(&txring_count, 1, memory_order_relaxed);
-    tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
+//
+// Store n frames in the current TX ring buffer block, and commit
+// the block if it is complete.
+//
+static void txring_advance(int n) {
+  int tc = atomic_fetch_add_explicit(&txring_count, n, memory_order_relaxed) + n;
 
-    if (tc >= TXRING_AUDIO_FRAMES_PER_BLOCK) { // also 126
-      in = atomic_load_explicit(&txring_inptr, memory_order_relaxed);
-      int out = atomic_load_explicit(&txring_outptr, memory_order_acquire);
-      int nptr = in + TXRING_AUDIO_SAMPLE_BYTES * TXRING_AUDIO_FRAMES_PER_BLOCK;
+  if (tc >= TXRING_AUDIO_FRAMES_PER_BLOCK) {
+    txring_commit_block();
+  }
+}
 
-      if (nptr >= TXRINGBUFLEN) { nptr = 0; }
+//
+// Send a block of RX audio samples (frames stereo samples, interleaved L/R)
+// to the radio. send_audio_mutex is only taken once per block, and the
+// samples are packed into the TX ring buffer in runs that end at block
+// boundaries.
+//
+void old_protocol_audio_block(const short *lr, int frames) {
+  if (radio_is_transmitting()) { return; }
 
-      if (nptr != out) {
+  pthread_mutex_lock(&send_audio_mutex);
 #ifdef __APPLE__
-        sem_post(txring_sem);
+
+  if (atomic_load_explicit(&txring_flag, memory_order_acquire)) {
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 5000000 }; // 5ms
+    atomic_store_explicit(&txring_drain, 1, memory_order_release);
+    nanosleep(&ts, NULL);
+    atomic_store_explicit(&txring_drain, 0, memory_order_release);
+    atomic_store_explicit(&txring_flag,  0, memory_order_release);
+  }
+
 #else
-        sem_post(&txring_sem);
+
+  if (atomic_load_explicit(&txring_flag, memory_order_acquire)) {
+    //
+    // First time we arrive here after a TX->RX transition:
+    // set the "drain" flag, wait 5 msec, clear it
+    // This should drain the txiq ring buffer
+    //
+    atomic_store_explicit(&txring_drain, 1, memory_order_release);
+    usleep(5000);
+    atomic_store_explicit(&txring_drain, 0, memory_order_release);
+    atomic_store_explicit(&txring_flag,  0, memory_order_release);
+  }
+
 #endif
-        atomic_store_explicit(&txring_inptr, nptr, memory_order_release);
-        atomic_store_explicit(&txring_count, 0,   memory_order_relaxed);
-      } else {
-        t_print("%s: output buffer overflow.\n", __FUNCTION__);
-        atomic_store_explicit(&txring_count, -TXRING_AUDIO_FRAMES_PER_BLOCK * 10, memory_order_relaxed);
+  //
+  // The HL2 makes no use of audio samples, but instead
+  // uses them to write to extended addrs which we do not
+  // want to do un-intentionally, therefore send zeros.
+  // Note special variants of the HL2 *do* have an audio codec!
+  //
+  int nocodec = (device == DEVICE_HERMES_LITE2 && !hl2_audio_codec);
+
+  while (frames > 0) {
+    unsigned char *p;
+    int n = txring_next_run(frames, &p);
+
+    if (n < 0) {
+      lr -= 2 * n;
+      frames += n;
+      continue;
+    }
+
+    if (nocodec) {
+      memset(p, 0, TXRING_AUDIO_SAMPLE_BYTES * n);
+    } else {
+      for (int i = 0; i < n; i++) {
+        p[0] = lr[2 * i] >> 8;
+        p[1] = lr[2 * i];
+        p[2] = lr[2 * i + 1] >> 8;
+        p[3] = lr[2 * i + 1];
+        p[4] = 0;
+        p[5] = 0;
+        p[6] = 0;
+        p[7] = 0;
+        p += TXRING_AUDIO_SAMPLE_BYTES;
       }
     }
 
-    pthread_mutex_unlock(&send_audio_mutex);
+    lr += 2 * n;
+    frames -= n;
+    txring_advance(n);
   }
+
+  pthread_mutex_unlock(&send_audio_mutex);
 }
 
-void old_protocol_iq_samples(int isample, int qsample, int side) {
-  if (radio_is_transmitting()) {
-    pthread_mutex_lock(&send_audio_mutex);
-    int tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
+void old_protocol_audio_samples(short left_audio_sample, short right_audio_sample) {
+  short lr[2] = { left_audio_sample, right_audio_sample };
+  old_protocol_audio_block(lr, 1);
+}
 
-    if (tc < 0) {
-      (void) atomic_fetch_add_explicit(&txring_count, 1, memory_order_relaxed);
-      pthread_mutex_unlock(&send_audio_mutex);
-      return;
-    }
+//
+// Send a block of TX IQ samples (n samples, interleaved I/Q) to the radio,
+// together with the side tone (in the audio slots). side may be NULL
+// which means "no side tone".
+//
+void old_protocol_iq_block(const int *iq, const int *side, int n) {
+  if (!radio_is_transmitting()) { return; }
 
+  pthread_mutex_lock(&send_audio_mutex);
 #ifdef __APPLE__
 
-    if (!atomic_load_explicit(&txring_flag, memory_order_acquire)) {
-      struct timespec start, now;
-      clock_gettime(CLOCK_MONOTONIC, &start);
-      atomic_store_explicit(&txring_drain, 1, memory_order_release);
-
-      for (;;) {
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        long elapsed_us = (now.tv_sec - start.tv_sec) * 1000000 +
-                          (now.tv_nsec - start.tv_nsec) / 1000;
+  if (!atomic_load_explicit(&txring_flag, memory_order_acquire)) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    atomic_store_explicit(&txring_drain, 1, memory_order_release);
 
-        if (elapsed_us > 5000) { break; }
-      }
+    for (;;) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      long elapsed_us = (now.tv_sec - start.tv_sec) * 1000000 +
+                        (now.tv_nsec - start.tv_nsec) / 1000;
 
-      atomic_store_explicit(&txring_drain, 0, memory_order_release);
-      atomic_store_explicit(&txring_flag,  1, memory_order_release);
+      if (elapsed_us > 5000) { break; }
     }
 
+    atomic_store_explicit(&txring_drain, 0, memory_order_release);
+    atomic_store_explicit(&txring_flag,  1, memory_order_release);
+  }
+
 #else
 
-    if (!atomic_load_explicit(&txring_flag, memory_order_acquire)) {
-      //
-      // First time we arrive here after a RX->TX transition:
-      // set the "drain" flag, wait 5 msec, clear it
-      // This should drain the txiq ring buffer (which also
-      // contains the audio samples) for minimum CW side tone latency.
-      //
-      atomic_store_explicit(&txring_drain, 1, memory_order_release);
-      usleep(5000);
-      atomic_store_explicit(&txring_drain, 0, memory_order_release);
-      atomic_store_explicit(&txring_flag,  1, memory_order_release);
-    }
+  if (!atomic_load_explicit(&txring_flag, memory_order_acquire)) {
+    //
+    // First time we arrive here after a RX->TX transition:
+    // set the "drain" flag, wait 5 msec, clear it
+    // This should drain the txiq ring buffer (which also
+    // contains the audio samples) for minimum CW side tone latency.
+    //
+    atomic_store_explicit(&txring_drain, 1, memory_order_release);
+    usleep(5000);
+    atomic_store_explicit(&txring_drain, 0, memory_order_release);
+    atomic_store_explicit(&txring_flag,  1, memory_order_release);
+  }
 
 #endif
-    int in = atomic_load_explicit(&txring_inptr, memory_order_relaxed);
-    tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
-    int iptr = in + 8 * tc;
+  //
+  // See old_protocol_audio_block() for the HL2 audio codec.
+  //
+  // The "CWX" method in the HL2 firmware behaves erroneously
+  // if the CW input from the KEY/PTT jack is activated.
+  // To make deskHPSDR immune to this problem, the least significant
+  // bit of the I (and Q) samples are cleared.
+  // The resolution of the IQ samples is thus reduced from 16 to 15 bits,
+  // but since the HL2 DAC is 12-bit this is no problem.
+  //
+  int hl2 = (device == DEVICE_HERMES_LITE2);
+  int nocodec = (hl2 && !hl2_audio_codec);
+  unsigned char lsbmask = hl2 ? 0xFE : 0xFF;
 
-    //
-    // The HL2 makes no use of audio samples, but instead
-    // uses them to write to extended addrs which we do not
-    // want to do un-intentionally, therefore send zeros.
-    // Note special variants of the HL2 *do* have an audio codec!
-    //
-    if (device == DEVICE_HERMES_LITE2 && !hl2_audio_codec) {
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-      TXRINGBUF[iptr++] = 0;
-    } else {
-      TXRINGBUF[iptr++] = side  >> 8;
-      TXRINGBUF[iptr++] = side;
-      TXRINGBUF[iptr++] = side >> 8;
-      TXRINGBUF[iptr++] = side;
+  while (n > 0) {
+    unsigned char *p;
+    int run = txring_next_run(n, &p);
+
+    if (run < 0) {
+      iq -= 2 * run;
+
+      if (side) { side -= run; }
+
+      n += run;
+      continue;
     }
 
-    if (device == DEVICE_HERMES_LITE2) {
-      //
-      // The "CWX" method in the HL2 firmware behaves erroneously
-      // if the CW input from the KEY/PTT jack is activated.
-      // To make deskHPSDR immune to this problem, the least significant
-      // bit of the I (and Q) samples are cleared.
-      // The resolution of the IQ samples is thus reduced from 16 to 15 bits,
-      // but since the HL2 DAC is 12-bit this is no problem.
-      //
-      TXRINGBUF[iptr++] = isample >> 8;
-      TXRINGBUF[iptr++] = isample & 0xFE;
-      TXRINGBUF[iptr++] = qsample >> 8;
-      TXRINGBUF[iptr++] = qsample & 0xFE;
-    } else {
-      TXRINGBUF[iptr++] = isample >> 8;
-      TXRINGBUF[iptr++] = isample;
-      TXRINGBUF[iptr++] = qsample >> 8;
-      TXRINGBUF[iptr++] = qsample;
+    for (int i = 0; i < run; i++) {
+      int sidetone = (side && !nocodec) ? side[i] : 0;
+      p[0] = sidetone >> 8;
+      p[1] = sidetone;
+      p[2] = sidetone >> 8;
+      p[3] = sidetone;
+      p[4] = iq[2 * i] >> 8;
+      p[5] = iq[2 * i] & lsbmask;
+      p[6] = iq[2 * i + 1] >> 8;
+      p[7] = iq[2 * i + 1] & lsbmask;
+      p += TXRING_AUDIO_SAMPLE_BYTES;
     }
 
-    (void) atomic_fetch_add_explicit(&txring_count, 1, memory_order_relaxed);
-    tc = atomic_load_explicit(&txring_count, memory_order_relaxed);
+    iq += 2 * run;
 
-    if (tc >= 126) {
-      int out = atomic_load_explicit(&txring_outptr, memory_order_acquire);
-      in = atomic_load_explicit(&txring_inptr, memory_order_relaxed);
-      int nptr = in + 1008;
+    if (side) { side += run; }
 
-      if (nptr >= TXRINGBUFLEN) { nptr = 0; }
+    n -= run;
+    txring_advance(run);
+  }
 
-      if (nptr != out) {
-#ifdef __APPLE__
-        sem_post(txring_sem);
-#else
-        sem_post(&txring_sem);
-#endif
-        atomic_store_explicit(&txring_inptr, nptr, memory_order_release);
-        atomic_store_explicit(&txring_count, 0,   memory_order_relaxed);
-      } else {
-        t_print("%s: output buffer overflow.\n", __FUNCTION__);
-        atomic_store_explicit(&txring_count, -1260, memory_order_relaxed);
-      }
-    }
+  pthread_mutex_unlock(&send_audio_mutex);
+}
 
-    pthread_mutex_unlock(&send_audio_mutex);
-  }
+void old_protocol_iq_samples(int isample, int qsample, int side) {
+  int iq[2] = { isample, qsample };
+  old_protocol_iq_block(iq, &side, 1);
 }
 
 static inline unsigned char hl2_tx_latency_ms(int txvfo) {
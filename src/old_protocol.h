@@ -35,6 +35,9 @@ extern void old_protocol_set_mic_sample_rate(int rate);
 
 extern void old_protocol_audio_samples(short left_audio_sample, short right_audio_sample);
 extern void old_protocol_iq_samples(int isample, int qsample, int side);
+extern void old_protocol_audio_block(const short *lr, int frames);
+extern void old_protocol_iq_block(const int *iq, const int *side, int n);
+extern double old_protocol_avg_batch(void);
 #ifdef __APPLE__
   extern void old_protocol_update_timing(void);
 #endif
@@ -631,33 +631,12 @@ void audio_close_output(RECEIVER *rx) {
 }
 
 //
-// AUDIO_WRITE
-//
-// send RX audio data to a PA output stream
-// we have to store the data such that the PA callback function
-// can access it.
-//
-// Note that the check on radio_is_transmitting() takes care that "blocking"
-// by the mutex can only occur in the moment of a RX/TX transition if
-// both audio_write() and cw_audio_write() get a "go".
+// Put one stereo sample into the ring buffer.
+// Must be called with rx->local_audio_mutex locked.
 //
-// So mutex locking/unlocking should only cost few CPU cycles in
-// normal operation.
-//
-int audio_write (RECEIVER *rx, float left, float right) {
-  int txmode = vfo_get_tx_mode();
+static void audio_put_sample(RECEIVER *rx, float left, float right) {
   float *buffer = rx->local_audio_buffer;
 
-  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
-    //
-    // If a CW side tone may occur, quickly return
-    //
-    return 0;
-  }
-
-  g_mutex_lock(&rx->local_audio_mutex);
-  cwmode = 0;
-
   if (rx->playstream != NULL && buffer != NULL) {
     int avail = rx->local_audio_buffer_inpt - rx->local_audio_buffer_outpt;
 
@@ -729,6 +708,56 @@ int audio_write (RECEIVER *rx, float left, float right) {
       rx->local_audio_buffer_inpt = newpt;
     }
   }
+}
+
+//
+// AUDIO_WRITE
+//
+// send RX audio data to a PA output stream
+// we have to store the data such that the PA callback function
+// can access it.
+//
+// Note that the check on radio_is_transmitting() takes care that "blocking"
+// by the mutex can only occur in the moment of a RX/TX transition if
+// both audio_write() and cw_audio_write() get a "go".
+//
+// So mutex locking/unlocking should only cost few CPU cycles in
+// normal operation.
+//
+int audio_write (RECEIVER *rx, float left, float right) {
+  int txmode = vfo_get_tx_mode();
+
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    //
+    // If a CW side tone may occur, quickly return
+    //
+    return 0;
+  }
+
+  g_mutex_lock(&rx->local_audio_mutex);
+  cwmode = 0;
+  audio_put_sample(rx, left, right);
+  g_mutex_unlock(&rx->local_audio_mutex);
+  return 0;
+}
+
+//
+// Block version of audio_write: lr contains frames interleaved
+// stereo samples. The mutex is only taken once per block.
+//
+int audio_write_block(RECEIVER *rx, const float *lr, int frames) {
+  int txmode = vfo_get_tx_mode();
+
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    return 0;
+  }
+
+  g_mutex_lock(&rx->local_audio_mutex);
+  cwmode = 0;
+
+  for (int i = 0; i < frames; i++) {
+    audio_put_sample(rx, lr[2 * i], lr[2 * i + 1]);
+  }
 
   g_mutex_unlock(&rx->local_audio_mutex);
   return 0;
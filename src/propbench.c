@@ -0,0 +1,415 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+/*
+ *
+ * Load/save benchmark for the property store (property.c).
+ *
+ * A props file with the given number of entries is generated, with names
+ * as they occur in deskHPSDR (receiver.%d.xxx, band.%d.xxx, ...). Then,
+ * as upon start-up and upon exit, the file is loaded, each property is
+ * read with getPropertyI/F (in an order different from the file),
+ * each property is set again with setPropertyI/F, and the file is saved.
+ *
+ * The same is done with a copy of the linked-list store that was used
+ * before the hash table ("before"), such that both can be compared on
+ * the same machine. The files written by both are checked to contain the
+ * same set of lines.
+ *
+ * Usage: propbench [-n entries] [-r repetitions]
+ *
+ *  -n entries      number of properties (default 5000)
+ *  -r repetitions  number of runs, the best one is reported (default 5)
+ *
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "discovered.h"
+#include "message.h"
+#include "property.h"
+
+//
+// property.c only needs these for the Saturn "old-style" file name
+// and for logging
+//
+DISCOVERED *radio = NULL;
+
+void t_print(const gchar *format, ...) {
+}
+
+void t_perror(const gchar *string) {
+  perror(string);
+}
+
+static double now_msec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return 1.0E3 * ts.tv_sec + 1.0E-6 * ts.tv_nsec;
+}
+
+//
+// Reference: the linked-list store as it was before the hash table
+// (prepend on load, linear search on get/set, unsorted save)
+//
+typedef struct _ref_property {
+  char *name;
+  char *value;
+  struct _ref_property *next;
+} REF_PROPERTY;
+
+static REF_PROPERTY *ref_properties = NULL;
+
+static void ref_clear() {
+  while (ref_properties != NULL) {
+    REF_PROPERTY *next = ref_properties->next;
+    g_free(ref_properties->name);
+    g_free(ref_properties->value);
+    free(ref_properties);
+    ref_properties = next;
+  }
+}
+
+static void ref_load(const char *filename) {
+  FILE *f = fopen(filename, "r");
+  char string[256];
+  ref_clear();
+
+  if (f == NULL) { return; }
+
+  while (fgets(string, sizeof(string), f)) {
+    if (string[0] != '#') {
+      const char *name = strtok(string, "=");
+      const char *value = strtok(NULL, "\n");
+
+      if (name != NULL && value != NULL) {
+        REF_PROPERTY *property = malloc(sizeof(REF_PROPERTY));
+        property->name = g_strdup(name);
+        property->value = g_strdup(value);
+        property->next = ref_properties;
+        ref_properties = property;
+      }
+    }
+  }
+
+  fclose(f);
+}
+
+static char *ref_get(const char *name) {
+  for (REF_PROPERTY *property = ref_properties; property; property = property->next) {
+    if (strcmp(name, property->name) == 0) { return property->value; }
+  }
+
+  return NULL;
+}
+
+static void ref_set(const char *name, const char *value) {
+  REF_PROPERTY *property = ref_properties;
+
+  while (property && strcmp(name, property->name) != 0) {
+    property = property->next;
+  }
+
+  if (property) {
+    g_free(property->value);
+    property->value = g_strdup(value);
+  } else {
+    property = malloc(sizeof(REF_PROPERTY));
+    property->name = g_strdup(name);
+    property->value = g_strdup(value);
+    property->next = ref_properties;
+    ref_properties = property;
+  }
+}
+
+static void ref_save(const char *filename) {
+  FILE *f = fopen(filename, "w+");
+  char line[512];
+
+  if (f == NULL) { return; }
+
+  snprintf(line, sizeof(line), "%0.2f", PROPERTY_VERSION);
+  ref_set("property_version", line);
+
+  for (const REF_PROPERTY *property = ref_properties; property; property = property->next) {
+    snprintf(line, sizeof(line), "%s=%s\n", property->name, property->value);
+    fwrite(line, 1, strlen(line), f);
+  }
+
+  fclose(f);
+}
+
+//
+// The test data: half of the properties are integers, half are floats
+//
+static char **names;
+static int count;
+
+static void make_names(int n) {
+  static const char *prefix[] = { "receiver", "band", "bandstack", "transmitter", "midi", "vfo" };
+  static const char *suffix[] = { "frequency", "mode", "filter", "agc_gain", "panadapter_low", "nr2_gain",
+                                  "squelch", "attenuation", "zoom", "pan"
+                                };
+  count = n;
+  names = g_new(char *, n);
+
+  for (int i = 0; i < n; i++) {
+    names[i] = g_strdup_printf("%s.%d.%d.%s", prefix[i % 6], (i / 60) % 100, i / 6000, suffix[(i / 6) % 10]);
+  }
+}
+
+static void write_props(const char *filename) {
+  FILE *f = fopen(filename, "w");
+
+  if (f == NULL) {
+    perror("propbench");
+    exit(1);
+  }
+
+  fprintf(f, "property_version=%0.2f\n", PROPERTY_VERSION);
+
+  for (int i = 0; i < count; i++) {
+    if (i & 1) {
+      fprintf(f, "%s=%f\n", names[i], 0.25 * i);
+    } else {
+      fprintf(f, "%s=%d\n", names[i], 7 * i);
+    }
+  }
+
+  fclose(f);
+}
+
+//
+// The properties are read in a different order than in the file,
+// as done by the various restore_state functions (7919 is prime, so
+// this is a permutation unless count is a multiple of it).
+//
+static int order(int i) {
+  if (count % 7919 == 0) { return i; }
+
+  return (int)(((long long) i * 7919) % count);
+}
+
+typedef struct _timing {
+  double load, get, set, save;
+} TIMING;
+
+static void run_new(const char *in, const char *out, TIMING *t) {
+  double t0 = now_msec();
+  loadProperties(in);
+  double t1 = now_msec();
+  long long sum = 0;
+
+  for (int i = 0; i < count; i++) {
+    int k = order(i);
+
+    if (k & 1) {
+      double value;
+
+      if (getPropertyF(names[k], &value)) { sum += (long long) value; }
+    } else {
+      long long value;
+
+      if (getPropertyI(names[k], &value)) { sum += value; }
+    }
+  }
+
+  double t2 = now_msec();
+
+  for (int i = 0; i < count; i++) {
+    int k = order(i);
+
+    if (k & 1) {
+      setPropertyF(names[k], 0.25 * k);
+    } else {
+      setPropertyI(names[k], 7 * k);
+    }
+  }
+
+  double t3 = now_msec();
+  saveProperties(out);
+  double t4 = now_msec();
+
+  if (sum == 0) { printf("propbench: no properties read\n"); }
+
+  t->load = t1 - t0;
+  t->get = t2 - t1;
+  t->set = t3 - t2;
+  t->save = t4 - t3;
+}
+
+static void run_ref(const char *in, const char *out, TIMING *t) {
+  char s[64];
+  double t0 = now_msec();
+  ref_load(in);
+  double t1 = now_msec();
+  long long sum = 0;
+
+  for (int i = 0; i < count; i++) {
+    int k = order(i);
+    const char *value = ref_get(names[k]);
+
+    if (value) { sum += (k & 1) ? (long long) atof(value) : atoll(value); }
+  }
+
+  double t2 = now_msec();
+
+  for (int i = 0; i < count; i++) {
+    int k = order(i);
+
+    if (k & 1) {
+      snprintf(s, sizeof(s), "%f", 0.25 * k);
+    } else {
+      snprintf(s, sizeof(s), "%d", 7 * k);
+    }
+
+    ref_set(names[k], s);
+  }
+
+  double t3 = now_msec();
+  ref_save(out);
+  double t4 = now_msec();
+
+  if (sum == 0) { printf("propbench: no properties read\n"); }
+
+  t->load = t1 - t0;
+  t->get = t2 - t1;
+  t->set = t3 - t2;
+  t->save = t4 - t3;
+}
+
+static void best(TIMING *b, const TIMING *t) {
+  if (t->load < b->load) { b->load = t->load; }
+
+  if (t->get < b->get) { b->get = t->get; }
+
+  if (t->set < b->set) { b->set = t->set; }
+
+  if (t->save < b->save) { b->save = t->save; }
+}
+
+static void report(const char *label, const TIMING *t) {
+  printf("%-7s load %8.2f  get %8.2f  set %8.2f  save %8.2f  total %8.2f msec\n", label, t->load, t->get, t->set,
+         t->save, t->load + t->get + t->set + t->save);
+}
+
+static int compare_lines(const void *a, const void *b) {
+  return strcmp(*(const gchar * const *)a, *(const gchar * const *)b);
+}
+
+//
+// Both files must contain the same lines (the order differs)
+//
+static int compare_files(const char *a, const char *b) {
+  gchar *ca, *cb;
+  int same = 0;
+
+  if (g_file_get_contents(a, &ca, NULL, NULL) && g_file_get_contents(b, &cb, NULL, NULL)) {
+    gchar **la = g_strsplit(ca, "\n", -1);
+    gchar **lb = g_strsplit(cb, "\n", -1);
+    guint na = g_strv_length(la);
+    guint nb = g_strv_length(lb);
+    qsort(la, na, sizeof(gchar *), compare_lines);
+    qsort(lb, nb, sizeof(gchar *), compare_lines);
+    same = (na == nb);
+
+    for (guint i = 0; same && i < na; i++) {
+      same = !strcmp(la[i], lb[i]);
+    }
+
+    g_strfreev(la);
+    g_strfreev(lb);
+    g_free(cb);
+    g_free(ca);
+  }
+
+  return same;
+}
+
+int main(int argc, char **argv) {
+  int n = 5000;
+  int reps = 5;
+  int opt;
+  char dir[] = "/tmp/propbenchXXXXXX";
+  char in[64], out_new[64], out_ref[64];
+  TIMING t, b_new, b_ref;
+
+  while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+    switch (opt) {
+    case 'n':
+      n = atoi(optarg);
+      break;
+
+    case 'r':
+      reps = atoi(optarg);
+      break;
+
+    default:
+      fprintf(stderr, "Usage: %s [-n entries] [-r repetitions]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (n < 1) { n = 1; }
+
+  if (reps < 1) { reps = 1; }
+
+  if (mkdtemp(dir) == NULL) {
+    perror("propbench");
+    return 1;
+  }
+
+  snprintf(in, sizeof(in), "%s/in.props", dir);
+  snprintf(out_new, sizeof(out_new), "%s/new.props", dir);
+  snprintf(out_ref, sizeof(out_ref), "%s/ref.props", dir);
+  make_names(n);
+  write_props(in);
+  b_new.load = b_new.get = b_new.set = b_new.save = 1.0E30;
+  b_ref = b_new;
+
+  for (int r = 0; r < reps; r++) {
+    run_ref(in, out_ref, &t);
+    best(&b_ref, &t);
+    run_new(in, out_new, &t);
+    best(&b_new, &t);
+  }
+
+  int same = compare_files(out_ref, out_new);
+  printf("%d properties, best of %d runs:\n", n, reps);
+  report("before", &b_ref);
+  report("after", &b_new);
+  printf("saved files %s\n", same ? "agree" : "DIFFER");
+  ref_clear();
+  clearProperties();
+  unlink(in);
+  unlink(out_new);
+  unlink(out_ref);
+  rmdir(dir);
+
+  for (int i = 0; i < n; i++) {
+    g_free(names[i]);
+  }
+
+  g_free(names);
+  return same ? 0 : 1;
+}
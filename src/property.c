@@ -24,22 +24,59 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "property.h"
 #include "radio.h"
 #include "message.h"
 
-PROPERTY* properties = NULL;
+//
+// The properties are kept in a hash table, which maps the name
+// to a PROPERTY. The name string is owned by the PROPERTY and
+// also serves as the hash key.
+//
+static GHashTable *properties = NULL;
 
-void clearProperties() {
-  if (properties != NULL) {
-    // free all the properties
-    PROPERTY *next;
+static void freeProperty(gpointer data) {
+  PROPERTY *property = (PROPERTY *)data;
+  g_free(property->name);
+  g_free(property->value);
+  g_free(property);
+}
+
+static void putProperty(const char *name, const char *value) {
+  if (properties == NULL) {
+    properties = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, freeProperty);
+  }
 
-    while (properties != NULL) {
-      next = properties->next_property;
-      free(properties);
-      properties = next;
+  PROPERTY *property = g_hash_table_lookup(properties, name);
+
+  if (property) {
+    size_t len = strlen(value);
+
+    if (strcmp(property->value, value) == 0) {
+      return;
     }
+
+    if (len < property->size) {
+      // re-use the value buffer
+      memcpy(property->value, value, len + 1);
+    } else {
+      g_free(property->value);
+      property->value = g_strdup(value);
+      property->size = len + 1;
+    }
+  } else {
+    property = g_new(PROPERTY, 1);
+    property->name = g_strdup(name);
+    property->value = g_strdup(value);
+    property->size = strlen(value) + 1;
+    g_hash_table_insert(properties, property->name, property);
+  }
+}
+
+void clearProperties() {
+  if (properties != NULL) {
+    g_hash_table_remove_all(properties);
   }
 }
 
@@ -51,7 +88,6 @@ void clearProperties() {
 */
 void loadProperties(const char* filename) {
   FILE* f = fopen(filename, "r");
-  PROPERTY* property;
   // t_print("loadProperties: %s\n", filename);
   int lines = 0;
   clearProperties();
@@ -98,11 +134,7 @@ void loadProperties(const char* filename) {
 
         // Beware of "illegal" lines in corrupted files
         if (name != NULL && value != NULL) {
-          property = malloc(sizeof(PROPERTY));
-          property->name = g_strdup(name);
-          property->value = g_strdup(value);
-          property->next_property = properties;
-          properties = property;
+          putProperty(name, value);
 
           if (strcmp(name, "property_version") == 0) {
             version = atof(value);
@@ -112,7 +144,7 @@ void loadProperties(const char* filename) {
     }
 
     if (version >= 0.0 && version != PROPERTY_VERSION) {
-      properties = NULL;
+      clearProperties();
       t_print("loadProperties: version=%f expected version=%f ignoring\n", version, PROPERTY_VERSION);
     }
 
@@ -126,29 +158,44 @@ void loadProperties(const char* filename) {
 /**
 * @brief Save Properties
 *
+* The properties are written, sorted by name, to a temporary file
+* which is then renamed. So a crash while saving leaves either the
+* old or the new file, but never a truncated one.
+*
 * @param filename
 */
 void saveProperties(const char* filename) {
-  PROPERTY* property;
-  FILE* f = fopen(filename, "w+");
-  char line[512];
+  char tmpname[512];
+  char line[32];
+  int rc;
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+  FILE* f = fopen(tmpname, "w");
 
   if (!f) {
-    t_print("can't open %s\n", filename);
+    t_print("can't open %s\n", tmpname);
     return;
   }
 
-  snprintf(line, 512, "%0.2f", PROPERTY_VERSION);
+  snprintf(line, sizeof(line), "%0.2f", PROPERTY_VERSION);
   setProperty("property_version", line);
-  property = properties;
+  GList *names = g_list_sort(g_hash_table_get_keys(properties), (GCompareFunc) strcmp);
 
-  while (property) {
-    snprintf(line, 512, "%s=%s\n", property->name, property->value);
-    fwrite(line, 1, strlen(line), f);
-    property = property->next_property;
+  for (const GList *l = names; l; l = l->next) {
+    const PROPERTY *property = g_hash_table_lookup(properties, l->data);
+    fprintf(f, "%s=%s\n", property->name, property->value);
   }
 
-  fclose(f);
+  g_list_free(names);
+  rc = fflush(f);
+
+  if (rc == 0) { rc = fsync(fileno(f)); }
+
+  if (fclose(f) != 0) { rc = -1; }
+
+  if (rc != 0 || rename(tmpname, filename) != 0) {
+    t_print("%s: could not write %s\n", __FUNCTION__, filename);
+    unlink(tmpname);
+  }
 }
 
 /* --------------------------------------------------------------------------*/
@@ -160,19 +207,8 @@ void saveProperties(const char* filename) {
 * @return
 */
 char* getProperty(const char* name) {
-  char* value = NULL;
-  PROPERTY* property = properties;
-
-  while (property) {
-    if (strcmp(name, property->name) == 0) {
-      value = property->value;
-      break;
-    }
-
-    property = property->next_property;
-  }
-
-  return value;
+  const PROPERTY* property = properties ? g_hash_table_lookup(properties, name) : NULL;
+  return property ? property->value : NULL;
 }
 
 /* --------------------------------------------------------------------------*/
@@ -183,28 +219,44 @@ char* getProperty(const char* name) {
 * @param value
 */
 void setProperty(const char* name, const char* value) {
-  PROPERTY* property = properties;
+  putProperty(name, value);
+}
 
-  while (property) {
-    if (strcmp(name, property->name) == 0) {
-      break;
-    }
+//
+// Typed accessors. The get functions return 1 and store the value
+// if the property exists, and return 0 otherwise.
+// The set functions format the value into a local buffer, so
+// no memory is allocated if the property exists and its value
+// has not become longer.
+//
+int getPropertyI(const char* name, long long *value) {
+  const char *s = getProperty(name);
 
-    property = property->next_property;
-  }
+  if (s == NULL) { return 0; }
 
-  if (property) {
-    // just update
-    free(property->value);
-    property->value = g_strdup(value);
-  } else {
-    // new property
-    property = malloc(sizeof(PROPERTY));
-    property->name = g_strdup(name);
-    property->value = g_strdup(value);
-    property->next_property = properties;
-    properties = property;
-  }
+  *value = atoll(s);
+  return 1;
+}
+
+int getPropertyF(const char* name, double *value) {
+  const char *s = getProperty(name);
+
+  if (s == NULL) { return 0; }
+
+  *value = myatof(s);
+  return 1;
+}
+
+void setPropertyI(const char* name, long long value) {
+  char s[32];
+  snprintf(s, sizeof(s), "%lld", value);
+  putProperty(name, s);
+}
+
+void setPropertyF(const char* name, double value) {
+  char s[64];
+  snprintf(s, sizeof(s), "%f", value);
+  putProperty(name, s);
 }
 
 //
@@ -216,15 +268,18 @@ void setProperty(const char* name, const char* value) {
 // decimal points and then this is fed to atof()
 //
 double myatof(const char* string) {
-  char *lstr = strdup(string);
-  double ret;
+  char lstr[64];
+
+  if (strchr(string, ',') == NULL) {
+    return atof(string);
+  }
+
+  g_strlcpy(lstr, string, sizeof(lstr));
 
   for (char *cp = lstr; *cp; cp++) {
     if (*cp == ',') { *cp = '.'; }
   }
 
-  ret = atof(lstr);
-  free(lstr);
-  return ret;
+  return atof(lstr);
 }
 
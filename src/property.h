@@ -29,7 +29,7 @@ typedef struct _PROPERTY PROPERTY;
 struct _PROPERTY {
   char* name;
   char* value;
-  PROPERTY* next_property;
+  size_t size;               // allocated size of value
 };
 
 extern void clearProperties(void);
@@ -38,6 +38,10 @@ extern char* getProperty(const char* name);
 extern void setProperty(const char* name, const char* value);
 extern void saveProperties(const char* filename);
 extern double myatof(const char* string);
+extern int getPropertyI(const char* name, long long *value);
+extern int getPropertyF(const char* name, double *value);
+extern void setPropertyI(const char* name, long long value);
+extern void setPropertyF(const char* name, double value);
 
 //
 // Some macros to get/set properties.
@@ -54,13 +58,13 @@ extern double myatof(const char* string);
 //
 
 #define GetPropI0(a,b)  { \
-  const char *value=getProperty(a); \
-  if (value) { b = atoll(value); } \
+  long long value; \
+  if (getPropertyI(a, &value)) { b = value; } \
 }
 
 #define GetPropF0(a,b)  { \
-  const char *value=getProperty(a); \
-  if (value) { b = myatof(value); } \
+  double value; \
+  if (getPropertyF(a, &value)) { b = value; } \
 }
 
 #define GetPropS0(a,b)  { \
@@ -76,15 +80,15 @@ extern double myatof(const char* string);
 #define GetPropI1(a,b,c) { \
   char name[128]; \
   snprintf(name, sizeof(name), a, b); \
-  const char *value=getProperty(name); \
-  if (value) { c = atoll(value); } \
+  long long value; \
+  if (getPropertyI(name, &value)) { c = value; } \
 }
 
 #define GetPropF1(a,b,c) { \
   char name[128]; \
   snprintf(name, sizeof(name), a, b); \
-  const char *value=getProperty(name); \
-  if (value) { c = myatof(value); } \
+  double value; \
+  if (getPropertyF(name, &value)) { c = value; } \
 }
 
 #define GetPropS1(a,b,c) { \
@@ -104,15 +108,15 @@ extern double myatof(const char* string);
 #define GetPropI2(a,b,c,d) { \
   char name[128]; \
   snprintf(name, sizeof(name), a, b, c); \
-  const char *value=getProperty(name); \
-  if (value) { d = atoll(value); } \
+  long long value; \
+  if (getPropertyI(name, &value)) { d = value; } \
 }
 
 #define GetPropF2(a,b,c,d) { \
   char name[128]; \
   snprintf(name, sizeof(name), a, b, c); \
-  const char *value=getProperty(name); \
-  if (value) { d = myatof(value); } \
+  double value; \
+  if (getPropertyF(name, &value)) { d = value; } \
 }
 
 #define GetPropS2(a,b,c,d) { \
@@ -132,8 +136,8 @@ extern double myatof(const char* string);
 #define GetPropI3(a,b,c,d, e) { \
   char name[128]; \
   snprintf(name, sizeof(name), a, b, c, d); \
-  const char *value=getProperty(name); \
-  if (value) { e = atoll(value); } \
+  long long value; \
+  if (getPropertyI(name, &value)) { e = value; } \
 }
 
 #define GetPropS3(a,b,c,d, e) { \
@@ -151,15 +155,11 @@ extern double myatof(const char* string);
 }
 
 #define SetPropI0(a,b) { \
-  char value[128]; \
-  snprintf(value, sizeof(value), "%lld", (long long)(b)); \
-  setProperty(a, value); \
+  setPropertyI(a, (long long)(b)); \
 }
 
 #define SetPropF0(a,b) { \
-  char value[128]; \
-  snprintf(value, sizeof(value), "%f", (double) (b)); \
-  setProperty(a, value); \
+  setPropertyF(a, (double)(b)); \
 }
 
 #define SetPropS0(a,b) { \
@@ -168,18 +168,14 @@ extern double myatof(const char* string);
 
 #define SetPropI1(a,b,c) { \
   char name[128]; \
-  char value[128]; \
   snprintf(name, sizeof(name), a, b); \
-  snprintf(value, sizeof(value), "%lld", (long long) (c)); \
-  setProperty(name, value); \
+  setPropertyI(name, (long long)(c)); \
 }
 
 #define SetPropF1(a,b,c) { \
   char name[128]; \
-  char value[128]; \
   snprintf(name, sizeof(name), a, b); \
-  snprintf(value, sizeof(value), "%f", (double) (c)); \
-  setProperty(name, value); \
+  setPropertyF(name, (double)(c)); \
 }
 
 #define SetPropS1(a,b,c) { \
@@ -198,18 +194,14 @@ extern double myatof(const char* string);
 
 #define SetPropI2(a,b,c,d) { \
   char name[128]; \
-  char value[128]; \
   snprintf(name, sizeof(name), a, b, c); \
-  snprintf(value, sizeof(value), "%lld", (long long) (d)); \
-  setProperty(name, value); \
+  setPropertyI(name, (long long)(d)); \
 }
 
 #define SetPropF2(a,b,c,d) { \
   char name[128]; \
-  char value[128]; \
   snprintf(name, sizeof(name), a, b, c); \
-  snprintf(value, sizeof(value), "%f", (double) (d)); \
-  setProperty(name, value); \
+  setPropertyF(name, (double)(d)); \
 }
 
 #define SetPropS2(a,b,c,d) { \
@@ -228,10 +220,8 @@ extern double myatof(const char* string);
 
 #define SetPropI3(a,b,c,d, e) { \
   char name[128]; \
-  char value[128]; \
   snprintf(name, sizeof(name), a, b, c, d); \
-  snprintf(value, sizeof(value), "%lld", (long long) (e)); \
-  setProperty(name, value); \
+  setPropertyI(name, (long long)(e)); \
 }
 
 #define SetPropS3(a,b,c,d, e) { \
@@ -711,16 +711,12 @@ int cw_audio_write(RECEIVER *rx, float sample) {
   return result;
 }
 
-int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
-  int result = 0;
+//
+// Put one stereo sample into the local audio buffer, and send the buffer
+// to the stream if it is full. Must be called with rx->local_audio_mutex locked.
+//
+static void audio_put_sample(RECEIVER *rx, float left_sample, float right_sample) {
   int err;
-  int txmode = vfo_get_tx_mode();
-
-  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
-    return 0;
-  }
-
-  g_mutex_lock(&rx->local_audio_mutex);
 
   if (rx->playstream != NULL && rx->local_audio_buffer != NULL) {
     //
@@ -744,7 +740,38 @@ int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
       rx->local_audio_buffer_offset = 0;
     }
   }
+}
+
+int audio_write(RECEIVER *rx, float left_sample, float right_sample) {
+  int txmode = vfo_get_tx_mode();
+
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    return 0;
+  }
 
+  g_mutex_lock(&rx->local_audio_mutex);
+  audio_put_sample(rx, left_sample, right_sample);
   g_mutex_unlock(&rx->local_audio_mutex);
-  return result;
+  return 0;
+}
+
+//
+// Block version of audio_write: lr contains frames interleaved
+// stereo samples. The mutex is only taken once per block.
+//
+int audio_write_block(RECEIVER *rx, const float *lr, int frames) {
+  int txmode = vfo_get_tx_mode();
+
+  if (rx == active_receiver && radio_is_transmitting() && (txmode == modeCWU || txmode == modeCWL)) {
+    return 0;
+  }
+
+  g_mutex_lock(&rx->local_audio_mutex);
+
+  for (int i = 0; i < frames; i++) {
+    audio_put_sample(rx, lr[2 * i], lr[2 * i + 1]);
+  }
+
+  g_mutex_unlock(&rx->local_audio_mutex);
+  return 0;
 }
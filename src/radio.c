@@ -391,6 +391,38 @@ double drive_digi_max = 100.0; // maximum drive in DIGU/DIGL
 gboolean display_warnings = TRUE;
 gboolean display_pacurr = TRUE;
 
+//
+// Tuning of the UDP data socket (P1 and P2).
+// udp_batch_receive: receive a batch of packets with a single recvmmsg() call
+//                    (Linux only, on other systems this has no effect)
+// udp_rcvbuf:        size of the socket receive buffer (SO_RCVBUF)
+// udp_busy_poll:     if non-zero, busy-poll the device queue for this amount
+//                    of usecs (SO_BUSY_POLL, Linux only)
+//
+int udp_batch_receive = 1;
+int udp_rcvbuf = 0x40000;
+int udp_busy_poll = 0;
+
+//
+// P2 only: the DDC IQ threads are woken up when this many packets
+// are queued in their input ring (1 = wake on every empty -> non-empty
+// transition). Larger values mean less context switches but more latency.
+//
+int p2_iq_wake_level = 1;
+
+//
+// P1 only: if set, the RX IQ samples of each receiver are processed
+// by a worker thread of its own (this takes effect upon protocol init)
+//
+int p1_rx_workers = 1;
+
+//
+// If set, WDSP work items (the analyzer sub-FFTs) are executed
+// asynchronously by its thread pool, otherwise the dispatcher
+// waits for each of them.
+//
+int wdsp_pool_async = 0;
+
 gint window_x_pos = 0;
 gint window_y_pos = 0;
 
@@ -438,6 +470,19 @@ void radio_stop() {
     t_print("radio_stop: RX id=%d: close\n", receiver[i]->id);
     rx_close(receiver[i]);
   }
+
+#ifndef EXTNR
+  {
+    int threads, depth, max_depth;
+    long items, inline_items;
+    double avg_wait, max_wait, avg_run;
+    GetWDSPPoolStats(&threads, &depth, &max_depth, &items, &inline_items, &avg_wait, &max_wait, &avg_run);
+    t_print("radio_stop: WDSP pool: threads=%d depth=%d max_depth=%d items=%ld inline=%ld\n",
+            threads, depth, max_depth, items, inline_items);
+    t_print("radio_stop: WDSP pool: wait avg=%.1f max=%.1f usec, run avg=%.1f usec\n",
+            avg_wait, max_wait, avg_run);
+  }
+#endif
 }
 
 /*
@@ -2104,9 +2149,19 @@ void radio_start_radio() {
   // receivers = RECEIVERS;
   receivers = 1; // we start ever with only one RX
   radio_restore_state();
+#ifndef EXTNR
+  SetWDSPPoolAsync(wdsp_pool_async);
+#endif
   radio_change_region(region);
   radio_create_visual();
   radio_reconfigure_screen();
+#ifndef EXTNR
+  //
+  // The WDSP channels are open now. If WDSP builds the FFTW wisdom
+  // in the background, it starts with the filter sizes in use.
+  //
+  WDSPwisdom_refine_start();
+#endif
 #ifdef TCI
 
   if (tci_enable) {
@@ -3279,6 +3334,17 @@ static void radio_restore_state() {
   GetPropI0("mute_rx_while_transmitting",                    mute_rx_while_transmitting);
   GetPropI0("radio.display_warnings",                        display_warnings);
   GetPropI0("radio.display_pacurr",                          display_pacurr);
+  GetPropI0("radio.udp_batch_receive",                       udp_batch_receive);
+  GetPropI0("radio.udp_rcvbuf",                              udp_rcvbuf);
+  GetPropI0("radio.udp_busy_poll",                           udp_busy_poll);
+  GetPropI0("radio.p2_iq_wake_level",                        p2_iq_wake_level);
+
+  if (p2_iq_wake_level < 1) { p2_iq_wake_level = 1; }
+
+  if (p2_iq_wake_level > RXIQRINGBUFLEN / 2) { p2_iq_wake_level = RXIQRINGBUFLEN / 2; }
+
+  GetPropI0("radio.p1_rx_workers",                           p1_rx_workers);
+  GetPropI0("radio.wdsp_pool_async",                         wdsp_pool_async);
 #ifdef TCI
   GetPropI0("tci_enable",                                  tci_enable);
   GetPropI0("tci_port",                                    tci_port);
@@ -3543,6 +3609,12 @@ void radio_save_state() {
   SetPropI0("mute_rx_while_transmitting",                    mute_rx_while_transmitting);
   SetPropI0("radio.display_warnings",                        display_warnings);
   SetPropI0("radio.display_pacurr",                          display_pacurr);
+  SetPropI0("radio.udp_batch_receive",                       udp_batch_receive);
+  SetPropI0("radio.udp_rcvbuf",                              udp_rcvbuf);
+  SetPropI0("radio.udp_busy_poll",                           udp_busy_poll);
+  SetPropI0("radio.p2_iq_wake_level",                        p2_iq_wake_level);
+  SetPropI0("radio.p1_rx_workers",                           p1_rx_workers);
+  SetPropI0("radio.wdsp_pool_async",                         wdsp_pool_async);
 #ifdef TCI
   SetPropI0("tci_enable",                                  tci_enable);
   SetPropI0("tci_port",                                    tci_port);
@@ -326,6 +326,13 @@ extern double drive_digi_max;    // maximum value allowed in DIGU/DIGL
 extern gboolean display_warnings;
 extern gboolean display_pacurr;
 
+extern int udp_batch_receive;    // use recvmmsg() for the data socket (Linux only)
+extern int udp_rcvbuf;           // SO_RCVBUF for the data socket
+extern int udp_busy_poll;        // SO_BUSY_POLL (usecs) for the data socket (Linux only)
+extern int p2_iq_wake_level;     // P2: wake DDC IQ thread when this many packets are queued
+extern int p1_rx_workers;        // P1: one worker thread per receiver for the RX IQ processing
+extern int wdsp_pool_async;      // WDSP thread pool executes work items asynchronously
+
 extern int hl2_audio_codec;
 extern int hl2_cl1_input;
 extern int anan10E;
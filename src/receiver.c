@@ -23,6 +23,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <wdsp.h>
 
@@ -54,6 +55,10 @@
 #include "ext.h"
 #include "new_menu.h"
 #include "message.h"
+#include "iqconv.h"
+#ifdef TCI
+  #include "tci.h"
+#endif
 
 #define min(x,y) (x<y?x:y)
 #define max(x,y) (x<y?y:x)
@@ -301,6 +306,7 @@ void rx_save_state(const RECEIVER *rx) {
   SetPropI1("receiver.%d.waterfall_low", rx->id,                rx->waterfall_low);
   SetPropI1("receiver.%d.waterfall_high", rx->id,               rx->waterfall_high);
   SetPropI1("receiver.%d.waterfall_automatic", rx->id,          rx->waterfall_automatic);
+  SetPropI1("receiver.%d.history_mb", rx->id,                   rx->history_mb);
 
   if (have_alex_att) {
     SetPropI1("receiver.%d.alex_attenuation", rx->id,           rx->alex_attenuation);
@@ -322,6 +328,7 @@ void rx_save_state(const RECEIVER *rx) {
   SetPropI1("receiver.%d.nr2_gain_method", rx->id,              rx->nr2_gain_method);
   SetPropI1("receiver.%d.nr2_npe_method", rx->id,               rx->nr2_npe_method);
   SetPropI1("receiver.%d.nr2_ae", rx->id,                       rx->nr2_ae);
+  SetPropI1("receiver.%d.nr2_fast_gain", rx->id,                rx->nr2_fast_gain);
 
   if ((GetWDSPVersion() % 100) > 26) {
     SetPropI1("receiver.%d.nr2_post", rx->id,                   rx->nr2_post);
@@ -427,6 +434,7 @@ void rx_restore_state(RECEIVER *rx) {
   GetPropI1("receiver.%d.waterfall_low", rx->id,                rx->waterfall_low);
   GetPropI1("receiver.%d.waterfall_high", rx->id,               rx->waterfall_high);
   GetPropI1("receiver.%d.waterfall_automatic", rx->id,          rx->waterfall_automatic);
+  GetPropI1("receiver.%d.history_mb", rx->id,                   rx->history_mb);
 
   if (have_alex_att) {
     GetPropI1("receiver.%d.alex_attenuation", rx->id,           rx->alex_attenuation);
@@ -448,6 +456,7 @@ void rx_restore_state(RECEIVER *rx) {
   GetPropI1("receiver.%d.nr2_gain_method", rx->id,              rx->nr2_gain_method);
   GetPropI1("receiver.%d.nr2_npe_method", rx->id,               rx->nr2_npe_method);
   GetPropI1("receiver.%d.nr2_ae", rx->id,                       rx->nr2_ae);
+  GetPropI1("receiver.%d.nr2_fast_gain", rx->id,                rx->nr2_fast_gain);
 
   if ((GetWDSPVersion() % 100) > 26) {
     GetPropI1("receiver.%d.nr2_post", rx->id,                   rx->nr2_post);
@@ -791,6 +800,7 @@ RECEIVER *rx_create_receiver(int id, int pixels, int width, int height) {
   rx->panadapter_ovf_on  = 1;
   rx->panadapter_autoscale_enabled = 0;
   rx->waterfall_high = -55;
+  rx->history_mb = 8;
   rx->waterfall_low = -140;
   rx->waterfall_automatic = 1;
   rx->display_filled = 1;
@@ -810,6 +820,7 @@ RECEIVER *rx_create_receiver(int id, int pixels, int width, int height) {
   rx->nr2_gain_method = 2;          // Gamma
   rx->nr2_npe_method = 0;           // OSMS
   rx->nr2_ae = 1;                   // Artifact Elimination is "on"
+  rx->nr2_fast_gain = 0;            // exact special functions in the gain calculation
 
   if ((GetWDSPVersion() % 100) > 26) {
     rx->nr2_post = 0;
@@ -928,10 +939,13 @@ RECEIVER *rx_create_receiver(int id, int pixels, int width, int height) {
   rx->iq_input_buffer = g_new(double, 2 * rx->buffer_size);
   rx->pixels = pixels * rx->zoom;
   rx->pixel_samples = g_new(float, rx->pixels);
+  rx->history = spectrum_history_new(rx->history_mb);
   t_print("%s (after restore): id=%d local_audio=%d\n", __FUNCTION__, rx->id, rx->local_audio);
   int scale = rx->sample_rate / 48000;
   rx->output_samples = rx->buffer_size / scale;
   rx->audio_output_buffer = g_new(double, 2 * rx->output_samples);
+  rx->local_audio_block = g_new(float, 2 * rx->output_samples);
+  rx->radio_audio_block = g_new(short, 2 * rx->output_samples);
   t_print("%s: RXid=%d output_samples=%d audio_output_buffer=%p\n", __FUNCTION__, rx->id, rx->output_samples,
           rx->audio_output_buffer);
   rx->hz_per_pixel = (double)rx->sample_rate / (double)rx->pixels;
@@ -1134,97 +1148,116 @@ void rx_vfo_changed(RECEIVER *rx) {
 
 //////////////////////////////////////////////////////////////////////////////////////
 //
-// rx_add_iq_samples (rx_add_div_iq_samples),  rx_full_buffer, and rx_process_buffer
-// form the "RX engine".
+// rx_add_iq_samples (rx_add_div_iq_samples, and the block versions rx_add_iq_block etc.),
+// rx_full_buffer, and rx_process_buffer form the "RX engine".
 //
 //////////////////////////////////////////////////////////////////////////////////////
 
 static void rx_process_buffer(RECEIVER *rx) {
+  const double *out = rx->audio_output_buffer;
+  float *lr = rx->local_audio_block;
+  int n = rx->output_samples;
   double left_sample, right_sample;
-  short left_audio_sample, right_audio_sample;
   int i;
+  //
+  // All these conditions cannot change while processing one buffer,
+  // so evaluate them only once.
+  //
+  int silent = radio_is_transmitting() && (!duplex || mute_rx_while_transmitting);
+  int recording = (rx == active_receiver && capture_state == CAP_RECORDING);
+  int to_radio = (rx == active_receiver && !pre_mox);
 
   //t_print("%s: rx=%p id=%d output_samples=%d audio_output_buffer=%p\n",__FUNCTION__,rx,rx->id,rx->output_samples,rx->audio_output_buffer);
-  for (i = 0; i < rx->output_samples; i++) {
-    if (radio_is_transmitting() && (!duplex || mute_rx_while_transmitting)) {
-      left_sample = 0.0;
-      right_sample = 0.0;
-      left_audio_sample = 0;
-      right_audio_sample = 0;
-    } else {
-      left_sample = rx->audio_output_buffer[i * 2];
-      right_sample = rx->audio_output_buffer[(i * 2) + 1];
-      left_audio_sample = (short)(left_sample * 32767.0);
-      right_audio_sample = (short)(right_sample * 32767.0);
-    }
+  if (rx->local_audio) {
+    //
+    // Apply muting and channel selection to the whole buffer,
+    // and send it to the local audio device in one go
+    //
+    float lgain = 1.0F;
+    float rgain = 1.0F;
 
-    if (rx->local_audio) {
-      if (rx->mute_radio || (rx != active_receiver && rx->mute_when_not_active)) {
-        left_sample = 0.0;
-        right_sample = 0.0;
-      } else {
-        switch (rx->audio_channel) {
-        case STEREO:
-          break;
+    if (silent || rx->mute_radio || (rx != active_receiver && rx->mute_when_not_active)) {
+      lgain = 0.0F;
+      rgain = 0.0F;
+    } else {
+      switch (rx->audio_channel) {
+      case STEREO:
+        break;
 
-        case LEFT:
-          right_sample = 0.0;
-          break;
+      case LEFT:
+        rgain = 0.0F;
+        break;
 
-        case RIGHT:
-          left_sample = 0.0;
-          break;
-        }
+      case RIGHT:
+        lgain = 0.0F;
+        break;
       }
+    }
 
-      audio_write(rx, (float)left_sample, (float)right_sample);
+    for (i = 0; i < n; i++) {
+      lr[2 * i]     = lgain * (float)out[2 * i];
+      lr[2 * i + 1] = rgain * (float)out[2 * i + 1];
     }
 
-    if (rx == active_receiver && capture_state == CAP_RECORDING) {
+    audio_write_block(rx, lr, n);
+  }
+
+  if (recording) {
+    //
+    // normalize samples:
+    // when using AGC, the samples of strong s9 signals are about 0.8
+    //
+    double scale = 0.6 * pow(10.0, -0.05 * rx->volume);
+
+    for (i = 0; i < n; i++) {
       if (capture_record_pointer < capture_max) {
         //
-        // normalize samples:
-        // when using AGC, the samples of strong s9 signals are about 0.8
+        // the recorded audio is what goes to the local audio device
+        // (if there is one)
         //
-        double scale = 0.6 * pow(10.0, -0.05 * rx->volume);
+        if (rx->local_audio) {
+          left_sample = lr[2 * i];
+          right_sample = lr[2 * i + 1];
+        } else if (silent) {
+          left_sample = 0.0;
+          right_sample = 0.0;
+        } else {
+          left_sample = out[2 * i];
+          right_sample = out[2 * i + 1];
+        }
+
         capture_data[capture_record_pointer++] = scale * (left_sample + right_sample);
       } else {
         // switching the state to RECORD_DONE takes care that the
         // CAPTURE switch is "pressed" only once
         capture_state = CAP_RECORD_DONE;
         schedule_action(CAPTURE, PRESSED, 0);
+        break;
       }
     }
+  }
 
-    if (rx == active_receiver && !pre_mox) {
-      //
-      // Note the "Mute Radio" checkbox in the RX menu mutes the
-      // audio in the HPSDR data stream *only*, local audio is
-      // not affected.
-      //
-      switch (protocol) {
-      case ORIGINAL_PROTOCOL:
-        if (rx->mute_radio) {
-          old_protocol_audio_samples((short)0, (short)0);
-        } else {
-          old_protocol_audio_samples(left_audio_sample, right_audio_sample);
-        }
-
-        break;
-
-      case NEW_PROTOCOL:
-        if (rx->mute_radio) {
-          new_protocol_audio_samples((short)0, (short)0);
-        } else {
-          new_protocol_audio_samples(left_audio_sample, right_audio_sample);
-        }
-
-        break;
+  if (to_radio && (protocol == ORIGINAL_PROTOCOL || protocol == NEW_PROTOCOL)) {
+    //
+    // Note the "Mute Radio" checkbox in the RX menu mutes the
+    // audio in the HPSDR data stream *only*, local audio is
+    // not affected.
+    //
+    short *audio = rx->radio_audio_block;
 
-      case SOAPYSDR_PROTOCOL:
-        break;
+    if (rx->mute_radio || silent) {
+      memset(audio, 0, 2 * n * sizeof(short));
+    } else {
+      for (i = 0; i < 2 * n; i++) {
+        audio[i] = (short)(out[i] * 32767.0);
       }
     }
+
+    if (protocol == ORIGINAL_PROTOCOL) {
+      old_protocol_audio_block(audio, n);
+    } else {
+      new_protocol_audio_block(audio, n);
+    }
   }
 }
 
@@ -1237,6 +1270,13 @@ void rx_full_buffer(RECEIVER *rx) {
   // in this case we should not block the receiver thread
   //
   if (g_mutex_trylock(&rx->mutex)) {
+#ifdef TCI
+    //
+    // TCI IQ streaming uses the IQ samples before the noise blanker.
+    // This returns immediately if no TCI client wants them.
+    //
+    tci_rx_iq(rx->id, rx->iq_input_buffer, rx->buffer_size, rx->sample_rate);
+#endif
     //
     // noise blanker works on original IQ samples with input sample rate
     //
@@ -1260,6 +1300,10 @@ void rx_full_buffer(RECEIVER *rx) {
       t_print("%s: id=%d fexchange0: error=%d\n", __FUNCTION__, rx->id, error);
     }
 
+#ifdef TCI
+    tci_rx_audio(rx->id, rx->audio_output_buffer, rx->output_samples, 48000);
+#endif
+
     if (rx->displaying) {
       g_mutex_lock(&rx->display_mutex);
       Spectrum0(1, rx->id, 0, 0, rx->iq_input_buffer);
@@ -1309,6 +1353,83 @@ void rx_add_div_iq_samples(RECEIVER *rx, double i0, double q0, double i1, double
   rx_add_iq_samples(rx, i_sample, q_sample);
 }
 
+//
+// Block versions of rx_add_iq_samples. The protocol modules
+// deliver a complete packet at once, and the samples are moved
+// into rx->iq_input_buffer in chunks (each chunk ends either at
+// the end of the block or when the input buffer is full).
+// The TX/RX silencing is then a simple memset over the first
+// part of a chunk.
+//
+static void rx_silence_chunk(RECEIVER *rx, double *dst, int n) {
+  if (rx->txrxcount < rx->txrxmax) {
+    int m = min(rx->txrxmax - rx->txrxcount, n);
+    memset(dst, 0, 2 * m * sizeof(double));
+    rx->txrxcount += m;
+  }
+}
+
+static void rx_advance_chunk(RECEIVER *rx, int n) {
+  rx->samples += n;
+
+  if (rx->samples >= rx->buffer_size) {
+    rx_full_buffer(rx);
+    rx->samples = 0;
+  }
+}
+
+void rx_add_iq_block(RECEIVER *rx, const double *iq, int n) {
+  while (n > 0) {
+    int chunk = min(rx->buffer_size - rx->samples, n);
+    double *dst = rx->iq_input_buffer + 2 * rx->samples;
+    memcpy(dst, iq, 2 * chunk * sizeof(double));
+    rx_silence_chunk(rx, dst, chunk);
+    iq += 2 * chunk;
+    n -= chunk;
+    rx_advance_chunk(rx, chunk);
+  }
+}
+
+//
+// n samples, 24-bit big-endian I and Q each, as they come from the radio.
+// These are converted in place into rx->iq_input_buffer.
+//
+void rx_add_iq24_block(RECEIVER *rx, const unsigned char *buffer, int n) {
+  while (n > 0) {
+    int chunk = min(rx->buffer_size - rx->samples, n);
+    double *dst = rx->iq_input_buffer + 2 * rx->samples;
+    iqconv_unpack24(buffer, dst, 2 * chunk);
+    rx_silence_chunk(rx, dst, chunk);
+    buffer += 6 * chunk;
+    n -= chunk;
+    rx_advance_chunk(rx, chunk);
+  }
+}
+
+//
+// iq contains n frames of four values (i0, q0, i1, q1),
+// the diversity mixer is applied while copying
+//
+void rx_add_div_iq_block(RECEIVER *rx, const double *iq, int n) {
+  double c = div_cos;
+  double s = div_sin;
+
+  while (n > 0) {
+    int chunk = min(rx->buffer_size - rx->samples, n);
+    double *dst = rx->iq_input_buffer + 2 * rx->samples;
+
+    for (int i = 0; i < chunk; i++) {
+      dst[2 * i]     = iq[0] + (c * iq[2] - s * iq[3]);
+      dst[2 * i + 1] = iq[1] + (s * iq[2] + c * iq[3]);
+      iq += 4;
+    }
+
+    rx_silence_chunk(rx, dst, chunk);
+    n -= chunk;
+    rx_advance_chunk(rx, chunk);
+  }
+}
+
 void rx_update_zoom(RECEIVER *rx) {
   //
   // This is called whenever rx->zoom or rx->width changes,
@@ -1457,7 +1578,17 @@ void rx_change_sample_rate(RECEIVER *rx, int sample_rate) {
     g_free(rx->audio_output_buffer);
   }
 
+  if (rx->local_audio_block != NULL) {
+    g_free(rx->local_audio_block);
+  }
+
+  if (rx->radio_audio_block != NULL) {
+    g_free(rx->radio_audio_block);
+  }
+
   rx->audio_output_buffer = g_new(double, 2 * rx->output_samples);
+  rx->local_audio_block = g_new(float, 2 * rx->output_samples);
+  rx->radio_audio_block = g_new(short, 2 * rx->output_samples);
   rx_off(rx);
   rx_set_analyzer(rx);
   SetInputSamplerate(rx->id, sample_rate);
@@ -1489,9 +1620,103 @@ void rx_close(const RECEIVER *rx) {
 int rx_get_pixels(RECEIVER *rx) {
   int rc;
   GetPixels(rx->id, 0, rx->pixel_samples, &rc);
+
+  if (rc) {
+    rx->pixel_seq++;
+
+    //
+    // The PS feedback receiver has no history and no VFO of its own
+    //
+    if (rx->history != NULL && rx->id < MAX_VFOS) {
+      spectrum_history_add(rx->history, rx->pixel_samples, rx->pixels, vfo[rx->id].frequency, rx->sample_rate);
+    }
+  }
+
   return rc;
 }
 
+//
+// Noise floor estimate: the value at the given percentile (0...100) of
+// n spectrum pixels starting at rx->pixel_samples[offset] (in dB, without
+// calibration corrections).
+// This uses quickselect on a per-receiver scratch buffer, so there is
+// no allocation (except when the width grows) and the work is O(n).
+// The result is cached until the next spectrum frame, such that
+// the panadapter and waterfall can both use it at no extra cost.
+//
+float rx_noise_floor(RECEIVER *rx, int offset, int n, double percentile) {
+  if (n <= 0 || rx->pixel_samples == NULL || offset < 0 || offset + n > rx->pixels) { return -200.0F; }
+
+  if (rx->nf_seq == rx->pixel_seq && rx->nf_offset == offset && rx->nf_count == n
+      && rx->nf_percentile == percentile) {
+    return rx->nf_value;
+  }
+
+  if (n > rx->nf_scratch_len) {
+    rx->nf_scratch = g_renew(float, rx->nf_scratch, n);
+    rx->nf_scratch_len = n;
+  }
+
+  float *a = rx->nf_scratch;
+  memcpy(a, rx->pixel_samples + offset, n * sizeof(float));
+  int k = (int)((percentile / 100.0) * n);
+
+  if (k < 0) { k = 0; }
+
+  if (k > n - 1) { k = n - 1; }
+
+  //
+  // Hoare-style quickselect with median-of-three pivot:
+  // on return, a[k] holds the k-th smallest value
+  //
+  int lo = 0;
+  int hi = n - 1;
+
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    float t;
+
+    if (a[mid] < a[lo]) { t = a[mid]; a[mid] = a[lo]; a[lo] = t; }
+
+    if (a[hi] < a[lo]) { t = a[hi]; a[hi] = a[lo]; a[lo] = t; }
+
+    if (a[hi] < a[mid]) { t = a[hi]; a[hi] = a[mid]; a[mid] = t; }
+
+    float pivot = a[mid];
+    int i = lo;
+    int j = hi;
+
+    while (i <= j) {
+      while (a[i] < pivot) { i++; }
+
+      while (a[j] > pivot) { j--; }
+
+      if (i <= j) {
+        t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+        i++;
+        j--;
+      }
+    }
+
+    if (k <= j) {
+      hi = j;
+    } else if (k >= i) {
+      lo = i;
+    } else {
+      break;
+    }
+  }
+
+  rx->nf_seq = rx->pixel_seq;
+  rx->nf_offset = offset;
+  rx->nf_count = n;
+  rx->nf_percentile = percentile;
+  rx->nf_value = a[k];
+  return rx->nf_value;
+}
+
 double rx_get_smeter(const RECEIVER *rx) {
   double level;
 
@@ -1864,6 +2089,9 @@ void rx_set_noise(const RECEIVER *rx) {
   //
   SetRXAEMNRPosition(rx->id, rx->nr_agc);
   SetRXAEMNRgainMethod(rx->id, rx->nr2_gain_method);
+#ifndef EXTNR
+  SetRXAEMNRfastGain(rx->id, rx->nr2_fast_gain);
+#endif
   SetRXAEMNRnpeMethod(rx->id, rx->nr2_npe_method);
   SetRXAEMNRtrainZetaThresh(rx->id, rx->nr2_trained_threshold);
   SetRXAEMNRtrainT2(rx->id, rx->nr2_trained_t2);
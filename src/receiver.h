@@ -22,6 +22,7 @@
 #define _RECEIVER_H
 
 #include <gtk/gtk.h>
+#include "spectrum_history.h"
 #ifdef PORTAUDIO
   #include <portaudio.h>
 #endif
@@ -33,6 +34,12 @@
   #include <pulse/simple.h>
 #endif
 
+//
+// Percentile of the spectrum used as "noise floor" by panadapter
+// autoscale and the automatic waterfall
+//
+#define RX_NOISE_FLOOR_PERCENTILE 60.0
+
 enum _audio_channel_enum {
   STEREO = 0,
   LEFT,
@@ -68,6 +75,8 @@ typedef struct _receiver {
   int output_samples;
   double *iq_input_buffer;
   double *audio_output_buffer;
+  float *local_audio_block;   // output_samples stereo samples for audio_write_block
+  short *radio_audio_block;   // output_samples stereo samples for the radio audio stream
   int audio_index;
   float *pixel_samples;
   int display_panadapter;
@@ -117,10 +126,12 @@ typedef struct _receiver {
   //  Gain method: 0=GaussianSpeechLin, 1=GaussianSpeechLog, 2=GammaSpeech
   //  NPE  method: 0=OSMS, 1=MMSE
   //  AE         : Artifact elimination filter on(1)/off(0)
+  //  fast gain  : tabulated instead of exact special functions on(1)/off(0)
   //
   int nr2_gain_method;
   int nr2_npe_method;
   int nr2_ae;
+  int nr2_fast_gain;
   int nr2_post; // post-NR2 corrections on/off
   int nr2_post_nlevel;
   int nr2_post_factor;
@@ -194,7 +205,7 @@ typedef struct _receiver {
   int waterfall_high;
   int waterfall_automatic;
   cairo_surface_t *panadapter_surface;
-  GdkPixbuf *pixbuf;
+  cairo_surface_t *waterfall_surface;
   int local_audio;
   int mute_when_not_active;
   int audio_device;
@@ -242,6 +253,28 @@ typedef struct _receiver {
   int waterfall_sample_rate;
   int waterfall_pan;
   int waterfall_zoom;
+  int waterfall_row;        // surface row holding the most recent waterfall line
+  int waterfall_x;          // accumulated horizontal shift of the waterfall (pixels)
+  int *waterfall_row_x;     // value of waterfall_x when the row was drawn
+
+  //
+  // noise floor estimate (see rx_noise_floor), cached per spectrum frame
+  //
+  long pixel_seq;           // incremented whenever new pixel_samples arrive
+  float *nf_scratch;
+  int nf_scratch_len;
+  long nf_seq;
+  int nf_offset;
+  int nf_count;
+  double nf_percentile;
+  float nf_value;
+
+  //
+  // history of spectrum frames (see spectrum_history.h),
+  // history_mb is its memory budget (0: no history)
+  //
+  SPECTRUM_HISTORY *history;
+  int history_mb;
 
   int mute_radio;
 #ifdef __APPLE__
@@ -297,6 +330,9 @@ extern gboolean rx_scroll_event(GtkWidget *widget, const GdkEventScroll *event,
 
 extern void   rx_add_iq_samples(RECEIVER *rx, double i_sample, double q_sample);
 extern void   rx_add_div_iq_samples(RECEIVER *rx, double i0, double q0, double i1, double q1);
+extern void   rx_add_iq_block(RECEIVER *rx, const double *iq, int n);
+extern void   rx_add_iq24_block(RECEIVER *rx, const unsigned char *buffer, int n);
+extern void   rx_add_div_iq_block(RECEIVER *rx, const double *iq, int n);
 
 extern void   rx_change_sample_rate(RECEIVER *rx, int sample_rate);
 extern void   rx_change_adc(const RECEIVER *rx);
@@ -304,6 +340,7 @@ extern void   rx_close(const RECEIVER *rx);
 extern void   rx_create_analyzer(const RECEIVER *rx);
 extern void   rx_filter_changed(RECEIVER *rx);
 extern int    rx_get_pixels(RECEIVER *rx);
+extern float  rx_noise_floor(RECEIVER *rx, int offset, int n, double percentile);
 extern double rx_get_smeter(const RECEIVER *rx);
 extern void   rx_frequency_changed(RECEIVER *rx);
 extern void   rx_mode_changed(RECEIVER *rx);
@@ -82,6 +82,7 @@
 
 #include <netinet/in.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <json-c/json.h>
 
 unsigned int rigctl_tcp_port = 19090;
@@ -139,6 +140,22 @@ static char rigctld_path[PATH_MAX];
 static int server_socket = -1;
 static struct sockaddr_in server_address;
 
+//
+// CAT commands that have to be executed in the GTK main loop are passed there
+// in a COMMAND structure. These come from a small per-client pool which is
+// only allocated by the client thread and released by parse_cmd(). If the
+// pool is exhausted, a COMMAND is allocated with g_new as a fall-back.
+//
+#define RIGCTL_POOL 16
+
+typedef struct _command {
+  struct _client *client;
+  char *command;
+  int pooled;                       // from the client's pool
+  atomic_int in_use;                // pooled and not yet processed
+  char buf[MAXDATASIZE];
+} COMMAND;
+
 typedef struct _client {
   int fd;
   int fifo;                         // serial only: this is a FIFO and not a true serial line
@@ -155,6 +172,10 @@ typedef struct _client {
   int last_v;                       // Last push-button state received
   int last_fa, last_fb, last_md;    // last VFO-A/B frequency and VFO-A mode reported
   int last_led[MAX_ANDROMEDA_LEDS]; // last status of ANDROMEDA LEDs
+  atomic_int pending;               // commands queued to the GTK main loop, not yet done
+  long fast_count;                  // queries answered by the client thread
+  long slow_count;                  // commands executed in the GTK main loop
+  COMMAND pool[RIGCTL_POOL];        // command buffers
 } CLIENT;
 
 //
@@ -174,17 +195,41 @@ static uint8_t andromeda_vfo_speedup[32] = {  0,   1,   2,   3,   4,   5,   6,
                                               25,  29,  33,  38,  43,  48,  54,  61,
                                               69,  77,  85,  95, 105, 116, 128,   4
                                            };
-typedef struct _command {
-  CLIENT *client;
-  char *command;
-} COMMAND;
-
 static CLIENT tcp_client[MAX_TCP_CLIENTS]; // TCP clients
 static CLIENT serial_client[MAX_SERIAL];   // serial clienta
 SERIALPORT SerialPorts[MAX_SERIAL + 2];
 
 static gpointer rigctl_client (gpointer data);
 
+//
+// Snapshot of the radio state that is needed to answer the most
+// frequent read-only CAT queries (FA, FB, IF, MD, SM, ...).
+// It is written only from the GTK main loop (rigctl_snapshot_update)
+// and read lock-free by the client threads, using a sequence counter:
+// it is odd while the snapshot is being updated, and a reader retries
+// if it sees an odd or changed counter.
+//
+typedef struct _cat_snapshot {
+  int valid;
+  long long fa;                     // VFO-A frequency (CTUN frequency if CTUN is on)
+  long long fb;                     // VFO-B frequency (CTUN frequency if CTUN is on)
+  int mode_a;                       // VFO-A mode
+  long long step_a;                 // VFO-A step size
+  long long rit_a;                  // VFO-A rit value
+  int rit_enabled_a;                // VFO-A rit enabled
+  int xit_enabled;                  // TX VFO xit enabled
+  int ctcss_enabled;
+  int ctcss;
+  int transmitting;
+  int split;
+  int receivers;
+  double meter[2];
+} CAT_SNAPSHOT;
+
+static atomic_uint cat_snap_seq;
+static CAT_SNAPSHOT cat_snap;
+static guint cat_snap_timer = 0;
+
 //
 // This macro handles cases where RX2 is referred to but might not
 // exist. These macros lead to an action only  if the RX exists.
@@ -1540,8 +1585,10 @@ static gpointer rigctl_cw_thread(gpointer data) {
 
 static void send_resp (int fd, char * msg) {
   //
-  // send_resp is ONLY called from within the GTK event queue
-  // ==> no multi-thread problems can occur.
+  // send_resp is called from within the GTK event queue, and from
+  // the client threads for queries answered from the CAT snapshot.
+  // The latter only happens if the client has no commands pending in
+  // the GTK queue, so the responses to one client cannot be re-ordered.
   //
   if (fd == -1) {
     //
@@ -2013,6 +2060,263 @@ static gpointer rigctl_server(gpointer data) {
   return NULL;
 }
 
+//
+// Update the CAT snapshot. This must be called from the GTK main loop.
+//
+static void rigctl_snapshot_update() {
+  CAT_SNAPSHOT *s = &cat_snap;
+  unsigned int seq;
+
+  if (receivers <= 0 || receiver[0] == NULL) { return; }
+
+  seq = atomic_load_explicit(&cat_snap_seq, memory_order_relaxed);
+  atomic_store_explicit(&cat_snap_seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  s->fa = vfo[VFO_A].ctun ? vfo[VFO_A].ctun_frequency : vfo[VFO_A].frequency;
+  s->fb = vfo[VFO_B].ctun ? vfo[VFO_B].ctun_frequency : vfo[VFO_B].frequency;
+  s->mode_a = vfo[VFO_A].mode;
+  s->step_a = vfo[VFO_A].step;
+  s->rit_a = vfo[VFO_A].rit;
+  s->rit_enabled_a = vfo[VFO_A].rit_enabled;
+
+  if (can_transmit) {
+    s->xit_enabled   = vfo[vfo_get_tx_vfo()].xit_enabled;
+    s->ctcss         = transmitter->ctcss + 1;
+    s->ctcss_enabled = transmitter->ctcss_enabled;
+  } else {
+    s->xit_enabled   = 0;
+    s->ctcss         = 0;
+    s->ctcss_enabled = 0;
+  }
+
+  s->transmitting = radio_is_transmitting();
+  s->split = split;
+  s->receivers = receivers;
+
+  for (int id = 0; id < 2; id++) {
+    s->meter[id] = (id < receivers) ? receiver[id]->meter : -140.0;
+  }
+
+  s->valid = 1;
+  atomic_store_explicit(&cat_snap_seq, seq + 2, memory_order_release);
+}
+
+//
+// Periodic update of the snapshot, so changes made through the GUI
+// become visible for CAT queries. It stops itself when neither the
+// TCP server nor a serial client is running.
+//
+static gboolean rigctl_snapshot_timer(gpointer data) {
+  int active = tcp_running;
+
+  for (int id = 0; id < MAX_SERIAL; id++) {
+    active |= serial_client[id].running;
+  }
+
+  if (!active) {
+    unsigned int seq = atomic_load_explicit(&cat_snap_seq, memory_order_relaxed);
+    atomic_store_explicit(&cat_snap_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    cat_snap.valid = 0;
+    atomic_store_explicit(&cat_snap_seq, seq + 2, memory_order_release);
+    cat_snap_timer = 0;
+    return G_SOURCE_REMOVE;
+  }
+
+  rigctl_snapshot_update();
+  return G_SOURCE_CONTINUE;
+}
+
+static void rigctl_snapshot_start() {
+  if (cat_snap_timer == 0) {
+    cat_snap_timer = g_timeout_add(20, rigctl_snapshot_timer, NULL);
+  }
+}
+
+static int rigctl_snapshot_read(CAT_SNAPSHOT *s) {
+  for (int tries = 0; tries < 100; tries++) {
+    unsigned int seq = atomic_load_explicit(&cat_snap_seq, memory_order_acquire);
+
+    if (seq & 1) { continue; }
+
+    memcpy(s, &cat_snap, sizeof(CAT_SNAPSHOT));
+    atomic_thread_fence(memory_order_acquire);
+
+    if (atomic_load_explicit(&cat_snap_seq, memory_order_relaxed) == seq) {
+      return s->valid;
+    }
+  }
+
+  return 0;
+}
+
+//
+// Classification of incoming commands: these read-only queries
+// can be answered from the snapshot, everything else goes to parse_cmd().
+//
+enum CatQuery {
+  CATQ_NONE = 0,
+  CATQ_FA,
+  CATQ_FB,
+  CATQ_IF,
+  CATQ_MD,
+  CATQ_SM,
+  CATQ_ZZFA,
+  CATQ_ZZFB,
+  CATQ_ZZMD,
+  CATQ_ZZSM,
+  CATQ_ZZSP
+};
+
+static int rigctl_classify(const char *command) {
+  if (command[0] == 'Z' && command[1] == 'Z') {
+    if (!strcmp(command, "ZZFA;")) { return CATQ_ZZFA; }
+
+    if (!strcmp(command, "ZZFB;")) { return CATQ_ZZFB; }
+
+    if (!strcmp(command, "ZZMD;")) { return CATQ_ZZMD; }
+
+    if (!strcmp(command, "ZZSP;")) { return CATQ_ZZSP; }
+
+    if (!strncmp(command, "ZZSM", 4) && (command[4] == '0' || command[4] == '1') && command[5] == ';'
+        && command[6] == '\0') { return CATQ_ZZSM; }
+
+    return CATQ_NONE;
+  }
+
+  if (!strcmp(command, "FA;")) { return CATQ_FA; }
+
+  if (!strcmp(command, "FB;")) { return CATQ_FB; }
+
+  if (!strcmp(command, "IF;")) { return CATQ_IF; }
+
+  if (!strcmp(command, "MD;")) { return CATQ_MD; }
+
+  if (command[0] == 'S' && command[1] == 'M' && (command[2] == '0' || command[2] == '1') && command[3] == ';'
+      && command[4] == '\0') { return CATQ_SM; }
+
+  return CATQ_NONE;
+}
+
+//
+// Try to answer a command directly in the client thread. The responses
+// must be identical to what parse_cmd() produces. Return 0 if the
+// command has to be executed by parse_cmd() in the GTK main loop. This is
+// also the case if previous commands of this client are still pending
+// there, to keep the order of execution.
+//
+static int rigctl_fast_query(CLIENT *client, const char *command) {
+  CAT_SNAPSHOT s;
+  char reply[256];
+  int id;
+  int query = rigctl_classify(command);
+
+  if (query == CATQ_NONE) { return 0; }
+
+  if (atomic_load_explicit(&client->pending, memory_order_acquire) > 0) { return 0; }
+
+  if (!rigctl_snapshot_read(&s)) { return 0; }
+
+  switch (query) {
+  case CATQ_FA:
+    snprintf(reply, 256, "FA%011lld;", s.fa);
+    break;
+
+  case CATQ_FB:
+    snprintf(reply, 256, "FB%011lld;", s.fb);
+    break;
+
+  case CATQ_IF:
+    snprintf(reply, 256, "IF%011lld%04d%+06lld%d%d%d%02d%d%d%d%d%d%d%02d%d;",
+             s.fa, (int) s.step_a, s.rit_a, s.rit_enabled_a, s.xit_enabled,
+             0, 0, s.transmitting, ts2000_mode(s.mode_a), 0, 0, s.split, s.ctcss_enabled ? 2 : 0, s.ctcss, 0);
+    break;
+
+  case CATQ_MD:
+    snprintf(reply, 256, "MD%d;", ts2000_mode(s.mode_a));
+    break;
+
+  case CATQ_SM: {
+    int val;
+    id = command[2] - '0';
+
+    if (id >= s.receivers) { return 0; }
+
+    val = (int)((s.meter[id] + 127.0) * 0.277778);
+
+    if (val > 30) { val = 30; }
+
+    if (val < 0 ) { val = 0; }
+
+    snprintf(reply, 256, "SM%d%04d;", id, val);
+  }
+  break;
+
+  case CATQ_ZZFA:
+    snprintf(reply, 256, "ZZFA%011lld;", s.fa);
+    break;
+
+  case CATQ_ZZFB:
+    snprintf(reply, 256, "ZZFB%011lld;", s.fb);
+    break;
+
+  case CATQ_ZZMD:
+    snprintf(reply, 256, "ZZMD%02d;", s.mode_a);
+    break;
+
+  case CATQ_ZZSM: {
+    double m;
+    id = command[4] - '0';
+
+    if (id >= s.receivers) { return 0; }
+
+    m = fmax(-140.0, s.meter[id]);
+    m = fmin(-10.0, m);
+    snprintf(reply, 256, "ZZSM%d%03d;", id, (int)((m + 140.0) * 2));
+  }
+  break;
+
+  case CATQ_ZZSP:
+    snprintf(reply, 256, "ZZSP%d;", s.split);
+    break;
+
+  default:
+    return 0;
+  }
+
+  send_resp(client->fd, reply);
+  client->fast_count++;
+  return 1;
+}
+
+//
+// Pass a command to parse_cmd() in the GTK main loop
+//
+static void rigctl_queue_cmd(CLIENT *client, const char *command) {
+  COMMAND *info = NULL;
+
+  for (int i = 0; i < RIGCTL_POOL; i++) {
+    if (atomic_load_explicit(&client->pool[i].in_use, memory_order_acquire) == 0) {
+      info = &client->pool[i];
+      info->pooled = 1;
+      atomic_store_explicit(&info->in_use, 1, memory_order_relaxed);
+      break;
+    }
+  }
+
+  if (info == NULL) {
+    info = g_new(COMMAND, 1);
+    info->pooled = 0;
+  }
+
+  g_strlcpy(info->buf, command, MAXDATASIZE);
+  info->command = info->buf;
+  info->client = client;
+  atomic_fetch_add_explicit(&client->pending, 1, memory_order_relaxed);
+  client->slow_count++;
+  g_idle_add(parse_cmd, info);
+}
+
 static gpointer rigctl_client (gpointer data) {
   CLIENT *client = (CLIENT *)data;
   t_print("%s: starting rigctl_client: socket=%d\n", __FUNCTION__, client->fd);
@@ -2026,8 +2330,10 @@ static gpointer rigctl_client (gpointer data) {
   int i;
   int numbytes;
   char  cmd_input[MAXDATASIZE] ;
-  char *command = g_new(char, MAXDATASIZE);
+  char  command[MAXDATASIZE];
   int command_index = 0;
+  client->fast_count = 0;
+  client->slow_count = 0;
 
   while (client->running && (numbytes = recv(client->fd, cmd_input, MAXDATASIZE - 2, 0)) > 0 ) {
     for (i = 0; i < numbytes; i++) {
@@ -2039,27 +2345,27 @@ static gpointer rigctl_client (gpointer data) {
         continue;
       }
 
-      command[command_index] = cmd_input[i];
-      command_index++;
+      if (command_index < MAXDATASIZE - 1) {
+        command[command_index] = cmd_input[i];
+        command_index++;
+      }
 
       if (cmd_input[i] == ';') {
         command[command_index] = '\0';
 
         if (rigctl_debug) { t_print("RIGCTL: command=%s\n", command); }
 
-        COMMAND *info = g_new(COMMAND, 1);
-        info->client = client;
-        info->command = command;
-        g_idle_add(parse_cmd, info);
-        command = g_new(char, MAXDATASIZE);
+        if (!rigctl_fast_query(client, command)) {
+          rigctl_queue_cmd(client, command);
+        }
+
         command_index = 0;
       }
     }
   }
 
-  // Release the last "command" buffer (that has not yet been used)
-  g_free(command);
-  t_print("%s: Leaving rigctl_client thread\n", __FUNCTION__);
+  t_print("%s: Leaving rigctl_client thread (fast=%ld queued=%ld)\n", __FUNCTION__,
+          client->fast_count, client->slow_count);
 
   //
   // If rigctl is disabled via the GUI, the connections are closed by shutdown_rigctl_ports()
@@ -7069,8 +7375,19 @@ int parse_cmd(void *data) {
   }
 
   client->done = 1; // possibly inform server that command is finished
-  g_free(info->command);
-  g_free(info);
+  //
+  // Update the snapshot *before* the command is marked done, such that
+  // a subsequent query of this client sees the effect of this command.
+  //
+  rigctl_snapshot_update();
+  atomic_fetch_sub_explicit(&client->pending, 1, memory_order_release);
+
+  if (info->pooled) {
+    atomic_store_explicit(&info->in_use, 0, memory_order_release);
+  } else {
+    g_free(info);
+  }
+
   return 0;
 }
 
@@ -7143,7 +7460,7 @@ static gpointer serial_server(gpointer data) {
   // when we get data we'll send it to parse_cmd
   CLIENT *client = (CLIENT *)data;
   char cmd_input[MAXDATASIZE];
-  char *command = g_new(char, MAXDATASIZE);
+  char command[MAXDATASIZE];
   int command_index = 0;
   int i;
   fd_set fds;
@@ -7216,28 +7533,31 @@ static gpointer serial_server(gpointer data) {
           continue;
         }
 
-        command[command_index] = cmd_input[i];
-        command_index++;
+        if (command_index < MAXDATASIZE - 1) {
+          command[command_index] = cmd_input[i];
+          command_index++;
+        }
 
         if (cmd_input[i] == ';') {
           command[command_index] = '\0';
 
           if (rigctl_debug) { t_print("RIGCTL: serial command=%s\n", command); }
 
-          COMMAND *info = g_new(COMMAND, 1);
-          info->client = client;
-          info->command = command;
-          client->busy = 10;
-          g_idle_add(parse_cmd, info);
-          command = g_new(char, MAXDATASIZE);
+          //
+          // With a FIFO, all responses must go through parse_cmd
+          // because of the busy/done handshake (see above)
+          //
+          if (client->fifo || !rigctl_fast_query(client, command)) {
+            client->busy = 10;
+            rigctl_queue_cmd(client, command);
+          }
+
           command_index = 0;
         }
       }
     }
   }
 
-  // Release the last "command" buffer (that has not yet been used)
-  g_free(command);
   g_mutex_lock(&mutex_numcat);
   cat_control--;
   // if (rigctl_debug) { t_print("RIGCTL: SER DEC - cat_control=%d\n", cat_control); }
@@ -7295,6 +7615,7 @@ int launch_serial_rigctl (int id) {
   serial_client[id].busy = 0;
   serial_client[id].done = 0;
   serial_client[id].running = 1;
+  rigctl_snapshot_start();
   serial_client[id].andromeda_timer = 0;
   serial_client[id].auto_reporting = SET(SerialPorts[id].autoreporting);
   serial_client[id].andromeda_type = 0;
@@ -7371,6 +7692,7 @@ void disable_serial_rigctl (int id) {
 void launch_tcp_rigctl () {
   t_print( "---- LAUNCHING RIGCTL SERVER ----\n");
   tcp_running = 1;
+  rigctl_snapshot_start();
 
   //
   // Start CW thread and auto reporter, if not yet done
@@ -1015,8 +1015,6 @@ void rx_panadapter_update(RECEIVER *rx) {
   //---------------------------------------------------------------------------------------
   if (rx->panadapter_autoscale_enabled) {
     double noise_floor_level = -175.0; // inital value
-    double ignore_noise_percentile = 60.0; // means 80%
-    double *qsorted_samples = malloc(mywidth * sizeof(double));
     static double noise_floor_level_sum = 0.0; // inital value
     static int anz_messungen = 0; // initial value
     static int noisefloor_first_run_flag = 1;
@@ -1025,20 +1023,9 @@ void rx_panadapter_update(RECEIVER *rx) {
     // Berechne die aktuelle Zeit
     time_t current_time;
     time(&current_time);
-
     // calculate the noise level from samples
-    if (qsorted_samples != NULL) {
-      for (int i = 0; i < mywidth; i++) {
-        qsorted_samples[i] = (double)samples[i + rx->pan] + soffset;
-      }
-
-      qsort(qsorted_samples, mywidth, sizeof(double), compare_doubles);
-      int index = (int)((ignore_noise_percentile / 100.0) * mywidth);
-      noise_floor_level = qsorted_samples[index] + 3.0;
-      // t_print("noise_floor = %f\n", noise_floor_level);
-      free(qsorted_samples); // Free memory after use
-    }
-
+    noise_floor_level = rx_noise_floor(rx, rx->pan, mywidth, RX_NOISE_FLOOR_PERCENTILE) + soffset + 3.0;
+    // t_print("noise_floor = %f\n", noise_floor_level);
     noise_floor_level_sum += noise_floor_level;
     anz_messungen++;
 
@@ -1120,20 +1107,7 @@ void rx_panadapter_update(RECEIVER *rx) {
     double noise_level = 0.0;
 
     if (hide_noise) {
-      // Dynamically allocate a copy of samples for sorting
-      double *sorted_samples = malloc(mywidth * sizeof(double));
-
-      if (sorted_samples != NULL) {
-        for (int i = 0; i < mywidth; i++) {
-          sorted_samples[i] = (double)samples[i + rx->pan] + soffset;
-        }
-
-        qsort(sorted_samples, mywidth, sizeof(double), compare_doubles);
-        int index = (int)((noise_percentile / 100.0) * mywidth);
-        // noise_level = sorted_samples[index];
-        noise_level = sorted_samples[index] + 3.0;
-        free(sorted_samples); // Free memory after use
-      }
+      noise_level = rx_noise_floor(rx, rx->pan, mywidth, noise_percentile) + soffset + 3.0;
     }
 
     // free(sorted_samples); // Free memory after use
@@ -0,0 +1,253 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrum_history.h"
+#include "message.h"
+
+//
+// Quantization: value = (dB - SH_DB_MIN) * SH_STEPS_PER_DB,
+// covering -400 ... +255 dB in steps of 0.01 dB
+//
+#define SH_DB_MIN        -400.0F
+#define SH_STEPS_PER_DB   100.0F
+
+SPECTRUM_HISTORY *spectrum_history_new(int megabytes) {
+  if (megabytes <= 0) { return NULL; }
+
+  SPECTRUM_HISTORY *h = g_new0(SPECTRUM_HISTORY, 1);
+  h->budget = (size_t) megabytes << 20;
+  return h;
+}
+
+void spectrum_history_free(SPECTRUM_HISTORY *h) {
+  if (h == NULL) { return; }
+
+  g_free(h->frames);
+  g_free(h->data);
+  g_free(h);
+}
+
+void spectrum_history_clear(SPECTRUM_HISTORY *h) {
+  if (h == NULL) { return; }
+
+  h->count = 0;
+  h->head = 0;
+}
+
+static inline int spectrum_history_slot(const SPECTRUM_HISTORY *h, int age) {
+  int slot = h->head - 1 - age;
+
+  if (slot < 0) { slot += h->capacity; }
+
+  return slot;
+}
+
+//
+// (Re-)allocate the ring for a given frame size (e.g. after a zoom or
+// screen width change). Since each frame covers the full span, the frames
+// already stored are kept (as many as fit) and re-sampled to the new size,
+// using the maximum when reducing the number of values such that peaks
+// are retained.
+//
+static void spectrum_history_alloc(SPECTRUM_HISTORY *h, int pixels) {
+  int capacity = h->budget / (pixels * sizeof(guint16) + sizeof(SPECTRUM_FRAME));
+
+  if (capacity < 1) { capacity = 1; }
+
+  SPECTRUM_FRAME *frames = g_new(SPECTRUM_FRAME, capacity);
+  guint16 *data = g_new(guint16, (size_t) capacity * pixels);
+  int count = h->count < capacity ? h->count : capacity;
+
+  for (int age = count - 1, slot = 0; age >= 0; age--, slot++) {
+    int old = spectrum_history_slot(h, age);
+    const guint16 *src = h->data + (size_t) old * h->pixels;
+    guint16 *dst = data + (size_t) slot * pixels;
+    frames[slot] = h->frames[old];
+    frames[slot].pixels = pixels;
+
+    for (int j = 0; j < pixels; j++) {
+      int i0 = (int)(((long long) j * h->pixels) / pixels);
+      int i1 = (int)(((long long)(j + 1) * h->pixels) / pixels);
+      guint16 v = src[i0];
+
+      for (int i = i0 + 1; i < i1; i++) {
+        if (src[i] > v) { v = src[i]; }
+      }
+
+      dst[j] = v;
+    }
+  }
+
+  g_free(h->frames);
+  g_free(h->data);
+  h->frames = frames;
+  h->data = data;
+  h->pixels = pixels;
+  h->capacity = capacity;
+  h->count = count;
+  h->head = count < capacity ? count : 0;
+  t_print("%s: pixels=%d frames=%d kept=%d\n", __FUNCTION__, pixels, capacity, count);
+}
+
+void spectrum_history_add(SPECTRUM_HISTORY *h, const float *samples, int pixels, long long frequency,
+                          int sample_rate) {
+  if (h == NULL || pixels <= 0) { return; }
+
+  if (pixels != h->pixels) {
+    spectrum_history_alloc(h, pixels);
+  }
+
+  SPECTRUM_FRAME *f = &h->frames[h->head];
+  guint16 *q = h->data + (size_t) h->head * pixels;
+  f->time = g_get_monotonic_time();
+  f->frequency = frequency;
+  f->sample_rate = sample_rate;
+  f->pixels = pixels;
+
+  //
+  // Written such that the compiler can vectorize it
+  //
+  for (int i = 0; i < pixels; i++) {
+    float v = (samples[i] - SH_DB_MIN) * SH_STEPS_PER_DB + 0.5F;
+    v = v < 0.0F ? 0.0F : v;
+    v = v > 65535.0F ? 65535.0F : v;
+    q[i] = (guint16) v;
+  }
+
+  if (++h->head >= h->capacity) { h->head = 0; }
+
+  if (h->count < h->capacity) { h->count++; }
+}
+
+const SPECTRUM_FRAME *spectrum_history_get(const SPECTRUM_HISTORY *h, int age, float *samples) {
+  if (h == NULL || age < 0 || age >= h->count) { return NULL; }
+
+  int slot = spectrum_history_slot(h, age);
+  const SPECTRUM_FRAME *f = &h->frames[slot];
+
+  if (samples) {
+    const guint16 *q = h->data + (size_t) slot * h->pixels;
+
+    for (int i = 0; i < h->pixels; i++) {
+      samples[i] = (float) q[i] * (1.0F / SH_STEPS_PER_DB) + SH_DB_MIN;
+    }
+  }
+
+  return f;
+}
+
+//
+// The (monotonic) time stamps do not increase with the age, so both ends
+// of the interval are found with a binary search.
+//
+int spectrum_history_range(const SPECTRUM_HISTORY *h, gint64 t0, gint64 t1, int *first) {
+  int lo, hi;
+
+  if (h == NULL || h->count == 0 || t1 < t0) { return 0; }
+
+  // smallest age with time <= t1
+  lo = 0;
+  hi = h->count;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+
+    if (h->frames[spectrum_history_slot(h, mid)].time <= t1) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  int newest = lo;
+  // smallest age with time < t0
+  lo = newest;
+  hi = h->count;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+
+    if (h->frames[spectrum_history_slot(h, mid)].time < t0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  if (first) { *first = newest; }
+
+  return lo - newest;
+}
+
+//
+// Write the frames in the (monotonic) time interval [t0, t1], oldest
+// first, to a binary file (native byte order). The time stamps in the
+// file are wall-clock times, converted with the current offset between
+// the two clocks:
+//
+// header: 8 bytes "DSPHIST1", int32 number of frames
+// frame:  int64 time (usec since epoch), int64 VFO frequency (Hz),
+//         int32 span (Hz), int32 number of values n,
+//         n float32 values (dB)
+//
+// Returns the number of frames written, or -1 on error.
+//
+int spectrum_history_dump(const SPECTRUM_HISTORY *h, const char *filename, gint64 t0, gint64 t1) {
+  int first = 0;
+  int n = spectrum_history_range(h, t0, t1, &first);
+  FILE *fp = fopen(filename, "wb");
+
+  if (fp == NULL) {
+    t_perror("spectrum_history_dump");
+    return -1;
+  }
+
+  int32_t count = n;
+  int ok = fwrite("DSPHIST1", 1, 8, fp) == 8 && fwrite(&count, sizeof(count), 1, fp) == 1;
+  float *samples = n > 0 ? g_new(float, h->pixels) : NULL;
+  gint64 offset = g_get_real_time() - g_get_monotonic_time();
+
+  for (int age = first + n - 1; ok && age >= first; age--) {
+    const SPECTRUM_FRAME *f = spectrum_history_get(h, age, samples);
+    int64_t t = f->time + offset;
+    int64_t freq = f->frequency;
+    int32_t rate = f->sample_rate;
+    int32_t pixels = f->pixels;
+    ok = fwrite(&t, sizeof(t), 1, fp) == 1 && fwrite(&freq, sizeof(freq), 1, fp) == 1
+         && fwrite(&rate, sizeof(rate), 1, fp) == 1 && fwrite(&pixels, sizeof(pixels), 1, fp) == 1
+         && fwrite(samples, sizeof(float), pixels, fp) == (size_t) pixels;
+  }
+
+  g_free(samples);
+
+  if (fclose(fp) != 0) { ok = 0; }
+
+  if (!ok) {
+    t_print("%s: write error on %s\n", __FUNCTION__, filename);
+    return -1;
+  }
+
+  t_print("%s: %d frames written to %s\n", __FUNCTION__, n, filename);
+  return n;
+}
@@ -0,0 +1,74 @@
+/* Copyright (C)
+* 2024,2025 - Heiko Amft, DL1BZ (Project deskHPSDR)
+*
+*   This program is free software: you can redistribute it and/or modify
+*   it under the terms of the GNU General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*   GNU General Public License for more details.
+*
+*   You should have received a copy of the GNU General Public License
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*
+*/
+
+#ifndef _SPECTRUM_HISTORY_H
+#define _SPECTRUM_HISTORY_H
+
+#include <glib.h>
+
+//
+// Per-receiver history of spectrum frames (as obtained from rx_get_pixels).
+//
+// The frames are kept in a ring buffer of fixed size (the memory budget
+// is given upon creation), the dB values are stored as 16-bit unsigned
+// integers with a resolution of 0.01 dB. Together with each frame, the
+// time stamp, VFO frequency and span are stored, such that
+// the waterfall can be re-generated from the history, and time ranges
+// can be exported to a file.
+//
+// The history is not thread-safe: both writing and reading are done
+// from the GTK main thread (the display update).
+//
+
+typedef struct _spectrum_frame {
+  gint64    time;               // g_get_monotonic_time() when the frame was added
+  long long frequency;          // VFO frequency when the frame was taken (Hz)
+  int       sample_rate;        // span of the frame (Hz)
+  int       pixels;             // number of values
+} SPECTRUM_FRAME;
+
+typedef struct _spectrum_history {
+  size_t          budget;       // memory budget in bytes
+  int             pixels;       // number of values per frame
+  int             capacity;     // number of frames that fit into the budget
+  int             count;        // number of frames stored
+  int             head;         // slot to be written next
+  SPECTRUM_FRAME *frames;
+  guint16        *data;         // capacity * pixels quantized values
+} SPECTRUM_HISTORY;
+
+extern SPECTRUM_HISTORY *spectrum_history_new(int megabytes);
+extern void spectrum_history_free(SPECTRUM_HISTORY *h);
+extern void spectrum_history_clear(SPECTRUM_HISTORY *h);
+extern void spectrum_history_add(SPECTRUM_HISTORY *h, const float *samples, int pixels, long long frequency,
+                                 int sample_rate);
+
+//
+// Frames are addressed by their age: 0 is the most recent one.
+// spectrum_history_get returns NULL if there is no such frame, and
+// otherwise (if samples is non-NULL) converts the values back to dB.
+// spectrum_history_range returns the number of frames in the time
+// interval [t0, t1], and the age of the most recent of them in *first.
+// The times are those of g_get_monotonic_time(), which (unlike the
+// wall clock) never goes back, so the frames are ordered by time.
+//
+extern const SPECTRUM_FRAME *spectrum_history_get(const SPECTRUM_HISTORY *h, int age, float *samples);
+extern int spectrum_history_range(const SPECTRUM_HISTORY *h, gint64 t0, gint64 t1, int *first);
+extern int spectrum_history_dump(const SPECTRUM_HISTORY *h, const char *filename, gint64 t0, gint64 t1);
+
+#endif
@@ -32,15 +32,22 @@
 #include <netinet/tcp.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 
 #ifdef __APPLE__
   #include <time.h>
+  #include "MacOS.h"
 #endif
 
 #include <openssl/sha.h>
 #include <openssl/evp.h>
+#include <wdsp.h>   // only needed for the resampler
 
 #include "radio.h"
 #include "vfo.h"
@@ -49,12 +56,48 @@
 #include "message.h"
 #include "toolset.h"
 #include "main.h"
+#include "tci.h"
 
 #define MAX_TCI_CLIENTS 5
 #define MAXDATASIZE     1024
 #define MAXMSGSIZE      512
 #define ARGLEN 16
 
+//
+// Outbound queue. Each client has a bounded queue of complete
+// WebSocket frames that is drained by the TCI writer thread.
+// If the queue of a client stays full for more than TCI_STALL_TIME
+// (in usec), the client is considered dead and is disconnected.
+//
+#define TCI_QUEUE_LEN       64
+#define TCI_FRAMESIZE       (MAXMSGSIZE + 4)
+#define TCI_STALL_TIME      5000000
+#define TCI_REPORT_INTERVAL 500000
+
+//
+// Binary IQ and audio streams. The RX thread only copies its buffers
+// into a per-stream ring (TCI_STREAM_RING blocks of up to TCI_STREAM_BLOCK
+// doubles). The TCI stream thread does resampling and conversion to
+// float32 and builds complete WebSocket frames in a pool of reusable
+// buffers. A frame is queued by reference to each subscribed client,
+// so it is built once no matter how many clients there are.
+//
+#define TCI_STREAM_RX       2
+#define TCI_STREAM_RING     16
+#define TCI_STREAM_BLOCK    2048
+#define TCI_STREAM_FLOATS   2048
+#define TCI_STREAM_POOL     32
+#define TCI_STREAM_HDR      64
+#define TCI_STREAM_MASK(rx, type) (1 << ((type) * TCI_STREAM_RX + (rx)))
+
+//
+// Stream types as defined in the TCI protocol
+//
+enum StreamType {
+  stIQ    = 0,
+  stAUDIO = 1
+};
+
 int tci_enable = 0;
 int tci_port   = 50001;
 int tci_txonly = 0;
@@ -78,11 +121,58 @@ static int tci_running = 0;
 static int server_socket = -1;
 static struct sockaddr_in server_address;
 
+//
+// A prebuilt binary stream frame, shared by all clients.
+// It may be re-used if refs has dropped to zero.
+//
+typedef struct _tci_sbuf {
+  atomic_int refs;              // number of client queue entries using this frame
+  int len;                      // total frame length
+  unsigned char data[4 + TCI_STREAM_HDR + 4 * TCI_STREAM_FLOATS];
+} TCI_SBUF;
+
+typedef struct _tci_frame {
+  int len;                      // total frame length (header + payload)
+  int hdr;                      // length of the WebSocket header
+  int klen;                     // length of the coalescing key, 0 if none
+  TCI_SBUF *sbuf;               // if non-NULL, send this instead of data
+  unsigned char data[TCI_FRAMESIZE];
+} TCI_FRAME;
+
+typedef struct _tci_stream {
+  //
+  // SPSC ring between the RX thread (producer) and
+  // the TCI stream thread (consumer)
+  //
+  _Alignas(64) atomic_int head;
+  _Alignas(64) atomic_int tail;
+  double *block[TCI_STREAM_RING];
+  int n[TCI_STREAM_RING];       // number of complex/stereo samples
+  int rate[TCI_STREAM_RING];    // sample rate of the block
+  long overflows;               // statistics (producer)
+  //
+  // everything below is only used by the TCI stream thread
+  //
+  RESAMPLE resampler;
+  int rs_size;
+  int rs_in_rate;
+  int rs_out_rate;
+  double *rs_in;
+  double *rs_out;
+  TCI_SBUF *pool;
+  int next;                     // where to start looking for a free frame
+  TCI_SBUF *cur;                // frame currently being filled
+  int fill;                     // number of floats in cur
+  int cur_rate;                 // sample rate of the data in cur
+  long frames;                  // statistics: frames produced
+  long nobuf;                   //             frames lost since the pool was exhausted
+} TCI_STREAM;
+
 typedef struct _client {
   int seq;                      // Seq. number of the client
   int fd;                       // socket
   int running;                  // set this to zero to close client connection
-  guint tci_timer;              // GTK id  of the periodic task
+  int report;                   // periodic reporting active
   socklen_t address_length;     // unused
   struct sockaddr_in address;   // unused
   GThread *thread_id;           // thread id of receiving thread
@@ -96,21 +186,47 @@ typedef struct _client {
   int count;                    // ping counter
   int rxsensor;                 // enable transmit of S meter data
   int txsensor;                 // enable transmit of drive data
-  int idle_queued;              // counter
+  int streams;                  // subscribed binary streams (TCI_STREAM_MASK bits)
+  //
+  // Outbound queue, protected by tci_mutex
+  //
+  TCI_FRAME queue[TCI_QUEUE_LEN];
+  int q_head;                   // oldest frame
+  int q_count;                  // number of frames in the queue
+  int q_offset;                 // bytes of the oldest frame already sent
+  gint64 full_since;            // time stamp when the queue became full
+  long st_queued;               // statistics: frames queued
+  long st_sent;                 //             frames sent
+  long st_bytes;                //             bytes sent
+  long st_coalesced;            //             frames replaced by a newer one
+  long st_dropped;              //             frames dropped (queue full)
+  int st_hiwater;               //             max. queue depth
 } CLIENT;
 
-typedef struct _response {
-  CLIENT *client;
-  int     type;
-  char    msg[MAXMSGSIZE];
-} RESPONSE;
-
 static CLIENT tci_client[MAX_TCI_CLIENTS];
 
 static GMutex tci_mutex;
 
+static GThread *tci_writer_thread_id = NULL;
+static int tci_wake[2] = { -1, -1 };
+
+static GThread *tci_stream_thread_id = NULL;
+static TCI_STREAM tci_stream[2][TCI_STREAM_RX];   // indexed by type, receiver
+static atomic_int tci_stream_mask;                // union of all client subscriptions
+static atomic_int tci_stream_sleeping;
+static int tci_iq_rate = 48000;
+static int tci_audio_rate = 48000;
+#ifdef __APPLE__
+  static sem_t *tci_stream_sem = NULL;
+#else
+  static sem_t tci_stream_sem;
+  static int tci_stream_sem_init = 0;
+#endif
+
 static gpointer tci_server(gpointer data);
 static gpointer tci_listener(gpointer data);
+static gpointer tci_writer(gpointer data);
+static gpointer tci_stream_thread(gpointer data);
 
 //
 // Launch TCI system. Called upon program start if TCI is
@@ -120,15 +236,111 @@ static gpointer tci_listener(gpointer data);
 void launch_tci () {
   t_print( "---- LAUNCHING TCI SERVER ----\n");
   tci_running = 1;
+
+  //
+  // Start TCI writer. It is woken up through a pipe whenever
+  // a client queue changes from empty to non-empty.
+  //
+  if (pipe(tci_wake) < 0) {
+    t_perror("TCI: wake pipe");
+    tci_wake[0] = tci_wake[1] = -1;
+  } else {
+    fcntl(tci_wake[0], F_SETFL, fcntl(tci_wake[0], F_GETFL) | O_NONBLOCK);
+    fcntl(tci_wake[1], F_SETFL, fcntl(tci_wake[1], F_GETFL) | O_NONBLOCK);
+  }
+
+  tci_writer_thread_id = g_thread_new( "tci writer", tci_writer, NULL);
+
+  //
+  // The stream rings and the semaphore are never freed, since the RX
+  // threads may still access them in a race condition upon shutdown.
+  //
+  for (int t = 0; t < 2; t++) {
+    for (int rx = 0; rx < TCI_STREAM_RX; rx++) {
+      TCI_STREAM *s = &tci_stream[t][rx];
+
+      for (int i = 0; i < TCI_STREAM_RING; i++) {
+        if (s->block[i] == NULL) {
+          s->block[i] = g_new(double, TCI_STREAM_BLOCK);
+        }
+      }
+
+      atomic_store(&s->head, 0);
+      atomic_store(&s->tail, 0);
+      s->overflows = 0;
+    }
+  }
+
+  atomic_store(&tci_stream_mask, 0);
+  atomic_store(&tci_stream_sleeping, 0);
+#ifdef __APPLE__
+
+  if (tci_stream_sem == NULL) {
+    tci_stream_sem = apple_sem(0);
+  }
+
+#else
+
+  if (!tci_stream_sem_init) {
+    sem_init(&tci_stream_sem, 0, 0);
+    tci_stream_sem_init = 1;
+  }
+
+#endif
+  tci_stream_thread_id = g_thread_new( "tci stream", tci_stream_thread, NULL);
   //
   // Start TCI server
   //
   tci_server_thread_id = g_thread_new( "tci server", tci_server, GINT_TO_POINTER(tci_port));
 }
 
+//
+// Remove all frames from the queue of a client, and release
+// the references to shared stream frames. Call with tci_mutex locked.
+//
+static void tci_queue_clear(CLIENT *client) {
+  for (int i = 0; i < client->q_count; i++) {
+    TCI_FRAME *f = &client->queue[(client->q_head + i) % TCI_QUEUE_LEN];
+
+    if (f->sbuf) {
+      atomic_fetch_sub_explicit(&f->sbuf->refs, 1, memory_order_release);
+      f->sbuf = NULL;
+    }
+  }
+
+  client->q_head = 0;
+  client->q_count = 0;
+  client->q_offset = 0;
+}
+
+//
+// Re-calculate the union of all stream subscriptions which is
+// checked by the RX threads. Call with tci_mutex locked.
+//
+static void tci_update_stream_mask() {
+  int mask = 0;
+
+  for (int id = 0; id < MAX_TCI_CLIENTS; id++) {
+    if (tci_client[id].fd >= 0) {
+      mask |= tci_client[id].streams;
+    }
+  }
+
+  atomic_store_explicit(&tci_stream_mask, mask, memory_order_relaxed);
+}
+
+static void tci_wakeup() {
+  if (tci_wake[1] >= 0) {
+    // A full pipe is no problem, then the writer will wake up anyway
+    if (write(tci_wake[1], "", 1) < 0) {
+      return;
+    }
+  }
+}
+
 //
 // This enforces closing a "listener" connection even if it "hangs"
-// and removes the autoreporting task. Do not  join with the listener
+// and stops the autoreporting. Do not  join with the listener
 // so this may be called from  within the listener.
 //
 static void force_close(CLIENT *client) {
@@ -137,6 +349,7 @@ static void force_close(CLIENT *client) {
   linger.l_linger = 0;
   g_mutex_lock(&tci_mutex);
   client->running = 0;
+  client->report = 0;
 
   if (client->fd  != -1) {
     // No error checking since the socket may have been close in a race condition
@@ -146,11 +359,9 @@ static void force_close(CLIENT *client) {
     client->fd = -1;
   }
 
-  if (client->tci_timer != 0) {
-    g_source_remove(client->tci_timer);
-    client->tci_timer = 0;
-  }
-
+  tci_queue_clear(client);
+  client->streams = 0;
+  tci_update_stream_mask();
   g_mutex_unlock(&tci_mutex);
 }
 
@@ -178,6 +389,63 @@ void shutdown_tci() {
 
   usleep(100000);  // Let the TCI thread terminate, if it can
 
+  //
+  // Stop the stream thread, and release the resources it used
+  //
+  atomic_store(&tci_stream_mask, 0);
+
+  if (tci_stream_thread_id) {
+#ifdef __APPLE__
+    sem_post(tci_stream_sem);
+#else
+    sem_post(&tci_stream_sem);
+#endif
+    g_thread_join(tci_stream_thread_id);
+    tci_stream_thread_id = NULL;
+
+    for (int t = 0; t < 2; t++) {
+      for (int rx = 0; rx < TCI_STREAM_RX; rx++) {
+        TCI_STREAM *s = &tci_stream[t][rx];
+
+        if (s->frames > 0 || s->overflows > 0) {
+          t_print("%s: %s stream RX%d: frames=%ld nobuf=%ld overflows=%ld\n", __FUNCTION__,
+                  t == stIQ ? "IQ" : "audio", rx, s->frames, s->nobuf, s->overflows);
+        }
+
+        if (s->resampler) {
+          destroy_resample(s->resampler);
+          s->resampler = NULL;
+        }
+
+        g_free(s->rs_in);
+        g_free(s->rs_out);
+        g_free(s->pool);
+        s->rs_in = NULL;
+        s->rs_out = NULL;
+        s->pool = NULL;
+        s->cur = NULL;
+        s->fill = 0;
+        s->frames = 0;
+        s->nobuf = 0;
+      }
+    }
+  }
+
+  //
+  // The writer has a poll() time-out, so it can safely be joined
+  //
+  if (tci_writer_thread_id) {
+    tci_wakeup();
+    g_thread_join(tci_writer_thread_id);
+    tci_writer_thread_id = NULL;
+  }
+
+  if (tci_wake[0] >= 0) {
+    close(tci_wake[0]);
+    close(tci_wake[1]);
+    tci_wake[0] = tci_wake[1] = -1;
+  }
+
   //
   // Forced close of server socket, and join with TCI thread
   //
@@ -199,115 +467,467 @@ void shutdown_tci() {
 }
 
 //
-// tci_send_frame is intended to  be called  through the GTK idle queue
+// Status messages for which only the latest value is of interest.
+// If such a message is queued while an older message with the same
+// key (command and all arguments but the last one) is still waiting
+// in the queue, the older one is replaced in-place.
+//
+static const char *tci_coalesce_cmds[] = {
+  "vfo:", "dds:", "modulation:", "tx_frequency:", "drive:", "trx:",
+  "split_enable:", "rx_sensors:", "rx_channel_sensors:", NULL
+};
+
+static int tci_coalesce_key(const char *msg) {
+  for (const char **cmd = tci_coalesce_cmds; *cmd; cmd++) {
+    size_t len = strlen(*cmd);
+
+    if (!strncmp(msg, *cmd, len)) {
+      const char *c = strrchr(msg, ',');
+      return c ? (int)(c - msg + 1) : (int) len;
+    }
+  }
+
+  return 0;
+}
+
+//
+// Append a new entry to the queue of a client and return it.
+// If the queue is full, drop the frame (and return NULL). This is
+// back-pressure: the client does not read fast enough, and if this
+// lasts too long the client is disconnected. Call with tci_mutex locked.
 //
-static int tci_send_frame(void *data) {
-  RESPONSE *response = (RESPONSE *) data;
+static TCI_FRAME *tci_queue_slot(CLIENT *client, int *wake) {
+  TCI_FRAME *frame;
+
+  if (client->q_count >= TCI_QUEUE_LEN) {
+    gint64 now = g_get_monotonic_time();
+    client->st_dropped++;
+
+    if (client->full_since == 0) {
+      client->full_since = now;
+    } else if (now - client->full_since > TCI_STALL_TIME && client->running) {
+      t_print("%s: TCI%d stalled, disconnecting\n", __FUNCTION__, client->seq);
+      client->running = 0;
+    }
+
+    return NULL;
+  }
+
+  frame = &client->queue[(client->q_head + client->q_count) % TCI_QUEUE_LEN];
+  frame->sbuf = NULL;
 
-  if (!response || !response->client) {
-    g_free(response);  // Sicherstellen, dass Speicher freigegeben wird
-    return G_SOURCE_REMOVE;
+  if (client->q_count == 0) { *wake = 1; }
+
+  client->q_count++;
+  client->st_queued++;
+
+  if (client->q_count > client->st_hiwater) {
+    client->st_hiwater = client->q_count;
   }
 
-  CLIENT *client = response->client;
-  int type = response->type;
-  const char *msg = response->msg;
-  unsigned char frame[1024];
-  unsigned char *p;
-  int start;
+  return frame;
+}
+
+//
+// Build a WebSocket frame and put it into the outbound queue of the client.
+// This never blocks on the socket, the frame is sent by the TCI writer.
+//
+static void tci_queue_frame(CLIENT *client, int type, const char *msg) {
+  TCI_FRAME *frame = NULL;
+  size_t length = msg ? strnlen(msg, MAXMSGSIZE - 1) : 0;
+  int klen = (type == opTEXT && msg) ? tci_coalesce_key(msg) : 0;
+  int wake = 0;
   g_mutex_lock(&tci_mutex);
 
   if (client->fd < 0) {
-    client->idle_queued--;  // idle-Zähler korrigieren
     g_mutex_unlock(&tci_mutex);
-    g_free(response);
-    return G_SOURCE_REMOVE;
+    return;
   }
 
-  g_mutex_unlock(&tci_mutex);
-  // size_t length = strlen(msg);
-  size_t length = msg ? strlen(msg) : 0;
-  frame[0] = 128 | type;
+  if (klen > 0) {
+    //
+    // Look for an older message with the same key. Skip the oldest
+    // frame if it has been partially sent already.
+    //
+    for (int i = (client->q_offset > 0) ? 1 : 0; i < client->q_count; i++) {
+      TCI_FRAME *f = &client->queue[(client->q_head + i) % TCI_QUEUE_LEN];
+
+      if (f->klen == klen && !memcmp(f->data + f->hdr, msg, klen)) {
+        frame = f;
+        client->st_coalesced++;
+        break;
+      }
+    }
+  }
+
+  if (frame == NULL) {
+    frame = tci_queue_slot(client, &wake);
+
+    if (frame == NULL) {
+      g_mutex_unlock(&tci_mutex);
+      return;
+    }
+  }
+
+  frame->data[0] = 128 | type;
 
   if (length <= 125) {
-    frame[1] = length;
-    start = 2;
+    frame->data[1] = length;
+    frame->hdr = 2;
   } else {
-    frame[1] = 126;
-    frame[2] = (length >> 8) & 255;
-    frame[3] = length & 255;
-    start = 4;
+    frame->data[1] = 126;
+    frame->data[2] = (length >> 8) & 255;
+    frame->data[3] = length & 255;
+    frame->hdr = 4;
   }
 
-  for (size_t i = 0; i < length; i++) {
-    frame[start + i] = msg[i];
+  if (length > 0) {
+    memcpy(frame->data + frame->hdr, msg, length);
   }
 
-  length = length + start;
-  int count = 0;
-  p = frame;
+  frame->len = frame->hdr + length;
+  frame->klen = klen;
+  g_mutex_unlock(&tci_mutex);
 
-  while (length > 0) {
-    int rc = write(client->fd, p, length);
+  if (wake) {
+    tci_wakeup();
+  }
+}
+
+//
+// Send as much of the queued data as the socket accepts without blocking.
+// Note the socket itself stays in blocking mode since the listener relies
+// on its receive time-out, so MSG_DONTWAIT is used for sending.
+//
+static void tci_drain_queue(CLIENT *client, int fd) {
+  g_mutex_lock(&tci_mutex);
+
+  while (client->fd == fd && client->q_count > 0) {
+    TCI_FRAME *f = &client->queue[client->q_head];
+    const unsigned char *p = f->sbuf ? f->sbuf->data : f->data;
+    ssize_t rc = send(fd, p + client->q_offset, f->len - client->q_offset, MSG_DONTWAIT);
 
     if (rc < 0) {
       if (errno == EINTR) { continue; }
 
-      g_mutex_lock(&tci_mutex);
-      client->idle_queued--;   // idle-Zähler korrigieren
-      client->running = 0;
-      g_mutex_unlock(&tci_mutex);
-      g_free(response);
-      return G_SOURCE_REMOVE;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        client->running = 0;
+        tci_queue_clear(client);
+      }
+
+      break;
     }
 
-    if (rc == 0) {
-      count++;
+    client->st_bytes += rc;
+    client->q_offset += rc;
 
-      if (count > 10) {
-        g_mutex_lock(&tci_mutex);
-        client->idle_queued--;  // idle-Zähler korrigieren
-        client->running = 0;
-        g_mutex_unlock(&tci_mutex);
-        g_free(response);
-        return G_SOURCE_REMOVE;
+    if (client->q_offset >= f->len) {
+      if (f->sbuf) {
+        atomic_fetch_sub_explicit(&f->sbuf->refs, 1, memory_order_release);
+        f->sbuf = NULL;
       }
+
+      client->q_offset = 0;
+      client->q_head = (client->q_head + 1) % TCI_QUEUE_LEN;
+      client->q_count--;
+      client->st_sent++;
     }
+  }
 
-    length -= rc;
-    p += rc;
+  if (client->q_count < TCI_QUEUE_LEN) {
+    client->full_since = 0;
   }
 
-  g_mutex_lock(&tci_mutex);
-  client->idle_queued--;  // idle-Zähler korrekt verringern
   g_mutex_unlock(&tci_mutex);
-  g_free(response);
-  return G_SOURCE_REMOVE;
 }
 
-static void tci_send_text(CLIENT *client, char *msg) {
-  if (!client->running) {
+//
+// Wait (a limited amount of time) until the outbound queue is empty.
+// Used before closing a connection such that the final frames get out.
+//
+static void tci_flush(CLIENT *client) {
+  for (int i = 0; i < 25; i++) {
+    int pending;
+    g_mutex_lock(&tci_mutex);
+    pending = (client->fd >= 0 && client->q_count > 0);
+    g_mutex_unlock(&tci_mutex);
+
+    if (!pending) { break; }
+
+    usleep(10000);
+  }
+}
+
+//
+// Binary streams: producer side, called from the RX threads.
+// This returns immediately if no client has subscribed the stream,
+// otherwise the data is copied to the ring and the stream thread
+// is woken up if it sleeps. If the ring is full, the block is dropped.
+//
+static void tci_stream_push(int type, int id, const double *buf, int n, int rate) {
+  if (id < 0 || id >= TCI_STREAM_RX) { return; }
+
+  if (!(atomic_load_explicit(&tci_stream_mask, memory_order_relaxed) & TCI_STREAM_MASK(id, type))) { return; }
+
+  TCI_STREAM *s = &tci_stream[type][id];
+  int head = atomic_load_explicit(&s->head, memory_order_relaxed);
+  int next = head + 1;
+
+  if (next >= TCI_STREAM_RING) { next = 0; }
+
+  if (next == atomic_load_explicit(&s->tail, memory_order_acquire)) {
+    s->overflows++;
     return;
   }
 
-  if (rigctl_debug) { t_print("TCI%d response: %s\n", client->seq, msg); }
+  if (2 * n > TCI_STREAM_BLOCK) { n = TCI_STREAM_BLOCK / 2; }
 
-  RESPONSE *resp = g_new(RESPONSE, 1);
-  resp->client = client;
-  // g_strlcpy(resp->msg, msg, sizeof(resp->msg));
-  g_strlcpy(resp->msg, msg, MAXMSGSIZE);
-  resp->type = opTEXT;
+  memcpy(s->block[head], buf, 2 * n * sizeof(double));
+  s->n[head] = n;
+  s->rate[head] = rate;
+  atomic_store_explicit(&s->head, next, memory_order_seq_cst);
+
+  if (atomic_load_explicit(&tci_stream_sleeping, memory_order_seq_cst) &&
+      atomic_exchange_explicit(&tci_stream_sleeping, 0, memory_order_seq_cst)) {
+#ifdef __APPLE__
+    sem_post(tci_stream_sem);
+#else
+    sem_post(&tci_stream_sem);
+#endif
+  }
+}
+
+void tci_rx_iq(int id, const double *iq, int n, int rate) {
+  tci_stream_push(stIQ, id, iq, n, rate);
+}
+
+void tci_rx_audio(int id, const double *audio, int n, int rate) {
+  tci_stream_push(stAUDIO, id, audio, n, rate);
+}
+
+static void tci_put_le32(unsigned char *p, unsigned int v) {
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = (v >> 24) & 0xFF;
+}
+
+//
+// Find a frame in the pool that is not referenced by any client queue
+//
+static TCI_SBUF *tci_stream_getbuf(TCI_STREAM *s) {
+  if (s->pool == NULL) {
+    s->pool = g_new0(TCI_SBUF, TCI_STREAM_POOL);
+  }
+
+  for (int i = 0; i < TCI_STREAM_POOL; i++) {
+    TCI_SBUF *b = &s->pool[(s->next + i) % TCI_STREAM_POOL];
+
+    if (atomic_load_explicit(&b->refs, memory_order_acquire) == 0) {
+      s->next = (s->next + i + 1) % TCI_STREAM_POOL;
+      return b;
+    }
+  }
+
+  return NULL;
+}
+
+//
+// Complete the frame in s->cur and hand it over to all clients
+// that subscribed this stream.
+//
+static void tci_stream_publish(TCI_STREAM *s, int type, int rx) {
+  TCI_SBUF *b = s->cur;
+  int plen = TCI_STREAM_HDR + 4 * s->fill;
+  int wake = 0;
+  //
+  // WebSocket header (payload length always needs 16 bits)
+  //
+  b->data[0] = 128 | opBIN;
+  b->data[1] = 126;
+  b->data[2] = (plen >> 8) & 255;
+  b->data[3] = plen & 255;
+  //
+  // TCI stream header (little endian). The reserved words
+  // are always zero since the pool is zero-initialized.
+  //
+  tci_put_le32(b->data +  4, rx);            // receiver
+  tci_put_le32(b->data +  8, s->cur_rate);   // sample rate
+  tci_put_le32(b->data + 12, 3);             // format: float32
+  tci_put_le32(b->data + 16, 0);             // codec
+  tci_put_le32(b->data + 20, 0);             // crc
+  tci_put_le32(b->data + 24, s->fill);       // number of floats
+  tci_put_le32(b->data + 28, type);          // stream type
+  tci_put_le32(b->data + 32, 2);             // channels
+  b->len = 4 + plen;
+  s->cur = NULL;
+  s->fill = 0;
+  s->frames++;
   g_mutex_lock(&tci_mutex);
+  //
+  // Hold an extra reference while distributing
+  //
+  atomic_store_explicit(&b->refs, 1, memory_order_relaxed);
 
-  if (client->idle_queued >= 100) {
-    g_mutex_unlock(&tci_mutex);
-    g_free(resp);  // nicht vergessen!
-    return;
+  for (int id = 0; id < MAX_TCI_CLIENTS; id++) {
+    CLIENT *client = &tci_client[id];
+
+    if (client->fd >= 0 && client->running && (client->streams & TCI_STREAM_MASK(rx, type))) {
+      TCI_FRAME *frame = tci_queue_slot(client, &wake);
+
+      if (frame) {
+        frame->sbuf = b;
+        frame->len = b->len;
+        frame->hdr = 4;
+        frame->klen = 0;
+        atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+      }
+    }
   }
 
-  client->idle_queued++;
+  atomic_fetch_sub_explicit(&b->refs, 1, memory_order_release);
   g_mutex_unlock(&tci_mutex);
-  g_idle_add(tci_send_frame, resp);
+
+  if (wake) {
+    tci_wakeup();
+  }
+}
+
+//
+// Process one block from the ring: resample to the requested rate
+// if necessary, convert to float32 and fill frames.
+// Floats are stored in host byte order which is little endian
+// on all supported platforms.
+//
+static void tci_stream_process(TCI_STREAM *s, int type, int rx, int slot) {
+  const double *in = s->block[slot];
+  int n = s->n[slot];
+  int rate = s->rate[slot];
+  int out_rate = (type == stIQ) ? tci_iq_rate : tci_audio_rate;
+
+  if (out_rate > rate) { out_rate = rate; }
+
+  if (out_rate != rate) {
+    if (s->resampler == NULL || s->rs_size != n || s->rs_in_rate != rate || s->rs_out_rate != out_rate) {
+      if (s->resampler) {
+        destroy_resample(s->resampler);
+      }
+
+      g_free(s->rs_in);
+      g_free(s->rs_out);
+      s->rs_in = g_new(double, 2 * n);
+      s->rs_out = g_new(double, 2 * n);
+      s->resampler = create_resample(1, n, s->rs_in, s->rs_out, rate, out_rate, 0.0, 0, 1.0);
+      s->rs_size = n;
+      s->rs_in_rate = rate;
+      s->rs_out_rate = out_rate;
+    }
+
+    memcpy(s->rs_in, in, 2 * n * sizeof(double));
+    n = xresample(s->resampler);
+    in = s->rs_out;
+  }
+
+  if (s->cur != NULL && s->cur_rate != out_rate) {
+    // rate change: discard the partially filled frame
+    s->fill = 0;
+  }
+
+  for (int i = 0; i < 2 * n;) {
+    if (s->cur == NULL) {
+      s->cur = tci_stream_getbuf(s);
+      s->fill = 0;
+
+      if (s->cur == NULL) {
+        s->nobuf++;
+        return;
+      }
+    }
+
+    s->cur_rate = out_rate;
+    float *dst = (float *)(s->cur->data + 4 + TCI_STREAM_HDR) + s->fill;
+    int num = MIN(2 * n - i, TCI_STREAM_FLOATS - s->fill);
+
+    for (int j = 0; j < num; j++) {
+      dst[j] = (float) in[i + j];
+    }
+
+    i += num;
+    s->fill += num;
+
+    if (s->fill >= TCI_STREAM_FLOATS) {
+      tci_stream_publish(s, type, rx);
+    }
+  }
+}
+
+//
+// The TCI stream thread drains the rings filled by the RX threads.
+// It sleeps on a semaphore if all rings are empty, using the same
+// "sleeping" flag handshake as the P2 DDC rings.
+//
+static int tci_stream_pending() {
+  for (int t = 0; t < 2; t++) {
+    for (int rx = 0; rx < TCI_STREAM_RX; rx++) {
+      if (atomic_load_explicit(&tci_stream[t][rx].tail, memory_order_relaxed) !=
+          atomic_load_explicit(&tci_stream[t][rx].head, memory_order_seq_cst)) {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static gpointer tci_stream_thread(gpointer data) {
+  t_print("%s: starting TCI stream thread\n", __FUNCTION__);
+
+  while (tci_running) {
+    int work = 0;
+
+    for (int t = 0; t < 2; t++) {
+      for (int rx = 0; rx < TCI_STREAM_RX; rx++) {
+        TCI_STREAM *s = &tci_stream[t][rx];
+        int tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+
+        while (tail != atomic_load_explicit(&s->head, memory_order_acquire)) {
+          tci_stream_process(s, t, rx, tail);
+
+          if (++tail >= TCI_STREAM_RING) { tail = 0; }
+
+          atomic_store_explicit(&s->tail, tail, memory_order_release);
+          work = 1;
+        }
+      }
+    }
+
+    if (!work) {
+      atomic_store_explicit(&tci_stream_sleeping, 1, memory_order_seq_cst);
+
+      if (!tci_stream_pending() && tci_running) {
+#ifdef __APPLE__
+        sem_wait(tci_stream_sem);
+#else
+        sem_wait(&tci_stream_sem);
+#endif
+      }
+
+      atomic_store_explicit(&tci_stream_sleeping, 0, memory_order_seq_cst);
+    }
+  }
+
+  t_print("%s: leaving TCI stream thread\n", __FUNCTION__);
+  return NULL;
+}
+
+static void tci_send_text(CLIENT *client, char *msg) {
+  if (!client->running) {
+    return;
+  }
+
+  if (rigctl_debug) { t_print("TCI%d response: %s\n", client->seq, msg); }
+
+  tci_queue_frame(client, opTEXT, msg);
 }
 
 //
@@ -495,6 +1115,38 @@ static void tci_send_mode(CLIENT *client, int v) {
   }
 }
 
+static void tci_send_samplerates(CLIENT *client) {
+  char msg[MAXMSGSIZE];
+  snprintf(msg, MAXMSGSIZE, "iq_samplerate:%d;", tci_iq_rate);
+  tci_send_text(client, msg);
+  snprintf(msg, MAXMSGSIZE, "audio_samplerate:%d;", tci_audio_rate);
+  tci_send_text(client, msg);
+}
+
+//
+// Start or stop an IQ or audio stream for this client
+//
+static void tci_stream_subscribe(CLIENT *client, const char *cmd, int rx) {
+  char msg[MAXMSGSIZE];
+  int type = (cmd[0] == 'i') ? stIQ : stAUDIO;
+  int start = (strstr(cmd, "start") != NULL);
+
+  if (rx < 0 || rx >= TCI_STREAM_RX || rx >= receivers) { return; }
+
+  g_mutex_lock(&tci_mutex);
+
+  if (start) {
+    client->streams |= TCI_STREAM_MASK(rx, type);
+  } else {
+    client->streams &= ~TCI_STREAM_MASK(rx, type);
+  }
+
+  tci_update_stream_mask();
+  g_mutex_unlock(&tci_mutex);
+  snprintf(msg, MAXMSGSIZE, "%s:%d;", cmd, rx);
+  tci_send_text(client, msg);
+}
+
 static void tci_send_trx_count(CLIENT *client) {
   tci_send_text(client, "trx_count:2;");
 }
@@ -556,51 +1208,28 @@ static void tci_send_rx(CLIENT *client, int v) {
 }
 
 static void tci_send_close(CLIENT *client) {
-  RESPONSE *resp = g_new(RESPONSE, 1);
-
   if (rigctl_debug) { t_print("TCI%d CLOSE\n", client->seq); }
 
-  resp->client = client;
-  resp->type   = opCLOSE;
-  resp->msg[0] = 0;
-  g_idle_add(tci_send_frame, resp);
+  tci_queue_frame(client, opCLOSE, NULL);
 }
 
 __attribute__((unused)) static void tci_send_ping(CLIENT *client) {
-  RESPONSE *resp = g_new(RESPONSE, 1);
-
   if (rigctl_debug) { t_print("TCI%d PING\n", client->seq); }
 
-  resp->client = client;
-  resp->type   = opPING;
-  resp->msg[0] = 0;
-  g_idle_add(tci_send_frame, resp);
+  tci_queue_frame(client, opPING, NULL);
 }
 
 static void tci_send_pong(CLIENT *client) {
-  RESPONSE *resp = g_new(RESPONSE, 1);
-
   if (rigctl_debug) { t_print("TCI%d PONG\n", client->seq); }
 
-  resp->client = client;
-  resp->type   = opPONG;
-  resp->msg[0] = 0;
-  g_idle_add(tci_send_frame, resp);
+  tci_queue_frame(client, opPONG, NULL);
 }
 
-static gboolean tci_reporter(gpointer data) {
+static void tci_reporter(CLIENT *client) {
   //
-  // This function is called repeatedly as long as the client  runs
+  // This function is called periodically by the TCI writer
+  // as long as the client  runs
   //
-  CLIENT *client = (CLIENT *) data;
-  g_mutex_lock(&tci_mutex);
-
-  if (!client->running) {
-    g_mutex_unlock(&tci_mutex);
-    return FALSE;
-  }
-
-  g_mutex_unlock(&tci_mutex);
 #ifdef __APPLE__
   struct timespec ts;
   // clock_gettime(CLOCK_REALTIME, &ts);
@@ -680,8 +1309,82 @@ static gboolean tci_reporter(gpointer data) {
       tci_send_mox(client);
     }
   }
+}
 
-  return TRUE;
+//
+// The TCI writer drains the outbound queues of all clients, using
+// poll() to wait until a socket can take more data. Thus a slow client
+// neither stalls the GTK main loop nor the other clients.
+// It also does the periodic status reporting for all clients.
+//
+static gpointer tci_writer(gpointer data) {
+  struct pollfd pfd[MAX_TCI_CLIENTS + 1];
+  CLIENT *pcl[MAX_TCI_CLIENTS + 1];
+  gint64 next_report = g_get_monotonic_time() + TCI_REPORT_INTERVAL;
+  t_print("%s: starting TCI writer\n", __FUNCTION__);
+
+  while (tci_running) {
+    int n = 1;
+    int timeout;
+    gint64 now;
+    pfd[0].fd = tci_wake[0];
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    g_mutex_lock(&tci_mutex);
+
+    for (int id = 0; id < MAX_TCI_CLIENTS; id++) {
+      if (tci_client[id].fd >= 0 && tci_client[id].q_count > 0) {
+        pfd[n].fd = tci_client[id].fd;
+        pfd[n].events = POLLOUT;
+        pfd[n].revents = 0;
+        pcl[n] = &tci_client[id];
+        n++;
+      }
+    }
+
+    g_mutex_unlock(&tci_mutex);
+    now = g_get_monotonic_time();
+    timeout = (next_report > now) ? (int)((next_report - now + 999) / 1000) : 0;
+
+    if (poll(pfd, n, timeout) > 0) {
+      if (pfd[0].revents & POLLIN) {
+        char dummy[64];
+
+        while (read(tci_wake[0], dummy, sizeof(dummy)) > 0) {}
+      }
+
+      for (int i = 1; i < n; i++) {
+        if (pfd[i].revents & (POLLOUT | POLLERR | POLLHUP)) {
+          tci_drain_queue(pcl[i], pfd[i].fd);
+        }
+      }
+    }
+
+    now = g_get_monotonic_time();
+
+    if (now >= next_report) {
+      next_report += TCI_REPORT_INTERVAL;
+
+      if (next_report <= now) {
+        next_report = now + TCI_REPORT_INTERVAL;
+      }
+
+      for (int id = 0; id < MAX_TCI_CLIENTS; id++) {
+        CLIENT *client = &tci_client[id];
+        int report;
+        g_mutex_lock(&tci_mutex);
+        report = client->running && client->report && client->fd >= 0;
+        g_mutex_unlock(&tci_mutex);
+
+        if (report) {
+          tci_reporter(client);
+        }
+      }
+    }
+  }
+
+  t_print("%s: leaving TCI writer\n", __FUNCTION__);
+  return NULL;
 }
 
 //
@@ -864,11 +1567,26 @@ static gpointer tci_server(gpointer data) {
 
     //
     // If everything worked as expected:
-    // Initialize client data structure,
-    // spawn off thread that "listens" to the connection,
-    // start periodic job that reports frequency/mode changes
+    // Initialize client data structure and outbound queue,
+    // spawn off thread that "listens" to the connection.
+    // Periodic reporting of frequency/mode changes is done
+    // by the TCI writer once the listener has sent the initial state.
     //
+    g_mutex_lock(&tci_mutex);
+    tci_client[spare].q_head          =  0;
+    tci_client[spare].q_count         =  0;
+    tci_client[spare].q_offset        =  0;
+    tci_client[spare].full_since      =  0;
+    tci_client[spare].st_queued       =  0;
+    tci_client[spare].st_sent         =  0;
+    tci_client[spare].st_bytes        =  0;
+    tci_client[spare].st_coalesced    =  0;
+    tci_client[spare].st_dropped      =  0;
+    tci_client[spare].st_hiwater      =  0;
+    tci_client[spare].report          =  0;
+    tci_client[spare].streams         =  0;
     tci_client[spare].fd              = fd;
+    g_mutex_unlock(&tci_mutex);
     tci_client[spare].running         = 1;
     tci_client[spare].seq             = spare;
     tci_client[spare].last_fa         = -1;
@@ -879,7 +1597,6 @@ static gpointer tci_server(gpointer data) {
     tci_client[spare].count           =  0;
     tci_client[spare].rxsensor        =  0;
     tci_client[spare].thread_id       = g_thread_new("TCI listener", tci_listener, (gpointer)&tci_client[spare]);
-    tci_client[spare].tci_timer       = g_timeout_add(500, tci_reporter, &tci_client[spare]);
   }
 
   close(server_socket);
@@ -1010,8 +1727,14 @@ static gpointer tci_listener(gpointer data) {
   tci_send_macros_cwspeed(client);
   tci_send_text(client, "cw_macros_delay:10;");
   tci_send_keyer_cwspeed(client);
+  tci_send_samplerates(client);
+  tci_send_text(client, "audio_stream_sample_type:float32;");
+  tci_send_text(client, "audio_stream_channels:2;");
   tci_send_text(client, "start;");
   tci_send_text(client, "ready;");
+  g_mutex_lock(&tci_mutex);
+  client->report = 1;
+  g_mutex_unlock(&tci_mutex);
 
   while (client->running) {
     int numbytes;
@@ -1159,6 +1882,31 @@ static gpointer tci_listener(gpointer data) {
           tci_send_keyer_cwspeed(client);
         } else if (!strcmp(arg[0], "cw_macros_delay")) {
           tci_send_text(client, "cw_macros_delay:10;");
+        } else if (!strcmp(arg[0], "iq_samplerate") && argc > 1) {
+          int rate = atoi(arg[1]);
+
+          if (rate == 48000 || rate == 96000 || rate == 192000 || rate == 384000) {
+            tci_iq_rate = rate;
+          }
+
+          tci_send_samplerates(client);
+        } else if (!strcmp(arg[0], "audio_samplerate") && argc > 1) {
+          int rate = atoi(arg[1]);
+
+          if (rate == 8000 || rate == 12000 || rate == 24000 || rate == 48000) {
+            tci_audio_rate = rate;
+          }
+
+          tci_send_samplerates(client);
+        } else if (!strcmp(arg[0], "audio_stream_sample_type")) {
+          // only float32 is supported
+          tci_send_text(client, "audio_stream_sample_type:float32;");
+        } else if (!strcmp(arg[0], "audio_stream_channels")) {
+          // only stereo is supported
+          tci_send_text(client, "audio_stream_channels:2;");
+        } else if ((!strcmp(arg[0], "iq_start") || !strcmp(arg[0], "iq_stop") ||
+                    !strcmp(arg[0], "audio_start") || !strcmp(arg[0], "audio_stop")) && argc > 1) {
+          tci_stream_subscribe(client, arg[0], atoi(arg[1]));
         } else if (!strcmp(arg[0], "stop")) {
           client->rxsensor = 0;
           client->txsensor = 0;
@@ -1201,6 +1949,12 @@ static gpointer tci_listener(gpointer data) {
 
   tci_send_text(client, "stop;");
   tci_send_close(client);
+  tci_flush(client);
+  g_mutex_lock(&tci_mutex);
+  t_print("%s: TCI%d queued=%ld sent=%ld bytes=%ld coalesced=%ld dropped=%ld maxdepth=%d\n",
+          __FUNCTION__, client->seq, client->st_queued, client->st_sent, client->st_bytes,
+          client->st_coalesced, client->st_dropped, client->st_hiwater);
+  g_mutex_unlock(&tci_mutex);
   force_close(client);
   t_print("%s: leaving thread\n", __FUNCTION__);
   // update CAT status onscreen
@@ -25,3 +25,9 @@ extern int tci_txonly; // only report TX frequency
 
 void launch_tci(void);
 void shutdown_tci(void);
+
+//
+// Binary IQ and audio streaming, called from the RX threads
+//
+void tci_rx_iq(int id, const double *iq, int n, int rate);
+void tci_rx_audio(int id, const double *audio, int n, int rate);
@@ -1353,6 +1353,8 @@ TRANSMITTER *tx_create_transmitter(int id, int pixels, int width, int height) {
   tx->mic_input_buffer = g_new(double, 2 * tx->buffer_size);
   tx->iq_output_buffer = g_new(double, 2 * tx->output_samples);
   tx->cw_sig_rf = g_new(double, tx->output_samples);
+  tx->iq_int_buffer = g_new(int, 2 * tx->output_samples);
+  tx->sidetone_buffer = g_new(int, tx->output_samples);
   tx->samples = 0;
   tx->pixel_samples = g_new(float, tx->pixels);
   g_mutex_init(&tx->cw_ramp_mutex);
@@ -1675,8 +1677,12 @@ static void tx_full_buffer(TRANSMITTER *tx) {
           double ramp = tx->cw_sig_rf[j];       // between 0.0 and 1.0
           isample = floor(gain * ramp + 0.5);   // always non-negative, isample is just the pulse envelope
           sidetone = sidevol * ramp * sine_generator(&p1radio, &p2radio, cw_keyer_sidetone_frequency);
-          old_protocol_iq_samples(isample, 0, sidetone);
+          tx->iq_int_buffer[2 * j] = isample;
+          tx->iq_int_buffer[2 * j + 1] = 0;
+          tx->sidetone_buffer[j] = sidetone;
         }
+
+        old_protocol_iq_block(tx->iq_int_buffer, tx->sidetone_buffer, tx->output_samples);
       }
       break;
 
@@ -1694,9 +1700,12 @@ static void tx_full_buffer(TRANSMITTER *tx) {
         for (j = 0; j < tx->output_samples; j++) {
           double ramp = tx->cw_sig_rf[j];                  // between 0.0 and 1.0
           isample = floor(0.896 * gain * ramp + 0.5);      // always non-negative, isample is just the pulse envelope
-          new_protocol_iq_samples(isample, 0);
+          tx->iq_int_buffer[2 * j] = isample;
+          tx->iq_int_buffer[2 * j + 1] = 0;
         }
 
+        new_protocol_iq_block(tx->iq_int_buffer, tx->output_samples);
+
         break;
 #ifdef SOAPYSDR
 
@@ -1718,29 +1727,36 @@ static void tx_full_buffer(TRANSMITTER *tx) {
       //
       // Original code without pulse shaping and without side tone
       //
-      for (j = 0; j < tx->output_samples; j++) {
-        double is, qs;
-        is = tx->iq_output_buffer[j * 2];
-        qs = tx->iq_output_buffer[(j * 2) + 1];
-        isample = is >= 0.0 ? (long)floor(is * gain + 0.5) : (long)ceil(is * gain - 0.5);
-        qsample = qs >= 0.0 ? (long)floor(qs * gain + 0.5) : (long)ceil(qs * gain - 0.5);
+      switch (protocol) {
+      case ORIGINAL_PROTOCOL:
+      case NEW_PROTOCOL:
+        for (j = 0; j < tx->output_samples; j++) {
+          double is, qs;
+          is = tx->iq_output_buffer[j * 2];
+          qs = tx->iq_output_buffer[(j * 2) + 1];
+          isample = is >= 0.0 ? (long)floor(is * gain + 0.5) : (long)ceil(is * gain - 0.5);
+          qsample = qs >= 0.0 ? (long)floor(qs * gain + 0.5) : (long)ceil(qs * gain - 0.5);
+          tx->iq_int_buffer[2 * j] = isample;
+          tx->iq_int_buffer[2 * j + 1] = qsample;
+        }
 
-        switch (protocol) {
-        case ORIGINAL_PROTOCOL:
-          old_protocol_iq_samples(isample, qsample, 0);
-          break;
+        if (protocol == ORIGINAL_PROTOCOL) {
+          old_protocol_iq_block(tx->iq_int_buffer, NULL, tx->output_samples);
+        } else {
+          new_protocol_iq_block(tx->iq_int_buffer, tx->output_samples);
+        }
 
-        case NEW_PROTOCOL:
-          new_protocol_iq_samples(isample, qsample);
-          break;
+        break;
 #ifdef SOAPYSDR
 
-        case SOAPYSDR_PROTOCOL:
+      case SOAPYSDR_PROTOCOL:
+        for (j = 0; j < tx->output_samples; j++) {
           // SOAPY: just convert the double IQ samples (is,qs) to float.
-          soapy_protocol_iq_samples((float)is, (float)qs);
-          break;
-#endif
+          soapy_protocol_iq_samples((float)tx->iq_output_buffer[j * 2], (float)tx->iq_output_buffer[(j * 2) + 1]);
         }
+
+        break;
+#endif
       }
     }
   } else {   // radio_is_transmitting()
@@ -1965,6 +1981,53 @@ void tx_add_mic_sample(TRANSMITTER *tx, float mic_sample) {
   }
 }
 
+//
+// Called when the PS feedback buffers are full
+//
+static void tx_ps_full_buffer(const TRANSMITTER *tx) {
+  RECEIVER *tx_feedback = receiver[PS_TX_FEEDBACK];
+  RECEIVER *rx_feedback = receiver[PS_RX_FEEDBACK];
+
+  if (radio_is_transmitting()) {
+    int txmode = vfo_get_tx_mode();
+    int cwmode = (txmode == modeCWL || txmode == modeCWU) && !tune && !tx->twotone;
+#if 0
+    //
+    // Special code to document the amplitude of the TX IQ samples.
+    // This can be used to determine the "PK" value for an unknown
+    // radio.
+    //
+    double pkmax = 0.0, pkval;
+
+    for (int i = 0; i < rx_feedback->buffer_size; i++) {
+      pkval = tx_feedback->iq_input_buffer[2 * i] * tx_feedback->iq_input_buffer[2 * i] +
+              tx_feedback->iq_input_buffer[2 * i + 1] * tx_feedback->iq_input_buffer[2 * i + 1];
+
+      if (pkval > pkmax) { pkmax = pkval; }
+    }
+
+    t_print("PK MEASURED: %f\n", sqrt(pkmax));
+#endif
+
+    if (!cwmode) {
+      //
+      // Since we are not using WDSP in CW transmit, it also makes little sense to
+      // deliver feedback samples
+      //
+      pscc(tx->id, rx_feedback->buffer_size, tx_feedback->iq_input_buffer, rx_feedback->iq_input_buffer);
+    }
+
+    if (tx->displaying && tx->feedback) {
+      g_mutex_lock(&rx_feedback->display_mutex);
+      Spectrum0(1, rx_feedback->id, 0, 0, rx_feedback->iq_input_buffer);
+      g_mutex_unlock(&rx_feedback->display_mutex);
+    }
+  }
+
+  rx_feedback->samples = 0;
+  tx_feedback->samples = 0;
+}
+
 void tx_add_ps_iq_samples(const TRANSMITTER *tx, double i_sample_tx, double q_sample_tx, double i_sample_rx,
                           double q_sample_rx) {
   RECEIVER *tx_feedback = receiver[PS_TX_FEEDBACK];
@@ -1985,44 +2048,43 @@ void tx_add_ps_iq_samples(const TRANSMITTER *tx, double i_sample_tx, double q_sa
   rx_feedback->samples = rx_feedback->samples + 1;
 
   if (rx_feedback->samples >= rx_feedback->buffer_size) {
-    if (radio_is_transmitting()) {
-      int txmode = vfo_get_tx_mode();
-      int cwmode = (txmode == modeCWL || txmode == modeCWU) && !tune && !tx->twotone;
-#if 0
-      //
-      // Special code to document the amplitude of the TX IQ samples.
-      // This can be used to determine the "PK" value for an unknown
-      // radio.
-      //
-      double pkmax = 0.0, pkval;
+    tx_ps_full_buffer(tx);
+  }
+}
 
-      for (int i = 0; i < rx_feedback->buffer_size; i++) {
-        pkval = tx_feedback->iq_input_buffer[2 * i] * tx_feedback->iq_input_buffer[2 * i] +
-                tx_feedback->iq_input_buffer[2 * i + 1] * tx_feedback->iq_input_buffer[2 * i + 1];
+//
+// Block version of tx_add_ps_iq_samples.
+// iq contains n frames of four values in the order they
+// arrive from the radio: i_rx, q_rx, i_tx, q_tx
+//
+void tx_add_ps_iq_block(const TRANSMITTER *tx, const double *iq, int n) {
+  RECEIVER *tx_feedback = receiver[PS_TX_FEEDBACK];
+  RECEIVER *rx_feedback = receiver[PS_RX_FEEDBACK];
+  double scale = tx->do_scale ? tx->drive_iscal : 1.0;
 
-        if (pkval > pkmax) { pkmax = pkval; }
-      }
+  while (n > 0) {
+    int chunk = rx_feedback->buffer_size - rx_feedback->samples;
 
-      t_print("PK MEASURED: %f\n", sqrt(pkmax));
-#endif
+    if (chunk > n) { chunk = n; }
 
-      if (!cwmode) {
-        //
-        // Since we are not using WDSP in CW transmit, it also makes little sense to
-        // deliver feedback samples
-        //
-        pscc(tx->id, rx_feedback->buffer_size, tx_feedback->iq_input_buffer, rx_feedback->iq_input_buffer);
-      }
+    double *txp = tx_feedback->iq_input_buffer + 2 * tx_feedback->samples;
+    double *rxp = rx_feedback->iq_input_buffer + 2 * rx_feedback->samples;
 
-      if (tx->displaying && tx->feedback) {
-        g_mutex_lock(&rx_feedback->display_mutex);
-        Spectrum0(1, rx_feedback->id, 0, 0, rx_feedback->iq_input_buffer);
-        g_mutex_unlock(&rx_feedback->display_mutex);
-      }
+    for (int i = 0; i < chunk; i++) {
+      *rxp++ = iq[0];
+      *rxp++ = iq[1];
+      *txp++ = iq[2] * scale;
+      *txp++ = iq[3] * scale;
+      iq += 4;
     }
 
-    rx_feedback->samples = 0;
-    tx_feedback->samples = 0;
+    tx_feedback->samples += chunk;
+    rx_feedback->samples += chunk;
+    n -= chunk;
+
+    if (rx_feedback->samples >= rx_feedback->buffer_size) {
+      tx_ps_full_buffer(tx);
+    }
   }
 }
 
@@ -44,6 +44,8 @@ typedef struct _transmitter {
   int ratio;
   double *mic_input_buffer;
   double *iq_output_buffer;
+  int *iq_int_buffer;         // scaled TX IQ samples for the protocol block functions
+  int *sidetone_buffer;       // P1 CW side tone samples
 
   float *pixel_samples;
   int display_panadapter;
@@ -235,6 +237,7 @@ extern void   cw_hold_key(int state);
 extern void   tx_add_mic_sample(TRANSMITTER *tx, float mic_sample);
 extern void   tx_add_ps_iq_samples(const TRANSMITTER *tx, double i_sample_0, double q_sample_0, double i_sample_1,
                                    double q_sample_1);
+extern void   tx_add_ps_iq_block(const TRANSMITTER *tx, const double *iq, int n);
 
 extern void   tx_close(const TRANSMITTER *tx);
 extern void   tx_create_analyzer(const TRANSMITTER *tx);
@@ -25,6 +25,14 @@
 #include <unistd.h>
 #include <semaphore.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
 #include "radio.h"
 #include "vfo.h"
 #include "band.h"
@@ -48,9 +56,170 @@ static int colorHighB = 0;
 
 static double hz_per_pixel;
 
+//
+// Colour palette: a sample is quantized to an index into this table,
+// entry 0 is for samples below the waterfall range, entry WF_LUT_SIZE+1
+// for samples above, and entries 1 ... WF_LUT_SIZE cover the range itself.
+// Since the waterfall range is applied when quantizing, the table only
+// depends on the low and high colours, and is only re-built if these change.
+// The entries are in the pixel format of a CAIRO_FORMAT_RGB24 surface.
+//
+#define WF_LUT_SIZE 1024
+
+static uint32_t wf_lut[WF_LUT_SIZE + 2];
+static int wf_lut_colors[6] = { -1, -1, -1, -1, -1, -1 };
+
+//
+// Value of rx->waterfall_row_x[] for rows that are blank, and the limit
+// for rx->waterfall_x after which the row offsets are re-based.
+//
+#define WF_ROW_BLANK INT_MIN
+#define WF_X_LIMIT   (1 << 28)
+
+static inline uint32_t wf_rgb(int r, int g, int b) {
+  return ((uint32_t) r << 16) | ((uint32_t) g << 8) | (uint32_t) b;
+}
+
+static void wf_palette(float percent, unsigned char *p) {
+  if (percent < 0.222222f) {
+    float local_percent = percent * 4.5f;
+    *p++ = (int)((1.0f - local_percent) * colorLowR);
+    *p++ = (int)((1.0f - local_percent) * colorLowG);
+    *p++ = (int)(colorLowB + local_percent * (255 - colorLowB));
+  } else if (percent < 0.333333f) {
+    float local_percent = (percent - 0.222222f) * 9.0f;
+    *p++ = 0;
+    *p++ = (int)(local_percent * 255);
+    *p++ = 255;
+  } else if (percent < 0.444444f) {
+    float local_percent = (percent - 0.333333) * 9.0f;
+    *p++ = 0;
+    *p++ = 255;
+    *p++ = (int)((1.0f - local_percent) * 255);
+  } else if (percent < 0.555555f) {
+    float local_percent = (percent - 0.444444f) * 9.0f;
+    *p++ = (int)(local_percent * 255);
+    *p++ = 255;
+    *p++ = 0;
+  } else if (percent < 0.777777f) {
+    float local_percent = (percent - 0.555555f) * 4.5f;
+    *p++ = 255;
+    *p++ = (int)((1.0f - local_percent) * 255);
+    *p++ = 0;
+  } else if (percent < 0.888888f) {
+    float local_percent = (percent - 0.777777f) * 9.0f;
+    *p++ = 255;
+    *p++ = 0;
+    *p++ = (int)(local_percent * 255);
+  } else {
+    float local_percent = (percent - 0.888888f) * 9.0f;
+    *p++ = (int)((0.75f + 0.25f * (1.0f - local_percent)) * 255.0f);
+    *p++ = (int)(local_percent * 255.0f * 0.5f);
+    *p++ = 255;
+  }
+}
+
+static void wf_build_lut() {
+  int colors[6] = { colorLowR, colorLowG, colorLowB, colorHighR, colorHighG, colorHighB };
+
+  if (memcmp(colors, wf_lut_colors, sizeof(colors)) == 0) { return; }
+
+  wf_lut[0] = wf_rgb(colorLowR, colorLowG, colorLowB);
+
+  for (int i = 0; i < WF_LUT_SIZE; i++) {
+    unsigned char c[3];
+    wf_palette((float) i / (float)(WF_LUT_SIZE - 1), c);
+    wf_lut[i + 1] = wf_rgb(c[0], c[1], c[2]);
+  }
+
+  wf_lut[WF_LUT_SIZE + 1] = wf_rgb(colorHighR, colorHighG, colorHighB);
+  memcpy(wf_lut_colors, colors, sizeof(colors));
+}
+
+//
+// Quantize n samples to palette indices: idx = sample * scale + bias,
+// truncated and clamped to 0 ... WF_LUT_SIZE+1.
+// SSE2 (always present on x86_64) or NEON do 8 samples per iteration.
+//
+static void wf_quantize(const float *samples, int n, float scale, float bias, uint16_t *idx) {
+  const float top = (float)(WF_LUT_SIZE + 1);
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 vbias = _mm_set1_ps(bias);
+  const __m128 vzero = _mm_setzero_ps();
+  const __m128 vtop = _mm_set1_ps(top);
+
+  for (; i + 8 <= n; i += 8) {
+    __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(samples + i), vscale), vbias);
+    __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(samples + i + 4), vscale), vbias);
+    a = _mm_min_ps(_mm_max_ps(a, vzero), vtop);
+    b = _mm_min_ps(_mm_max_ps(b, vzero), vtop);
+    _mm_storeu_si128((__m128i *)(idx + i), _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b)));
+  }
+
+#elif defined(__ARM_NEON)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  const float32x4_t vbias = vdupq_n_f32(bias);
+  const float32x4_t vzero = vdupq_n_f32(0.0f);
+  const float32x4_t vtop = vdupq_n_f32(top);
+
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t a = vmlaq_f32(vbias, vld1q_f32(samples + i), vscale);
+    float32x4_t b = vmlaq_f32(vbias, vld1q_f32(samples + i + 4), vscale);
+    a = vminq_f32(vmaxq_f32(a, vzero), vtop);
+    b = vminq_f32(vmaxq_f32(b, vzero), vtop);
+    vst1q_u16(idx + i, vcombine_u16(vmovn_u32(vcvtq_u32_f32(a)), vmovn_u32(vcvtq_u32_f32(b))));
+  }
+
+#endif
+
+  for (; i < n; i++) {
+    float t = samples[i] * scale + bias;
+
+    if (t < 0.0f) { t = 0.0f; }
+
+    if (t > top) { t = top; }
+
+    idx[i] = (uint16_t) t;
+  }
+}
+
 static int my_width;
 static int my_height;
 
+//
+// Mark all rows as blank. This is used instead of clearing the pixels
+// whenever the waterfall has to be re-initialized.
+//
+static void wf_clear_rows(RECEIVER *rx) {
+  int height = cairo_image_surface_get_height(rx->waterfall_surface);
+
+  for (int i = 0; i < height; i++) {
+    rx->waterfall_row_x[i] = WF_ROW_BLANK;
+  }
+
+  rx->waterfall_x = 0;
+}
+
+//
+// Keep rx->waterfall_x (and thus the row offsets) within bounds.
+// Rows that are shifted out of sight become blank.
+//
+static void wf_rebase_rows(RECEIVER *rx) {
+  int height = cairo_image_surface_get_height(rx->waterfall_surface);
+  int width = cairo_image_surface_get_width(rx->waterfall_surface);
+
+  for (int i = 0; i < height; i++) {
+    if (rx->waterfall_row_x[i] != WF_ROW_BLANK) {
+      int dx = rx->waterfall_x - rx->waterfall_row_x[i];
+      rx->waterfall_row_x[i] = (dx >= width || dx <= -width) ? WF_ROW_BLANK : -dx;
+    }
+  }
+
+  rx->waterfall_x = 0;
+}
+
 /* Create a new surface of the appropriate size to store our scribbles */
 static gboolean
 waterfall_configure_event_cb (GtkWidget         *widget,
@@ -59,12 +228,56 @@ waterfall_configure_event_cb (GtkWidget         *widget,
   RECEIVER *rx = (RECEIVER *)data;
   my_width = gtk_widget_get_allocated_width (widget);
   my_height = gtk_widget_get_allocated_height (widget);
-  rx->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, my_width, my_height);
-  unsigned char *pixels = gdk_pixbuf_get_pixels (rx->pixbuf);
-  memset(pixels, 0, my_width * my_height * 3);
+
+  if (rx->waterfall_surface) {
+    cairo_surface_destroy(rx->waterfall_surface);
+  }
+
+  rx->waterfall_surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, my_width, my_height);
+  g_free(rx->waterfall_row_x);
+  rx->waterfall_row_x = g_new(int, my_height);
+  rx->waterfall_row = 0;
+  cairo_surface_flush(rx->waterfall_surface);
+  unsigned char *pixels = cairo_image_surface_get_data (rx->waterfall_surface);
+  memset(pixels, 0, cairo_image_surface_get_stride(rx->waterfall_surface) * my_height);
+  cairo_surface_mark_dirty(rx->waterfall_surface);
+  wf_clear_rows(rx);
   return TRUE;
 }
 
+//
+// Paint n consecutive rows of the surface, starting with surface row "row",
+// at widget position y. All these rows have the same horizontal offset,
+// and the part of the widget not covered by them is painted black.
+//
+static void wf_paint_rows(cairo_t *cr, const RECEIVER *rx, int row, int y, int n, int width) {
+  int dx = width;
+
+  if (rx->waterfall_row_x[row] != WF_ROW_BLANK) {
+    dx = rx->waterfall_x - rx->waterfall_row_x[row];
+  }
+
+  if (dx > -width && dx < width) {
+    cairo_set_source_surface(cr, rx->waterfall_surface, dx, y - row);
+    cairo_rectangle(cr, dx > 0 ? dx : 0, y, width - abs(dx), n);
+    cairo_fill(cr);
+  }
+
+  if (dx != 0) {
+    cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+
+    if (dx >= width || dx <= -width) {
+      cairo_rectangle(cr, 0, y, width, n);
+    } else if (dx > 0) {
+      cairo_rectangle(cr, 0, y, dx, n);
+    } else {
+      cairo_rectangle(cr, width + dx, y, -dx, n);
+    }
+
+    cairo_fill(cr);
+  }
+}
+
 /* Redraw the screen from the surface. Note that the ::draw
  * signal receives a ready-to-be-used cairo_t that is already
  * clipped to only draw the exposed areas of the widget
@@ -81,8 +294,34 @@ waterfall_draw_cb (GtkWidget *widget,
   int b_height = allocation.height;
   int box_height = 30;
   //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-  gdk_cairo_set_source_pixbuf (cr, rx->pixbuf, 0, 0);
-  cairo_paint (cr); // vor dem Zeichnen der Box aufrufen, sinst wird der pixbuf überschrieben !
+  //
+  // The surface is used as a ring of rows, the most recent line is in
+  // row rx->waterfall_row, and it is painted at the top of the widget.
+  // Each row has its own horizontal offset (since the waterfall is not
+  // shifted when the frequency changes), so paint runs of consecutive
+  // rows with the same offset, ending at the end of the surface.
+  // Usually there are only a few such runs. Runs outside the clip
+  // region are skipped.
+  // Paint before drawing the info box, otherwise it would be overwritten!
+  //
+  int height = cairo_image_surface_get_height(rx->waterfall_surface);
+  int width = cairo_image_surface_get_width(rx->waterfall_surface);
+  double clip_x1, clip_y1, clip_x2, clip_y2;
+  cairo_clip_extents(cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+
+  for (int y = 0; y < height;) {
+    int row = (rx->waterfall_row + y) % height;
+    int x = rx->waterfall_row_x[row];
+    int n = 1;
+
+    while (y + n < height && row + n < height && rx->waterfall_row_x[row + n] == x) { n++; }
+
+    if (y + n > clip_y1 && y < clip_y2) {
+      wf_paint_rows(cr, rx, row, y, n, width);
+    }
+
+    y += n;
+  }
 
   //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
   if (display_info_bar && active_receiver->display_waterfall && (active_receiver->display_panadapter == 0
@@ -206,24 +445,168 @@ static gboolean waterfall_scroll_event_cb (GtkWidget *widget, GdkEventScroll *ev
   return rx_scroll_event(widget, event, data);
 }
 
+//
+// Determine the mapping from (uncorrected) dB values to palette indices,
+// index = value * scale + bias, from the waterfall range and all
+// corrections due to attenuation, preamps, etc.
+//
+static void wf_levels(RECEIVER *rx, int pan, int width, float *scale, float *bias) {
+  float soffset;
+  float wf_low, wf_high, rangei;
+  int id = rx->id;
+  int b = vfo[id].band;
+  const BAND *band = band_get_band(b);
+  int calib = rx_gain_calibration - band->gain;
+  //
+  // soffset contains all corrections due to attenuation, preamps, etc.
+  //
+#ifdef SOAPYSDR
+
+  if (device == SOAPYSDR_USB_DEVICE && strcmp(radio->name, "sdrplay") == 0) {
+    int v_Gain = (int)soapy_protocol_get_gain_element(active_receiver, "CURRENT");
+    adc[rx->adc].gain = 0;
+    adc[rx->adc].attenuation = 0;
+    adc[rx->adc].gain = v_Gain;
+    // t_print("%s: adc[rx->adc].gain = %f adc[rx->adc].attenuation = %f calib = %f\n", __FUNCTION__, adc[rx->adc].gain,adc[rx->adc].attenuation, calib);
+  }
+
+#endif
+  soffset = (float)(calib + adc[rx->adc].attenuation - adc[rx->adc].gain);
+
+  if (filter_board == ALEX && rx->adc == 0) {
+    soffset += (float)(10 * rx->alex_attenuation - 20 * rx->preamp);
+  }
+
+  if (filter_board == CHARLY25 && rx->adc == 0) {
+    soffset += (float)(12 * rx->alex_attenuation - 18 * rx->preamp - 18 * rx->dither);
+  }
+
+  if (rx->waterfall_automatic) {
+    //
+    // use the same noise floor estimate as the panadapter autoscale
+    //
+    wf_low = rx_noise_floor(rx, pan, width, RX_NOISE_FLOOR_PERCENTILE) + soffset - 5.0F;
+    wf_high = wf_low + 55.0F;
+  } else {
+    wf_low  = (float) rx->waterfall_low;
+    wf_high = (float) rx->waterfall_high;
+  }
+
+  rangei = 1.0F / (wf_high - wf_low);
+  *scale = (float)(WF_LUT_SIZE - 1) * rangei;
+  *bias = (soffset - wf_low) * *scale + 1.0F;
+}
+
+//
+// Convert width samples to palette indices in chunks, look up the
+// colours, and store them in the given row of the surface.
+//
+static void wf_render_row(RECEIVER *rx, int row, const float *samples, int width, float scale, float bias) {
+  unsigned char *pixels = cairo_image_surface_get_data (rx->waterfall_surface);
+  int rowstride = cairo_image_surface_get_stride(rx->waterfall_surface);
+  uint32_t *p = (uint32_t *)(pixels + row * rowstride);
+
+  for (int i = 0; i < width; i += 256) {
+    uint16_t idx[256];
+    int n = (width - i < 256) ? width - i : 256;
+    wf_quantize(samples + i, n, scale, bias, idx);
+
+    for (int j = 0; j < n; j++) {
+      *p++ = wf_lut[idx[j]];
+    }
+  }
+
+  rx->waterfall_row_x[row] = rx->waterfall_x;
+}
+
+//
+// Re-generate the waterfall from the spectrum history, for the current
+// VFO frequency, zoom, pan and waterfall range. Each frame is mapped
+// to the current view using the VFO frequency and span stored with it,
+// so this also works after zoom, sample rate, or frequency changes.
+// Parts of the view not covered by a frame get the "low" colour.
+// Returns FALSE (and does nothing) if there is no history.
+//
+static int wf_rebuild(RECEIVER *rx) {
+  const SPECTRUM_HISTORY *h = rx->history;
+
+  if (rx->waterfall_surface == NULL || h == NULL || h->count == 0) { return FALSE; }
+
+  long long vfofreq = vfo[rx->id].frequency;
+  int pan = rx->pan;
+  int width = cairo_image_surface_get_width(rx->waterfall_surface);
+  int height = cairo_image_surface_get_height(rx->waterfall_surface);
+  double hz = (double)rx->sample_rate / (double)rx->pixels;
+  float *frame = g_new(float, h->pixels);
+  float *line = g_new(float, width);
+  float scale, bias;
+  wf_levels(rx, pan, width, &scale, &bias);
+  wf_build_lut();
+  wf_clear_rows(rx);
+  cairo_surface_flush(rx->waterfall_surface);
+
+  for (int age = 0; age < height; age++) {
+    const SPECTRUM_FRAME *f = spectrum_history_get(h, age, frame);
+
+    if (f == NULL) { break; }
+
+    //
+    // column c of the view corresponds to index x0 + c * dx of the frame
+    //
+    double fhz = (double)f->sample_rate / (double)f->pixels;
+    double x0 = ((double)(vfofreq - f->frequency) + (pan - 0.5 * rx->pixels) * hz) / fhz + 0.5 * f->pixels;
+    double dx = hz / fhz;
+
+    for (int c = 0; c < width; c++) {
+      int i = (int) floor(x0 + c * dx);
+      line[c] = (i >= 0 && i < f->pixels) ? frame[i] : -400.0F;
+    }
+
+    wf_render_row(rx, (rx->waterfall_row + age) % height, line, width, scale, bias);
+  }
+
+  cairo_surface_mark_dirty(rx->waterfall_surface);
+  g_free(frame);
+  g_free(line);
+  rx->waterfall_frequency = vfofreq;
+  rx->waterfall_pan = pan;
+  rx->waterfall_zoom = rx->zoom;
+  rx->waterfall_sample_rate = rx->sample_rate;
+  return TRUE;
+}
+
+//
+// Re-generate the waterfall after the waterfall range has been changed
+// (menu, actions). This is called from the GTK main loop.
+//
+void waterfall_regenerate(RECEIVER *rx) {
+  g_mutex_lock(&rx->display_mutex);
+
+  if (rx->display_waterfall && wf_rebuild(rx)) {
+    gtk_widget_queue_draw (rx->waterfall);
+  }
+
+  g_mutex_unlock(&rx->display_mutex);
+}
+
 void waterfall_update(RECEIVER *rx) {
-  if (rx->pixbuf) {
-    const float *samples;
+  if (rx->waterfall_surface) {
     long long vfofreq = vfo[rx->id].frequency; // access only once to be thread-safe
     int  freq_changed = 0;                    // flag whether we have just "rotated"
     int pan = rx->pan;
     int zoom = rx->zoom;
-    unsigned char *pixels = gdk_pixbuf_get_pixels (rx->pixbuf);
-    int width = gdk_pixbuf_get_width(rx->pixbuf);
-    int height = gdk_pixbuf_get_height(rx->pixbuf);
-    int rowstride = gdk_pixbuf_get_rowstride(rx->pixbuf);
+    int width = cairo_image_surface_get_width(rx->waterfall_surface);
+    int height = cairo_image_surface_get_height(rx->waterfall_surface);
     hz_per_pixel = (double)rx->sample_rate / ((double)my_width * rx->zoom);
 
     //
     // The existing waterfall corresponds to a VFO frequency rx->waterfall_frequency, a zoom value rx->waterfall_zoom and
     // a pan value rx->waterfall_pan. If the zoom value changes, or if the waterfill needs horizontal shifting larger
     // than the width of the waterfall (band change or big frequency jump), re-init the waterfall.
-    // Otherwise, shift the waterfall by an appropriate number of pixels.
+    // Otherwise, shift the waterfall by an appropriate number of pixels. The pixels are not moved, this
+    // only changes rx->waterfall_x, which is applied when painting (see waterfall_draw_cb).
+    // Upon re-init, the waterfall is re-generated from the spectrum history, which already
+    // contains the current spectrum, so there is nothing more to do in this case.
     //
     // Note that VFO frequency changes can occur in very many very small steps, such that in each step, the horizontal
     // shifting is only a fraction of one pixel. In this case, there will be every now and then a horizontal shift that
@@ -243,7 +626,12 @@ void waterfall_update(RECEIVER *rx) {
           //
           // If horizontal shift is too large, re-init waterfall
           //
-          memset(pixels, 0, my_width * my_height * 3);
+          if (wf_rebuild(rx)) {
+            gtk_widget_queue_draw (rx->waterfall);
+            return;
+          }
+
+          wf_clear_rows(rx);
           rx->waterfall_frequency = vfofreq;
           rx->waterfall_pan = pan;
         } else {
@@ -251,21 +639,10 @@ void waterfall_update(RECEIVER *rx) {
           // If rotate_pixels != 0, shift waterfall horizontally and set "freq changed" flag
           // calculated which VFO/pan value combination the shifted waterfall corresponds to
           //
-          //
-          if (rotate_pixels < 0) {
-            // shift left, and clear the right-most part
-            memmove(pixels, &pixels[-rotate_pixels * 3], ((my_width * my_height) + rotate_pixels) * 3);
-
-            for (int i = 0; i < my_height; i++) {
-              memset(&pixels[((i * my_width) + (width + rotate_pixels)) * 3], 0, -rotate_pixels * 3);
-            }
-          } else if (rotate_pixels > 0) {
-            // shift right, and clear left-most part
-            memmove(&pixels[rotate_pixels * 3], pixels, ((my_width * my_height) - rotate_pixels) * 3);
-
-            for (int i = 0; i < my_height; i++) {
-              memset(&pixels[(i * my_width) * 3], 0, rotate_pixels * 3);
-            }
+          rx->waterfall_x += rotate_pixels;
+
+          if (rx->waterfall_x >= WF_X_LIMIT || rx->waterfall_x <= -WF_X_LIMIT) {
+            wf_rebase_rows(rx);
           }
 
           if (rotfreq != 0) {
@@ -281,7 +658,12 @@ void waterfall_update(RECEIVER *rx) {
       // waterfall frequency not (yet) set, sample rate changed, or zoom value changed:
       // (re-) init waterfall
       //
-      memset(pixels, 0, my_width * my_height * 3);
+      if (wf_rebuild(rx)) {
+        gtk_widget_queue_draw (rx->waterfall);
+        return;
+      }
+
+      wf_clear_rows(rx);
       rx->waterfall_frequency = vfofreq;
       rx->waterfall_pan = pan;
       rx->waterfall_zoom = zoom;
@@ -299,108 +681,21 @@ void waterfall_update(RECEIVER *rx) {
     // improvement.
     //
     if (!freq_changed) {
-      memmove(&pixels[rowstride], pixels, (height - 1)*rowstride);
-      float soffset;
-      unsigned char *p;
-      p = pixels;
-      samples = rx->pixel_samples;
-      float wf_low, wf_high, rangei;
-      int id = rx->id;
-      int b = vfo[id].band;
-      const BAND *band = band_get_band(b);
-      int calib = rx_gain_calibration - band->gain;
       //
-      // soffset contains all corrections due to attenuation, preamps, etc.
+      // Instead of moving the whole waterfall down by one row,
+      // the new line goes into the row above the most recent one.
       //
-#ifdef SOAPYSDR
-
-      if (device == SOAPYSDR_USB_DEVICE && strcmp(radio->name, "sdrplay") == 0) {
-        int v_Gain = (int)soapy_protocol_get_gain_element(active_receiver, "CURRENT");
-        adc[rx->adc].gain = 0;
-        adc[rx->adc].attenuation = 0;
-        adc[rx->adc].gain = v_Gain;
-        // t_print("%s: adc[rx->adc].gain = %f adc[rx->adc].attenuation = %f calib = %f\n", __FUNCTION__, adc[rx->adc].gain,adc[rx->adc].attenuation, calib);
-      }
-
-#endif
-      soffset = (float)(calib + adc[rx->adc].attenuation - adc[rx->adc].gain);
+      int row = rx->waterfall_row - 1;
 
-      if (filter_board == ALEX && rx->adc == 0) {
-        soffset += (float)(10 * rx->alex_attenuation - 20 * rx->preamp);
-      }
-
-      if (filter_board == CHARLY25 && rx->adc == 0) {
-        soffset += (float)(12 * rx->alex_attenuation - 18 * rx->preamp - 18 * rx->dither);
-      }
-
-      if (rx->waterfall_automatic) {
-        float average = 0.0F;
+      if (row < 0) { row = height - 1; }
 
-        for (int i = 0; i < width; i++) {
-          average += samples[i];
-        }
-
-        wf_low = (average / (float)width) + soffset - 5.0F;
-        wf_high = wf_low + 55.0F;
-      } else {
-        wf_low  = (float) rx->waterfall_low;
-        wf_high = (float) rx->waterfall_high;
-      }
-
-      rangei = 1.0F / (wf_high - wf_low);
-
-      for (int i = 0; i < width; i++) {
-        float sample = samples[i + pan] + soffset;
-
-        if (sample < wf_low) {
-          *p++ = colorLowR;
-          *p++ = colorLowG;
-          *p++ = colorLowB;
-        } else if (sample > wf_high) {
-          *p++ = colorHighR;
-          *p++ = colorHighG;
-          *p++ = colorHighB;
-        } else {
-          float percent = (sample - wf_low) * rangei;
-
-          if (percent < 0.222222f) {
-            float local_percent = percent * 4.5f;
-            *p++ = (int)((1.0f - local_percent) * colorLowR);
-            *p++ = (int)((1.0f - local_percent) * colorLowG);
-            *p++ = (int)(colorLowB + local_percent * (255 - colorLowB));
-          } else if (percent < 0.333333f) {
-            float local_percent = (percent - 0.222222f) * 9.0f;
-            *p++ = 0;
-            *p++ = (int)(local_percent * 255);
-            *p++ = 255;
-          } else if (percent < 0.444444f) {
-            float local_percent = (percent - 0.333333) * 9.0f;
-            *p++ = 0;
-            *p++ = 255;
-            *p++ = (int)((1.0f - local_percent) * 255);
-          } else if (percent < 0.555555f) {
-            float local_percent = (percent - 0.444444f) * 9.0f;
-            *p++ = (int)(local_percent * 255);
-            *p++ = 255;
-            *p++ = 0;
-          } else if (percent < 0.777777f) {
-            float local_percent = (percent - 0.555555f) * 4.5f;
-            *p++ = 255;
-            *p++ = (int)((1.0f - local_percent) * 255);
-            *p++ = 0;
-          } else if (percent < 0.888888f) {
-            float local_percent = (percent - 0.777777f) * 9.0f;
-            *p++ = 255;
-            *p++ = 0;
-            *p++ = (int)(local_percent * 255);
-          } else {
-            float local_percent = (percent - 0.888888f) * 9.0f;
-            *p++ = (int)((0.75f + 0.25f * (1.0f - local_percent)) * 255.0f);
-            *p++ = (int)(local_percent * 255.0f * 0.5f);
-            *p++ = 255;
-          }
-        }
-      }
+      rx->waterfall_row = row;
+      float scale, bias;
+      wf_levels(rx, pan, width, &scale, &bias);
+      wf_build_lut();
+      cairo_surface_flush(rx->waterfall_surface);
+      wf_render_row(rx, row, rx->pixel_samples + pan, width, scale, bias);
+      cairo_surface_mark_dirty_rectangle(rx->waterfall_surface, 0, row, width, 1);
     }
 
     gtk_widget_queue_draw (rx->waterfall);
@@ -410,7 +705,9 @@ void waterfall_update(RECEIVER *rx) {
 void waterfall_init(RECEIVER *rx, int width, int height) {
   my_width = width;
   my_height = height;
-  rx->pixbuf = NULL;
+  rx->waterfall_surface = NULL;
+  rx->waterfall_row_x = NULL;
+  rx->waterfall_x = 0;
   rx->waterfall_frequency = 0;
   rx->waterfall_sample_rate = 0;
   rx->waterfall = gtk_drawing_area_new ();
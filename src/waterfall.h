@@ -24,5 +24,6 @@
 
 extern void waterfall_update(RECEIVER *rx);
 extern void waterfall_init(RECEIVER *rx, int width, int height);
+extern void waterfall_regenerate(RECEIVER *rx);
 
 #endif
@@ -70,7 +70,7 @@ void create_rxa (int channel) {
                               0.100,                      // averaging time constant
                               0.100,                      // peak decay time constant
                               rxa[channel].meter,               // result vector
-                              rxa[channel].pmtupdate,             // locks for meter access
+                              rxa[channel].pmeter,                // meter of each result
                               RXA_ADC_AV,                   // index for average value
                               RXA_ADC_PK,                   // index for peak value
                               -1,                       // index for gain value
@@ -138,7 +138,7 @@ void create_rxa (int channel) {
                             0.100,                      // averaging time constant
                             0.100,                      // peak decay time constant
                             rxa[channel].meter,               // result vector
-                            rxa[channel].pmtupdate,             // locks for meter access
+                            rxa[channel].pmeter,                // meter of each result
                             RXA_S_AV,                   // index for average value
                             RXA_S_PK,                   // index for peak value
                             -1,                       // index for gain value
@@ -345,7 +345,7 @@ void create_rxa (int channel) {
                               0.100,                      // averaging time constant
                               0.100,                      // peak decay time constant
                               rxa[channel].meter,               // result vector
-                              rxa[channel].pmtupdate,             // locks for meter access
+                              rxa[channel].pmeter,                // meter of each result
                               RXA_AGC_AV,                   // index for average value
                               RXA_AGC_PK,                   // index for peak value
                               RXA_AGC_GAIN,                 // index for gain value
@@ -60,7 +60,7 @@ struct _rxa {
   double* midbuff;
   int mode;
   double meter[RXA_METERTYPE_LAST];
-  CRITICAL_SECTION* pmtupdate[RXA_METERTYPE_LAST];
+  METER pmeter[RXA_METERTYPE_LAST];
   struct {
     METER p;
   } smeter, adcmeter, agcmeter;
@@ -80,7 +80,7 @@ void create_txa (int channel) {
                               0.100,                    // averaging time constant
                               0.100,                    // peak decay time constant
                               txa[channel].meter,             // result vector
-                              txa[channel].pmtupdate,           // locks for meter access
+                              txa[channel].pmeter,              // meter of each result
                               TXA_MIC_AV,                 // index for average value
                               TXA_MIC_PK,                 // index for peak value
                               -1,                     // index for gain value
@@ -127,7 +127,7 @@ void create_txa (int channel) {
                              0.100,                    // averaging time constant
                              0.100,                    // peak decay time constant
                              txa[channel].meter,             // result vector
-                             txa[channel].pmtupdate,           // locks for meter access
+                             txa[channel].pmeter,              // meter of each result
                              TXA_EQ_AV,                  // index for average value
                              TXA_EQ_PK,                  // index for peak value
                              -1,                     // index for gain value
@@ -177,7 +177,7 @@ void create_txa (int channel) {
                                0.100,                    // averaging time constant
                                0.100,                    // peak decay time constant
                                txa[channel].meter,             // result vector
-                               txa[channel].pmtupdate,           // locks for meter access
+                               txa[channel].pmeter,              // meter of each result
                                TXA_LVLR_AV,                // index for average value
                                TXA_LVLR_PK,                // index for peak value
                                TXA_LVLR_GAIN,                // index for gain value
@@ -216,7 +216,7 @@ void create_txa (int channel) {
                               0.100,                    // averaging time constant
                               0.100,                    // peak decay time constant
                               txa[channel].meter,             // result vector
-                              txa[channel].pmtupdate,           // locks for meter access
+                              txa[channel].pmeter,              // meter of each result
                               TXA_CFC_AV,                 // index for average value
                               TXA_CFC_PK,                 // index for peak value
                               TXA_CFC_GAIN,               // index for gain value
@@ -282,7 +282,7 @@ void create_txa (int channel) {
                                0.100,                    // averaging time constant
                                0.100,                    // peak decay time constant
                                txa[channel].meter,             // result vector
-                               txa[channel].pmtupdate,           // locks for meter access
+                               txa[channel].pmeter,              // meter of each result
                                TXA_COMP_AV,                // index for average value
                                TXA_COMP_PK,                // index for peak value
                                -1,                     // index for gain value
@@ -358,7 +358,7 @@ void create_txa (int channel) {
                               0.100,                    // averaging time constant
                               0.100,                    // peak decay time constant
                               txa[channel].meter,             // result vector
-                              txa[channel].pmtupdate,           // locks for meter access
+                              txa[channel].pmeter,              // meter of each result
                               TXA_ALC_AV,                 // index for average value
                               TXA_ALC_PK,                 // index for peak value
                               TXA_ALC_GAIN,               // index for gain value
@@ -435,7 +435,7 @@ void create_txa (int channel) {
                               0.100,                    // averaging time constant
                               0.100,                    // peak decay time constant
                               txa[channel].meter,             // result vector
-                              txa[channel].pmtupdate,           // locks for meter access
+                              txa[channel].pmeter,              // meter of each result
                               TXA_OUT_AV,                 // index for average value
                               TXA_OUT_PK,                 // index for peak value
                               -1,                     // index for gain value
@@ -74,7 +74,7 @@ struct _txa {
   double f_low;
   double f_high;
   double meter[TXA_METERTYPE_LAST];
-  CRITICAL_SECTION* pmtupdate[TXA_METERTYPE_LAST];
+  METER pmeter[TXA_METERTYPE_LAST];
   struct {
     METER p;
   } micmeter, eqmeter, lvlrmeter, cfcmeter, compmeter, alcmeter, outmeter;
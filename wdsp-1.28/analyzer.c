@@ -710,6 +710,8 @@ DWORD WINAPI spectra (void *pargs) {
           InterlockedBitTestAndReset(&(a->input_busy[j][i]), 0);
         }
 
+      // the input buffers can be dispatched again
+      SetEvent(a->hDispatchEvent);
       stitch(disp);
     } else {
       LeaveCriticalSection(&a->StitchSection);
@@ -952,6 +954,8 @@ DWORD WINAPI Cspectra (void *pargs) {
           InterlockedBitTestAndReset(&(a->input_busy[j][i]), 0);
         }
 
+      // the input buffers can be dispatched again
+      SetEvent(a->hDispatchEvent);
       stitch(disp);
     } else {
       LeaveCriticalSection(&a->StitchSection);
@@ -1134,7 +1138,11 @@ void __cdecl sendbuf(void *arg) {
         }
       }
 
-    Sleep(1);
+    //
+    // Wait until an input buffer becomes ready, the input buffers are
+    // released after completing a frame, or the dispatcher shall end.
+    //
+    WaitForSingleObject(a->hDispatchEvent, INFINITE);
   }
 
   InterlockedBitTestAndReset(&a->dispatcher, 0);
@@ -1263,6 +1271,7 @@ void SetAnalyzer (  int disp,     // display identifier
   int i, j;
   EnterCriticalSection(&a->SetAnalyzerSection);
   a->end_dispatcher = 1;
+  SetEvent(a->hDispatchEvent);
 
   while (InterlockedAnd(&a->dispatcher, 1)) {
     Sleep(1);
@@ -1296,8 +1305,8 @@ void SetAnalyzer (  int disp,     // display identifier
 
         if (a->Cplan[i][j]) { fftw_destroy_plan (a->Cplan[i][j]); }
 
-        a->plan[i][j] = fftw_plan_dft_r2c_1d(sz, a->fft_in[i][j], a->fft_out[i][j], FFTW_PATIENT);
-        a->Cplan[i][j] = fftw_plan_dft_1d(sz, a->Cfft_in[i][j], a->fft_out[i][j], FFTW_FORWARD, FFTW_PATIENT);
+        a->plan[i][j] = fftw_plan_dft_r2c_1d(sz, a->fft_in[i][j], a->fft_out[i][j], wisdom_planflags);
+        a->Cplan[i][j] = fftw_plan_dft_1d(sz, a->Cfft_in[i][j], a->fft_out[i][j], FFTW_FORWARD, wisdom_planflags);
       }
 
     // Setup DetectMaxBin for a 'size' change.
@@ -1422,6 +1431,8 @@ void XCreateAnalyzer( int disp,
       a->snap[i][j] = 0;
     }
 
+  a->hDispatchEvent = CreateEvent(NULL, FALSE, FALSE, TEXT("dispatch"));
+
   InitializeCriticalSectionAndSpinCount(&a->ResampleSection, 0);
   InitializeCriticalSectionAndSpinCount(&a->SetAnalyzerSection, 0);
   InitializeCriticalSectionAndSpinCount(&a->StitchSection, 0);
@@ -1515,11 +1526,19 @@ void DestroyAnalyzer(int disp) {
   DP a = pdisp[disp];
   int i, j;
   a->end_dispatcher = 1;
+  SetEvent(a->hDispatchEvent);
 
   while (InterlockedAnd(&a->dispatcher, 1)) {
     Sleep(1);
   }
 
+  // work items may still be running if they are executed asynchronously
+  a->stop = 1;
+
+  while (_InterlockedAnd(a->pnum_threads, 1023)) {
+    Sleep(1);
+  }
+
   for (i = 0; i < a->max_stitch; i++)
     for (j = 0; j < a->max_num_fft; j++) {
       _aligned_free  (a->I_samples[i][j]);
@@ -1591,6 +1610,8 @@ void DestroyAnalyzer(int disp) {
       CloseHandle(a->hSnapEvent[i][j]);
     }
 
+  CloseHandle(a->hDispatchEvent);
+
   _aligned_free ((void *) a->pnum_threads);
   // Destroy DetectMaxBin functionality.
   Destroy_DetectMaxBin(disp);
@@ -1715,7 +1736,9 @@ void CloseBuffer(int disp, int ss, int LO) {
   }
 
   if ((a->have_samples[ss][LO] += a->buff_size) >= a->size) {
-    InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0);
+    if (!(InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0) & 1)) {
+      SetEvent(a->hDispatchEvent);
+    }
   }
 
   LeaveCriticalSection(&(a->BufferControlSection[ss][LO]));
@@ -1758,7 +1781,9 @@ void Spectrum(int disp, int ss, int LO, dINREAL* pI, dINREAL* pQ) {
   }
 
   if ((a->have_samples[ss][LO] += a->buff_size) >= a->size) {
-    InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0);
+    if (!(InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0) & 1)) {
+      SetEvent(a->hDispatchEvent);
+    }
   }
 
   LeaveCriticalSection(&(a->BufferControlSection[ss][LO]));
@@ -1807,7 +1832,9 @@ void Spectrum2(int run, int disp, int ss, int LO, dINREAL* pbuff) {
     }
 
     if ((a->have_samples[ss][LO] += a->buff_size) >= a->size) {
-      InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0);
+      if (!(InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0) & 1)) {
+        SetEvent(a->hDispatchEvent);
+      }
     }
 
     LeaveCriticalSection(&(a->BufferControlSection[ss][LO]));
@@ -1857,7 +1884,9 @@ void Spectrum0(int run, int disp, int ss, int LO, double* pbuff) {
     }
 
     if ((a->have_samples[ss][LO] += a->buff_size) >= a->size) {
-      InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0);
+      if (!(InterlockedBitTestAndSet(&(a->buff_ready[ss][LO]), 0) & 1)) {
+        SetEvent(a->hDispatchEvent);
+      }
     }
 
     LeaveCriticalSection(&(a->BufferControlSection[ss][LO]));
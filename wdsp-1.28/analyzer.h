@@ -101,6 +101,7 @@ typedef struct _dp {
   int stop;                       // when set, fft threads will be returned to the pool
   int end_dispatcher;                   // set this flag to one to destroy the dispatcher thread
   volatile int dispatcher;                // one if the dispatcher thread is alive & active
+  HANDLE hDispatchEvent;                  // wakes up the dispatcher thread
   int ss;                         // sub-span being processed
   int LO;                         // LO (within current sub-span) being processed
   int flag;
@@ -212,4 +213,37 @@ void SnapSpectrumTimeout (int disp,
                           DWORD timeout,
                           int* flag);
 
+extern __declspec( dllexport )
+void SetAnalyzer (  int disp,
+                    int n_pixout,
+                    int n_fft,
+                    int typ,
+                    int *flp,
+                    int sz,
+                    int bf_sz,
+                    int win_type,
+                    double pi,
+                    int ovrlp,
+                    int clp,
+                    double fscLin,
+                    double fscHin,
+                    int n_pix,
+                    int n_stch,
+                    int calset,
+                    double fmin,
+                    double fmax,
+                    int max_w);
+
+extern __declspec( dllexport )
+void GetPixels (  int disp,
+                  int pixout,
+                  dOUTREAL *pix,
+                  int *flag);
+
+extern __declspec( dllexport )
+void SetDisplayDetectorMode (int disp, int pixout, int mode);
+
+extern __declspec( dllexport )
+void SetDisplayAverageMode (int disp, int pixout, int mode);
+
 #endif
\ No newline at end of file
@@ -66,7 +66,7 @@ ANF create_anf  (
   a->den_mult = den_mult;
   a->lincr = lincr;
   a->ldecr = ldecr;
-  memset (a->d, 0, sizeof(double) * ANF_DLINE_SIZE);
+  memset (a->d, 0, 2 * sizeof(double) * ANF_DLINE_SIZE);
   memset (a->w, 0, sizeof(double) * ANF_DLINE_SIZE);
   return a;
 }
@@ -76,23 +76,32 @@ void destroy_anf (ANF a) {
 }
 
 void xanf(ANF a, int position) {
-  int i, j, idx;
+  int i;
   double c0, c1;
-  double y, error, sigma, inv_sigp;
+  double y, error, sigma, inv_sigp, leave;
   double nel, nev;
 
   if (a->run && (a->position == position)) {
+    int size = a->mask + 1;
+    int n = a->n_taps;
+    const double* x;
+    //
+    // sigma, the energy in the window of n_taps samples, is updated as the
+    // window moves by one sample. It is re-computed at the start of each
+    // buffer so rounding errors cannot accumulate.
+    //
+    x = a->d + ((a->in_idx + 1 + a->delay) & a->mask);
+    sigma = lms_fir (x, x, n);
+
     for (i = 0; i < a->buff_size; i++) {
-      a->d[a->in_idx] = a->in_buff[2 * i + 0];
-      y = 0;
-      sigma = 0;
-
-      for (j = 0; j < a->n_taps; j++) {
-        idx = (a->in_idx + j + a->delay) & a->mask;
-        y += a->w[j] * a->d[idx];
-        sigma += a->d[idx] * a->d[idx];
-      }
+      leave = a->d[(a->in_idx + a->delay + n) & a->mask];
+      a->d[a->in_idx] = a->d[a->in_idx + size] = a->in_buff[2 * i + 0];
+      x = a->d + ((a->in_idx + a->delay) & a->mask);
+      sigma += x[0] * x[0] - leave * leave;
 
+      if (sigma < 0.0) { sigma = 0.0; }
+
+      y = lms_fir (a->w, x, n);
       inv_sigp = 1.0 / (sigma + 1e-10);
       error = a->d[a->in_idx] - y;
       a->out_buff[2 * i + 0] = error;
@@ -112,10 +121,7 @@ void xanf(ANF a, int position) {
       c0 = 1.0 - a->two_mu * a->ngamma;
       c1 = a->two_mu * error * inv_sigp;
 
-      for (j = 0; j < a->n_taps; j++) {
-        idx = (a->in_idx + j + a->delay) & a->mask;
-        a->w[j] = c0 * a->w[j] + c1 * a->d[idx];
-      }
+      lms_update (a->w, x, n, c0, c1);
 
       a->in_idx = (a->in_idx + a->mask) & a->mask;
     }
@@ -125,7 +131,7 @@ void xanf(ANF a, int position) {
 }
 
 void flush_anf (ANF a) {
-  memset (a->d, 0, sizeof(double) * ANF_DLINE_SIZE);
+  memset (a->d, 0, 2 * sizeof(double) * ANF_DLINE_SIZE);
   memset (a->w, 0, sizeof(double) * ANF_DLINE_SIZE);
   a->in_idx = 0;
 }
@@ -41,7 +41,7 @@ typedef struct _anf {
   int delay;
   double two_mu;
   double gamma;
-  double d [ANF_DLINE_SIZE];
+  double d [2 * ANF_DLINE_SIZE];      // mirrored delay line
   double w [ANF_DLINE_SIZE];
   int in_idx;
 
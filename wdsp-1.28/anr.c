@@ -26,6 +26,146 @@ warren@wpratt.com
 
 #include "comm.h"
 
+/********************************************************************************************************
+*                                                   *
+*                       LMS Kernels                         *
+*                                                   *
+********************************************************************************************************/
+
+// The adaptive filters (ANR here, ANF in anf.c) keep their delay line
+// "mirrored": each sample is stored at idx and idx + dline_size, so the
+// n_taps samples starting at any idx are contiguous. The FIR sum and the
+// NLMS weight update over such a window are done by the kernels below,
+// selected at run time as in firmin.c.
+
+// sum w[j] * x[j] for j < n
+
+static double lms_fir_scalar (const double* w, const double* x, int n) {
+  int j;
+  double y = 0.0;
+
+  for (j = 0; j < n; j++) {
+    y += w[j] * x[j];
+  }
+
+  return y;
+}
+
+// w[j] = c0 * w[j] + c1 * x[j] for j < n
+
+static void lms_update_scalar (double* w, const double* x, int n, double c0, double c1) {
+  int j;
+
+  for (j = 0; j < n; j++) {
+    w[j] = c0 * w[j] + c1 * x[j];
+  }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LMS_X86
+
+__attribute__((target("avx2,fma")))
+static double lms_fir_avx2 (const double* w, const double* x, int n) {
+  int j = 0;
+  __m256d acc0 = _mm256_setzero_pd ();
+  __m256d acc1 = _mm256_setzero_pd ();
+
+  for (; j + 8 <= n; j += 8) {
+    acc0 = _mm256_fmadd_pd (_mm256_loadu_pd (w + j),     _mm256_loadu_pd (x + j),     acc0);
+    acc1 = _mm256_fmadd_pd (_mm256_loadu_pd (w + j + 4), _mm256_loadu_pd (x + j + 4), acc1);
+  }
+
+  __m256d acc = _mm256_add_pd (acc0, acc1);
+  __m128d s = _mm_add_pd (_mm256_castpd256_pd128 (acc), _mm256_extractf128_pd (acc, 1));
+  s = _mm_add_sd (s, _mm_unpackhi_pd (s, s));
+  return _mm_cvtsd_f64 (s) + lms_fir_scalar (w + j, x + j, n - j);
+}
+
+__attribute__((target("avx2,fma")))
+static void lms_update_avx2 (double* w, const double* x, int n, double c0, double c1) {
+  int j = 0;
+  __m256d v0 = _mm256_set1_pd (c0);
+  __m256d v1 = _mm256_set1_pd (c1);
+
+  for (; j + 4 <= n; j += 4) {
+    __m256d t = _mm256_mul_pd (v0, _mm256_loadu_pd (w + j));
+    _mm256_storeu_pd (w + j, _mm256_fmadd_pd (v1, _mm256_loadu_pd (x + j), t));
+  }
+
+  lms_update_scalar (w + j, x + j, n - j, c0, c1);
+}
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define LMS_NEON
+
+static double lms_fir_neon (const double* w, const double* x, int n) {
+  int j = 0;
+  float64x2_t acc0 = vdupq_n_f64 (0.0);
+  float64x2_t acc1 = vdupq_n_f64 (0.0);
+
+  for (; j + 4 <= n; j += 4) {
+    acc0 = vfmaq_f64 (acc0, vld1q_f64 (w + j),     vld1q_f64 (x + j));
+    acc1 = vfmaq_f64 (acc1, vld1q_f64 (w + j + 2), vld1q_f64 (x + j + 2));
+  }
+
+  return vaddvq_f64 (vaddq_f64 (acc0, acc1)) + lms_fir_scalar (w + j, x + j, n - j);
+}
+
+static void lms_update_neon (double* w, const double* x, int n, double c0, double c1) {
+  int j = 0;
+
+  for (; j + 2 <= n; j += 2) {
+    float64x2_t t = vmulq_n_f64 (vld1q_f64 (w + j), c0);
+    vst1q_f64 (w + j, vfmaq_n_f64 (t, vld1q_f64 (x + j), c1));
+  }
+
+  lms_update_scalar (w + j, x + j, n - j, c0, c1);
+}
+#endif
+
+typedef double (*lms_fir_fn) (const double*, const double*, int);
+typedef void (*lms_update_fn) (double*, const double*, int, double, double);
+
+static lms_fir_fn lms_fir_kernel = NULL;
+static lms_update_fn lms_update_kernel = NULL;
+
+// run-time selection upon first use; a race between two threads
+// doing this simultaneously is harmless since both get the same result
+static void lms_select (void) {
+  lms_fir_fn f = lms_fir_scalar;
+  lms_update_fn u = lms_update_scalar;
+#ifdef LMS_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    f = lms_fir_avx2;
+    u = lms_update_avx2;
+  }
+
+#endif
+#ifdef LMS_NEON
+  f = lms_fir_neon;
+  u = lms_update_neon;
+#endif
+  lms_update_kernel = u;
+  lms_fir_kernel = f;
+}
+
+double lms_fir (const double* w, const double* x, int n) {
+  if (lms_fir_kernel == NULL) { lms_select (); }
+
+  return lms_fir_kernel (w, x, n);
+}
+
+void lms_update (double* w, const double* x, int n, double c0, double c1) {
+  if (lms_update_kernel == NULL) { lms_select (); }
+
+  lms_update_kernel (w, x, n, c0, c1);
+}
+
 ANR create_anr  (
   int run,
   int position,
@@ -66,7 +206,7 @@ ANR create_anr  (
   a->den_mult = den_mult;
   a->lincr = lincr;
   a->ldecr = ldecr;
-  memset (a->d, 0, sizeof(double) * ANR_DLINE_SIZE);
+  memset (a->d, 0, 2 * sizeof(double) * ANR_DLINE_SIZE);
   memset (a->w, 0, sizeof(double) * ANR_DLINE_SIZE);
   return a;
 }
@@ -76,23 +216,32 @@ void destroy_anr (ANR a) {
 }
 
 void xanr (ANR a, int position) {
-  int i, j, idx;
+  int i;
   double c0, c1;
-  double y, error, sigma, inv_sigp;
+  double y, error, sigma, inv_sigp, leave;
   double nel, nev;
 
   if (a->run && (a->position == position)) {
+    int size = a->mask + 1;
+    int n = a->n_taps;
+    const double* x;
+    //
+    // sigma, the energy in the window of n_taps samples, is updated as the
+    // window moves by one sample. It is re-computed at the start of each
+    // buffer so rounding errors cannot accumulate.
+    //
+    x = a->d + ((a->in_idx + 1 + a->delay) & a->mask);
+    sigma = lms_fir (x, x, n);
+
     for (i = 0; i < a->buff_size; i++) {
-      a->d[a->in_idx] = a->in_buff[2 * i + 0];
-      y = 0;
-      sigma = 0;
-
-      for (j = 0; j < a->n_taps; j++) {
-        idx = (a->in_idx + j + a->delay) & a->mask;
-        y += a->w[j] * a->d[idx];
-        sigma += a->d[idx] * a->d[idx];
-      }
+      leave = a->d[(a->in_idx + a->delay + n) & a->mask];
+      a->d[a->in_idx] = a->d[a->in_idx + size] = a->in_buff[2 * i + 0];
+      x = a->d + ((a->in_idx + a->delay) & a->mask);
+      sigma += x[0] * x[0] - leave * leave;
+
+      if (sigma < 0.0) { sigma = 0.0; }
 
+      y = lms_fir (a->w, x, n);
       inv_sigp = 1.0 / (sigma + 1e-10);
       error = a->d[a->in_idx] - y;
       a->out_buff[2 * i + 0] = y;
@@ -112,10 +261,7 @@ void xanr (ANR a, int position) {
       c0 = 1.0 - a->two_mu * a->ngamma;
       c1 = a->two_mu * error * inv_sigp;
 
-      for (j = 0; j < a->n_taps; j++) {
-        idx = (a->in_idx + j + a->delay) & a->mask;
-        a->w[j] = c0 * a->w[j] + c1 * a->d[idx];
-      }
+      lms_update (a->w, x, n, c0, c1);
 
       a->in_idx = (a->in_idx + a->mask) & a->mask;
     }
@@ -125,7 +271,7 @@ void xanr (ANR a, int position) {
 }
 
 void flush_anr (ANR a) {
-  memset (a->d, 0, sizeof(double) * ANR_DLINE_SIZE);
+  memset (a->d, 0, 2 * sizeof(double) * ANR_DLINE_SIZE);
   memset (a->w, 0, sizeof(double) * ANR_DLINE_SIZE);
   a->in_idx = 0;
 }
@@ -41,7 +41,7 @@ typedef struct _anr {
   int delay;
   double two_mu;
   double gamma;
-  double d [ANR_DLINE_SIZE];
+  double d [2 * ANR_DLINE_SIZE];      // mirrored delay line
   double w [ANR_DLINE_SIZE];
   int in_idx;
 
@@ -79,6 +79,10 @@ extern void destroy_anr (ANR a);
 
 extern void flush_anr (ANR a);
 
+extern double lms_fir (const double* w, const double* x, int n);
+
+extern void lms_update (double* w, const double* x, int n, double c0, double c1);
+
 extern void xanr (ANR a, int position);
 
 extern void setBuffers_anr (ANR a, double* in, double* out);
@@ -39,9 +39,9 @@ void calc_bps (BPS a) {
   impulse = fir_bandpass(a->size + 1, a->f_low, a->f_high, a->samplerate, a->wintype, 1, 1.0 / (double)(2 * a->size));
   a->mults = fftcv_mults(2 * a->size, impulse);
   a->CFor = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->infilt, (fftw_complex *)a->product, FFTW_FORWARD,
-                             FFTW_PATIENT);
+                             wisdom_planflags);
   a->CRev = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->product, (fftw_complex *)a->out, FFTW_BACKWARD,
-                             FFTW_PATIENT);
+                             wisdom_planflags);
   _aligned_free(impulse);
 }
 
@@ -0,0 +1,212 @@
+/*
+ * bench_analyzer
+ *
+ * Load test for the spectrum analyzer (analyzer.c) with several displays,
+ * as deskHPSDR runs them: one analyzer per receiver, fed with IQ samples
+ * in buffers of 1024 samples at the receiver's sample rate (by one thread
+ * per receiver, paced in real time), and polled with GetPixels() at the
+ * display frame rate. The analyzer parameters are those of rx_set_analyzer()
+ * (fft size 16384, Hann window, overlap from the frame rate).
+ *
+ * For each frame rate, the following is reported:
+ *
+ *   - the frames delivered per display and second (should equal the
+ *     frame rate, the largest frame rate for which this holds is the
+ *     "max fps" for this number of receivers),
+ *   - the CPU load of the process (in % of one core),
+ *   - the voluntary context switches per second (all threads).
+ *
+ * Finally, the feeding stops and the same figures are reported for one
+ * second of idle analyzers (no input, no polling).
+ *
+ * Build (after building libwdsp.a):  make bench_analyzer
+ * Usage: ./bench_analyzer [receivers, default 4] [sample rate, default 384000]
+ *                         [seconds per frame rate, default 2]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "comm.h"
+
+#define MAX_RX  8
+#define BUFSIZE 1024
+#define PIXELS  1024
+#define FFTSIZE 16384
+
+static int receivers = 4;
+static int rate = 384000;
+static volatile int feeding = 0;
+
+static double now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+static void usage (double* cpu, long* csw) {
+  struct rusage ru;
+  getrusage (RUSAGE_SELF, &ru);
+  *cpu = ru.ru_utime.tv_sec + 1.0E-6 * ru.ru_utime.tv_usec + ru.ru_stime.tv_sec + 1.0E-6 * ru.ru_stime.tv_usec;
+  *csw = ru.ru_nvcsw;
+}
+
+static void set_analyzer (int disp, int fps) {
+  int flp[] = {0};
+  int max_w = FFTSIZE + (int) min (0.1 * rate, 0.1 * FFTSIZE * fps);
+  int overlap = (int) max (0.0, ceil (FFTSIZE - (double)rate / (double)fps));
+  SetAnalyzer (disp, 1, 1, 1, flp, FFTSIZE, BUFSIZE, 2, 14.0, overlap, 0, 0.0, 0.0, PIXELS, 1, 0, 0.0, 0.0, max_w);
+  SetDisplayDetectorMode (disp, 0, 1);
+  SetDisplayAverageMode (disp, 0, 3);
+}
+
+//
+// IQ input of one receiver: white noise plus a tone, in real time
+//
+static void* feeder (void* arg) {
+  int disp = (int)(intptr_t)arg;
+  double* buf = (double *) malloc0 (BUFSIZE * sizeof (complex));
+  long long n = 0;
+  struct timespec next;
+  int i;
+  clock_gettime (CLOCK_MONOTONIC, &next);
+
+  while (feeding) {
+    for (i = 0; i < BUFSIZE; i++, n++) {
+      buf[2 * i + 0] = 1.0E-3 * cos (TWOPI * 0.1 * n) + 1.0E-5 * (2.0 * rand () / RAND_MAX - 1.0);
+      buf[2 * i + 1] = 1.0E-3 * sin (TWOPI * 0.1 * n) + 1.0E-5 * (2.0 * rand () / RAND_MAX - 1.0);
+    }
+
+    Spectrum0 (1, disp, 0, 0, buf);
+    next.tv_nsec += (long)(1.0E9 * BUFSIZE / rate);
+
+    while (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+
+    clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+
+  _aligned_free (buf);
+  return NULL;
+}
+
+static void run (int fps, double seconds) {
+  float pixels[PIXELS];
+  long frames[MAX_RX];
+  double cpu0, cpu1, t0, t1;
+  long csw0, csw1;
+  struct timespec next;
+  int i, flag;
+  long total = 0;
+
+  for (i = 0; i < receivers; i++) {
+    set_analyzer (i, fps);
+    frames[i] = 0;
+  }
+
+  // let the analyzers fill up before measuring
+  Sleep (500);
+  usage (&cpu0, &csw0);
+  t0 = now ();
+  clock_gettime (CLOCK_MONOTONIC, &next);
+
+  do {
+    for (i = 0; i < receivers; i++) {
+      GetPixels (i, 0, pixels, &flag);
+      frames[i] += flag;
+    }
+
+    next.tv_nsec += 1000000000 / fps;
+
+    while (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+
+    clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    t1 = now ();
+  } while (t1 - t0 < seconds);
+
+  usage (&cpu1, &csw1);
+
+  for (i = 0; i < receivers; i++) {
+    total += frames[i];
+  }
+
+  printf ("%d RX at %d Hz, %3d fps: delivered %6.1f fps/display  CPU %5.1f%%  %7.0f ctx.sw/s\n",
+          receivers, rate, fps, total / (t1 - t0) / receivers, 100.0 * (cpu1 - cpu0) / (t1 - t0),
+          (csw1 - csw0) / (t1 - t0));
+}
+
+int main (int argc, char** argv) {
+  static const int fps[] = { 10, 25, 50, 100, 200, 0 };
+  double seconds = 2.0;
+  double cpu0, cpu1, t0, t1;
+  long csw0, csw1;
+  pthread_t tid[MAX_RX];
+  int i, rc;
+
+  if (argc > 1) { receivers = atoi (argv[1]); }
+
+  if (argc > 2) { rate = atoi (argv[2]); }
+
+  if (argc > 3) { seconds = atof (argv[3]); }
+
+  if (receivers < 1) { receivers = 1; }
+
+  if (receivers > MAX_RX) { receivers = MAX_RX; }
+
+  if (rate < 48000) { rate = 48000; }
+
+  if (seconds <= 0.0) { seconds = 2.0; }
+
+  for (i = 0; i < receivers; i++) {
+    XCreateAnalyzer (i, &rc, 262144, 1, 1, NULL);
+
+    if (rc != 0) {
+      printf ("XCreateAnalyzer failed for display %d\n", i);
+      return 1;
+    }
+
+    set_analyzer (i, fps[0]);
+  }
+
+  feeding = 1;
+
+  for (i = 0; i < receivers; i++) {
+    pthread_create (&tid[i], NULL, feeder, (void *)(intptr_t)i);
+  }
+
+  for (i = 0; fps[i] > 0; i++) {
+    run (fps[i], seconds);
+  }
+
+  feeding = 0;
+
+  for (i = 0; i < receivers; i++) {
+    pthread_join (tid[i], NULL);
+  }
+
+  // idle analyzers: the dispatchers are still running, but have nothing to do
+  Sleep (500);
+  usage (&cpu0, &csw0);
+  t0 = now ();
+  Sleep (1000);
+  t1 = now ();
+  usage (&cpu1, &csw1);
+  printf ("%d RX idle:                 CPU %5.1f%%  %7.0f ctx.sw/s\n", receivers,
+          100.0 * (cpu1 - cpu0) / (t1 - t0), (csw1 - csw0) / (t1 - t0));
+
+  for (i = 0; i < receivers; i++) {
+    DestroyAnalyzer (i);
+  }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * bench_emnr
+ *
+ * Accuracy test and micro-benchmark for the tabulated EMNR gain functions
+ * (fast_gain) against the exact ones (Bessel functions resp. E1).
+ *
+ * For gain methods 0 and 1, two identical EMNR instances are created, one
+ * with the exact and one with the tabulated gain, and calc_gain() is fed
+ * with the same spectra: complex white noise plus tones with an SNR from
+ * -10 to +50 dB, such that the whole range of the gain functions is used.
+ * Before each frame, the decision-directed state (previous mask and gamma)
+ * of the exact instance is copied to the fast one, so the deviation of the
+ * masks is that of a single gain calculation. Reported are
+ *
+ *   - the maximum relative deviation of the mask (and in dB),
+ *   - the time per bin of calc_gain() (including the noise power estimate,
+ *     which is the same for both) and the time per bin of the gain step
+ *     alone (the difference to calc_gain() without a gain method).
+ *
+ * Build (after building libwdsp.a):  make bench_emnr
+ * Usage: ./bench_emnr [seconds per test, default 1]
+ * The exit status is non-zero if the deviation exceeds MAX_DEV_DB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "comm.h"
+
+#define FSIZE      2048
+#define FRAMES     200
+#define MAX_DEV_DB 0.001
+
+static double now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+static double gauss (void) {
+  double u1 = (rand () + 1.0) / (RAND_MAX + 2.0);
+  double u2 = (rand () + 1.0) / (RAND_MAX + 2.0);
+  return sqrt (-2.0 * log (u1)) * cos (TWOPI * u2);
+}
+
+//
+// One spectrum: white noise in all bins, every 16th bin carries a tone
+// whose SNR changes from frame to frame
+//
+static void spectrum (double* y, int msize, int frame) {
+  int k;
+
+  for (k = 0; k < msize; k++) {
+    y[2 * k + 0] = gauss ();
+    y[2 * k + 1] = gauss ();
+
+    if ((k & 15) == 8) {
+      double snr = -10.0 + 60.0 * (double)((k / 16 + frame) % 61) / 60.0;
+      y[2 * k + 0] += sqrt (2.0) * pow (10.0, 0.05 * snr);
+    }
+  }
+}
+
+//
+// ns per bin of calc_gain() over FRAMES spectra, repeated for 'seconds'
+//
+static double timing (EMNR a, double** spectra, double seconds) {
+  long long bins = 0;
+  double t0 = now ();
+  double t1;
+  int f;
+
+  do {
+    for (f = 0; f < FRAMES; f++) {
+      memcpy (a->g.y, spectra[f], 2 * a->msize * sizeof (double));
+      calc_gain (a);
+    }
+
+    bins += (long long) FRAMES * a->msize;
+    t1 = now ();
+  } while (t1 - t0 < seconds);
+
+  return 1.0E9 * (t1 - t0) / bins;
+}
+
+static int bench (int method, double** spectra, double seconds) {
+  double* in  = (double *) malloc0 (FSIZE * sizeof (complex));
+  double* out = (double *) malloc0 (FSIZE * sizeof (complex));
+  EMNR exact = create_emnr (1, 0, FSIZE, in, out, FSIZE, 4, 48000, 0, 1.0, method, 0, 0);
+  EMNR fast  = create_emnr (1, 0, FSIZE, in, out, FSIZE, 4, 48000, 0, 1.0, method, 0, 0);
+  EMNR none  = create_emnr (1, 0, FSIZE, in, out, FSIZE, 4, 48000, 0, 1.0, -1, 0, 0);
+  int msize = exact->msize;
+  double maxdev = 0.0;
+  int f, k;
+  fast->g.fast_gain = 1;
+
+  for (f = 0; f < FRAMES; f++) {
+    memcpy (exact->g.y, spectra[f], 2 * msize * sizeof (double));
+    memcpy (fast->g.y, spectra[f], 2 * msize * sizeof (double));
+    memcpy (fast->g.prev_mask, exact->g.prev_mask, msize * sizeof (double));
+    memcpy (fast->g.prev_gamma, exact->g.prev_gamma, msize * sizeof (double));
+    calc_gain (exact);
+    calc_gain (fast);
+
+    // skip the first frames, during which the noise estimate settles
+    if (f < FRAMES / 4) { continue; }
+
+    for (k = 0; k < msize; k++) {
+      double dev = fabs (fast->g.mask[k] - exact->g.mask[k]) / exact->g.mask[k];
+
+      if (dev > maxdev) { maxdev = dev; }
+    }
+  }
+
+  double t_exact = timing (exact, spectra, seconds);
+  double t_fast  = timing (fast, spectra, seconds);
+  double t_none  = timing (none, spectra, seconds);
+  double db = 20.0 * log10 (1.0 + maxdev);
+  printf ("gain method %d: max.dev. %.2e (%.5f dB)  calc_gain exact %6.1f ns/bin  fast %6.1f ns/bin"
+          "  gain step exact %6.1f ns/bin  fast %6.1f ns/bin  %s\n",
+          method, maxdev, db, t_exact, t_fast, t_exact - t_none, t_fast - t_none,
+          db <= MAX_DEV_DB ? "PASS" : "FAIL");
+  destroy_emnr (none);
+  destroy_emnr (fast);
+  destroy_emnr (exact);
+  _aligned_free (out);
+  _aligned_free (in);
+  return db <= MAX_DEV_DB;
+}
+
+int main (int argc, char** argv) {
+  double seconds = argc > 1 ? atof (argv[1]) : 1.0;
+  double* spectra[FRAMES];
+  int f, ok = 1;
+
+  if (seconds <= 0.0) { seconds = 1.0; }
+
+  for (f = 0; f < FRAMES; f++) {
+    spectra[f] = (double *) malloc0 ((FSIZE / 2 + 1) * sizeof (complex));
+    spectrum (spectra[f], FSIZE / 2 + 1, f);
+  }
+
+  ok &= bench (0, spectra, seconds);
+  ok &= bench (1, spectra, seconds);
+
+  for (f = 0; f < FRAMES; f++) {
+    _aligned_free (spectra[f]);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/*
+ * bench_fircore
+ *
+ * Accuracy test and micro-benchmark for the single precision filter
+ * kernel (fircore with WDSP_FLOAT) against the double precision one.
+ *
+ * For each combination of buffer size and filter length, two identical
+ * band-pass filters (150 ... 2850 Hz at 48 kHz, as bp1 for SSB) are
+ * created, one in double and one in single precision, and fed with the
+ * same data:
+ *
+ *   - an in-band signal (a tone plus white noise): the deviation of the
+ *     single precision output from the double precision output is reported
+ *     as a signal-to-error ratio, which must be at least MIN_SNR dB;
+ *   - an out-of-band tone at 12 kHz: the stop-band attenuation of both
+ *     filters and their difference ("delta") is reported, this shows whether
+ *     the noise floor of single precision limits the filter;
+ *
+ * and the throughput of both is reported in Msps.
+ *
+ * Build:  make FLOAT=ON bench_fircore   (libwdsp.a must be built with FLOAT=ON)
+ * Usage: ./bench_fircore [seconds per test, default 1]
+ * The exit status is non-zero if the accuracy test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "comm.h"
+
+#ifndef WDSP_FLOAT
+#error "bench_fircore needs WDSP_FLOAT, use make FLOAT=ON"
+#endif
+
+#define RATE    48000.0
+#define MIN_SNR 100.0
+#define BLOCKS  64
+
+static double now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+static double power (const double* x, int n) {
+  double sum = 0.0;
+  int i;
+
+  for (i = 0; i < 2 * n; i++) {
+    sum += x[i] * x[i];
+  }
+
+  return sum;
+}
+
+static void tone (double* x, int n, long long* phase, double freq, double amp) {
+  int i;
+
+  for (i = 0; i < n; i++, (*phase)++) {
+    x[2 * i + 0] = amp * cos (TWOPI * freq * *phase / RATE);
+    x[2 * i + 1] = amp * sin (TWOPI * freq * *phase / RATE);
+  }
+}
+
+static double throughput (FIRCORE p, int size, double seconds) {
+  long long n = 0;
+  double t0 = now ();
+  double t1;
+  int k;
+
+  do {
+    for (k = 0; k < 16; k++) {
+      xfircore (p);
+      n += size;
+    }
+
+    t1 = now ();
+  } while (t1 - t0 < seconds);
+
+  return 1.0E-6 * n / (t1 - t0);
+}
+
+static int bench (int size, int nc, double seconds) {
+  double* in = (double *) malloc0 (size * sizeof (complex));
+  double* outd = (double *) malloc0 (2 * size * sizeof (complex));
+  double* outf = (double *) malloc0 (2 * size * sizeof (complex));
+  double* impulse = fir_bandpass (nc, 150.0, 2850.0, RATE, 0, 1, 1.0 / (double)(2 * size));
+  FIRCORE pd, pf;
+  double sig = 0.0, err = 0.0, pin = 0.0, pd_stop = 0.0, pf_stop = 0.0;
+  long long phase = 0;
+  int i, k;
+  fircore_precision (0);
+  pd = create_fircore (size, in, outd, nc, 0, impulse);
+  fircore_precision (1);
+  pf = create_fircore (size, in, outf, nc, 0, impulse);
+
+  //
+  // in-band: 1 kHz tone plus white noise, compare single against double
+  //
+  for (k = 0; k < BLOCKS; k++) {
+    tone (in, size, &phase, 1000.0, 0.5);
+
+    for (i = 0; i < 2 * size; i++) {
+      in[i] += 0.1 * (2.0 * rand () / RAND_MAX - 1.0);
+    }
+
+    xfircore (pd);
+    xfircore (pf);
+
+    for (i = 0; i < 2 * size; i++) {
+      double d = outf[i] - outd[i];
+      sig += outd[i] * outd[i];
+      err += d * d;
+    }
+  }
+
+  //
+  // out-of-band: 12 kHz tone, measured after the filters have settled
+  //
+  flush_fircore (pd);
+  flush_fircore (pf);
+
+  for (k = 0; k < nc / size + BLOCKS; k++) {
+    tone (in, size, &phase, 12000.0, 1.0);
+    xfircore (pd);
+    xfircore (pf);
+
+    if (k >= nc / size) {
+      pin += power (in, size);
+      pd_stop += power (outd, size);
+      pf_stop += power (outf, size);
+    }
+  }
+
+  double snr = 10.0 * log10 (sig / (err + 1.0E-300));
+  double att_d = 10.0 * log10 (pin / (pd_stop + 1.0E-300));
+  double att_f = 10.0 * log10 (pin / (pf_stop + 1.0E-300));
+  double mspsd = throughput (pd, size, seconds);
+  double mspsf = throughput (pf, size, seconds);
+  printf ("size=%5d nc=%6d: SNR(float vs double) %6.1f dB  stop-band %6.1f / %6.1f dB (delta %5.1f)"
+          "  double %7.2f Msps  float %7.2f Msps  %s\n",
+          size, nc, snr, att_d, att_f, att_d - att_f, mspsd, mspsf, snr >= MIN_SNR ? "PASS" : "FAIL");
+  destroy_fircore (pd);
+  destroy_fircore (pf);
+  _aligned_free (impulse);
+  _aligned_free (outf);
+  _aligned_free (outd);
+  _aligned_free (in);
+  return snr >= MIN_SNR;
+}
+
+int main (int argc, char** argv) {
+  double seconds = argc > 1 ? atof (argv[1]) : 1.0;
+  int ok = 1;
+
+  if (seconds <= 0.0) { seconds = 1.0; }
+
+  ok &= bench (64, 2048, seconds);
+  ok &= bench (1024, 2048, seconds);
+  ok &= bench (1024, 16384, seconds);
+  ok &= bench (4096, 65536, seconds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/*
+ * bench_resample
+ *
+ * Micro-benchmark for the polyphase resampler (resample.c) at the
+ * rate combinations used by deskHPSDR:
+ *
+ *   48k -> 384k, 384k -> 48k   (RX/TX at the highest P1/P2 rates)
+ *   1536k -> 48k               (P2 at the highest DDC rate)
+ *   48k -> 192k                (TX output rate of P2)
+ *
+ * For each combination, random IQ data is fed through xresample in
+ * blocks of 1024 input samples, and the throughput is reported in
+ * input and output samples per second. The output is also compared
+ * with a straightforward reference implementation of the same filter
+ * (the original modulo-indexed tap loop), and the largest deviation is
+ * reported. It should be in the order of the rounding error.
+ *
+ * Build (after building libwdsp.a):  make bench_resample
+ * Usage: ./bench_resample [seconds per test, default 1]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "comm.h"
+
+#define BLOCK 1024
+
+static double now (void) {
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.0E-9 * ts.tv_nsec;
+}
+
+//
+// Reference: the tap loop as it was before the mirrored ring, working on
+// a private (non-mirrored) ring but using the coefficients of "a"
+//
+static int reference (RESAMPLE a, double* ring, int* idx_in, int* phnum, const double* in, double* out, int size) {
+  int i, j, n, idx_out;
+  int outsamps = 0;
+
+  for (i = 0; i < size; i++) {
+    ring[2 * *idx_in + 0] = in[2 * i + 0];
+    ring[2 * *idx_in + 1] = in[2 * i + 1];
+
+    while (*phnum < a->L) {
+      double I = 0.0, Q = 0.0;
+      n = a->cpp * *phnum;
+
+      for (j = 0; j < a->cpp; j++) {
+        if ((idx_out = *idx_in + j) >= a->ringsize) { idx_out -= a->ringsize; }
+
+        I += a->h[n + j] * ring[2 * idx_out + 0];
+        Q += a->h[n + j] * ring[2 * idx_out + 1];
+      }
+
+      out[2 * outsamps + 0] = I;
+      out[2 * outsamps + 1] = Q;
+      outsamps++;
+      *phnum += a->M;
+    }
+
+    *phnum -= a->L;
+
+    if (--*idx_in < 0) { *idx_in = a->ringsize - 1; }
+  }
+
+  return outsamps;
+}
+
+static void bench (int in_rate, int out_rate, double seconds) {
+  int maxout = BLOCK * (out_rate / in_rate + 2);
+  double* in = (double *) malloc (BLOCK * sizeof (complex));
+  double* out = (double *) malloc (maxout * sizeof (complex));
+  double* ref = (double *) malloc (maxout * sizeof (complex));
+  RESAMPLE a = create_resample (1, BLOCK, in, out, in_rate, out_rate, 0.0, 0, 1.0);
+  double* ring = (double *) calloc (a->ringsize, sizeof (complex));
+  int idx_in = a->ringsize - 1;
+  int phnum = 0;
+  double maxdiff = 0.0;
+  long long nin = 0, nout = 0;
+  int i, k, n;
+
+  //
+  // correctness: 50 blocks against the reference
+  //
+  for (k = 0; k < 50; k++) {
+    for (i = 0; i < 2 * BLOCK; i++) {
+      in[i] = 2.0 * rand () / RAND_MAX - 1.0;
+    }
+
+    n = xresample (a);
+
+    if (reference (a, ring, &idx_in, &phnum, in, ref, BLOCK) != n) {
+      printf ("%7d -> %7d: output count mismatch!\n", in_rate, out_rate);
+      break;
+    }
+
+    for (i = 0; i < 2 * n; i++) {
+      double d = fabs (out[i] - ref[i]);
+
+      if (d > maxdiff) { maxdiff = d; }
+    }
+  }
+
+  //
+  // throughput
+  //
+  double t0 = now ();
+  double t1;
+
+  do {
+    for (k = 0; k < 16; k++) {
+      nout += xresample (a);
+      nin += BLOCK;
+    }
+
+    t1 = now ();
+  } while (t1 - t0 < seconds);
+
+  printf ("%7d -> %7d: taps/phase=%4d  in %7.2f Msps  out %7.2f Msps  max.dev. %.3g\n",
+          in_rate, out_rate, a->cpp, 1.0E-6 * nin / (t1 - t0), 1.0E-6 * nout / (t1 - t0), maxdiff);
+  destroy_resample (a);
+  free (ring);
+  free (in);
+  free (out);
+  free (ref);
+}
+
+int main (int argc, char** argv) {
+  double seconds = argc > 1 ? atof (argv[1]) : 1.0;
+
+  if (seconds <= 0.0) { seconds = 1.0; }
+
+  bench (48000, 384000, seconds);
+  bench (384000, 48000, seconds);
+  bench (1536000, 48000, seconds);
+  bench (48000, 192000, seconds);
+  return 0;
+}
@@ -31,7 +31,8 @@ void calc_cfir (CFIR a) {
   a->scale = 1.0 / (double)(2 * a->size);
   impulse = cfir_impulse (a->nc, a->DD, a->R, a->Pairs, a->runrate, a->cicrate, a->cutoff, a->xtype, a->xbw, 1, a->scale,
                           a->wintype);
-  a->p = create_fircore (a->size, a->in, a->out, a->nc, a->mp, impulse);
+  // TX filter, always double precision (also when re-created by the setters)
+  a->p = create_fircore_prec (a->size, a->in, a->out, a->nc, a->mp, impulse, 0);
   _aligned_free (impulse);
 }
 
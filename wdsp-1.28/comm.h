@@ -133,6 +133,7 @@ warren@wpratt.com
 // wisdom definitions
 #define MAX_WISDOM_SIZE_DISPLAY     262144
 #define MAX_WISDOM_SIZE_FILTER      262144        // was 32769
+extern unsigned int wisdom_planflags;           // FFTW planner flags, FFTW_ESTIMATE while the wisdom is built
 
 // math definitions
 #define PI                3.1415926535897932
@@ -156,6 +156,70 @@ double e1xb (double x) {
   return e1;
 }
 
+// TABULATED GAIN FUNCTIONS
+// Optional fast path for calc_gain():  the MMSE-LSA core
+//      h(v) = sqrt(v) * exp(-v/2) * ((1 + v) * I0(v/2) + v * I1(v/2))
+// is tabulated over u = sqrt(v) (h is nearly linear in u near zero), and 0.5 * E1(v) is tabulated
+// over ln(v).  Both are linearly interpolated.  Outside the tables the exact functions are used,
+// below FE_VMIN the leading terms of the E1 series are used.  Measured against bessI0/bessI1/e1xb
+// for 1e-5 <= v <= 64, the maximum relative error of the resulting gain is 2.8e-5 for h(v) and
+// 4.0e-6 for exp(0.5 * E1(v)), i.e., well below 0.001 dB.
+
+#define FG_SIZE   1024
+#define FG_UMAX   8.0
+#define FE_SIZE   1024
+#define FE_VMIN   1.0e-4
+#define FE_VMAX   64.0
+
+static double mmse_h (double v) {
+  return sqrt (v) * exp (- 0.5 * v) * ((1.0 + v) * bessI0 (0.5 * v) + v * bessI1 (0.5 * v));
+}
+
+static void calc_fast_gain (EMNR a) {
+  int i;
+  double u;
+  a->g.fg_h  = (double *)malloc0((FG_SIZE + 2) * sizeof(double));
+  a->g.fg_e1 = (double *)malloc0((FE_SIZE + 2) * sizeof(double));
+
+  for (i = 0; i < FG_SIZE + 2; i++) {
+    u = FG_UMAX * (double)i / (double)FG_SIZE;
+    a->g.fg_h[i] = mmse_h (u * u);
+  }
+
+  a->g.fg_e1_t0 = log (FE_VMIN);
+  a->g.fg_e1_scale = (double)FE_SIZE / (log (FE_VMAX) - a->g.fg_e1_t0);
+
+  for (i = 0; i < FE_SIZE + 2; i++) {
+    a->g.fg_e1[i] = 0.5 * e1xb (exp (a->g.fg_e1_t0 + (double)i / a->g.fg_e1_scale));
+  }
+}
+
+static inline double fast_h (EMNR a, double v) {
+  double x = sqrt (v) * (FG_SIZE / FG_UMAX);
+  int i;
+
+  // written such that NaN also takes the exact path
+  if (!(x < FG_SIZE)) { return mmse_h (v); }
+
+  i = (int)x;
+  return a->g.fg_h[i] + (x - i) * (a->g.fg_h[i + 1] - a->g.fg_h[i]);
+}
+
+static inline double fast_half_e1 (EMNR a, double v) {
+  double x;
+  int i;
+
+  if (v < FE_VMIN) { return 0.5 * (- 0.5772156649015328 - log (v) + v); }
+
+  x = (log (v) - a->g.fg_e1_t0) * a->g.fg_e1_scale;
+
+  // v >= FE_VMAX and NaN take the exact path
+  if (!(x >= 0.0 && x < FE_SIZE)) { return 0.5 * e1xb (v); }
+
+  i = (int)x;
+  return a->g.fg_e1[i] + (x - i) * (a->g.fg_e1[i + 1] - a->g.fg_e1[i]);
+}
+
 /********************************************************************************************************
 *                                                   *
 *                     Main Body of Code                     *
@@ -408,6 +472,7 @@ void calc_emnr(EMNR a) {
   a->g.zeta_hat = (double*)malloc0(a->g.dim_zeta * a->g.dim_zeta * sizeof(double));
   a->g.zeta_true = (int*)  malloc0(a->g.dim_zeta * a->g.dim_zeta * sizeof(int));
   a->g.zeta_thresh = -2.0;
+  calc_fast_gain(a);
   int rows, cols;
   readZetaHat("zetaHat", &rows, &cols, &a->g.z_gamma_min, &a->g.z_gamma_max, &a->g.z_xihat_min, &a->g.z_xihat_max,
               a->g.zeta_hat, a->g.zeta_true);
@@ -639,6 +704,8 @@ void decalc_emnr(EMNR a) {
   _aligned_free(a->np.alphaOptHat);
   _aligned_free(a->np.p);
   // g
+  _aligned_free(a->g.fg_e1);
+  _aligned_free(a->g.fg_h);
   _aligned_free(a->g.zeta_true);
   _aligned_free(a->g.zeta_hat);
   _aligned_free(a->g.GGS);
@@ -1165,8 +1232,13 @@ void calc_gain (EMNR a) {
                 + (1.0 - a->g.alpha) * max (gamma - 1.0, a->g.eps_floor);
       eps_hat = max(eps_hat, a->g.xi_min);
       v = (eps_hat / (1.0 + eps_hat)) * gamma;
-      a->g.mask[k] = a->g.gf1p5 * sqrt (v) / gamma * exp (- 0.5 * v)
-                     * ((1.0 + v) * bessI0 (0.5 * v) + v * bessI1 (0.5 * v));
+      if (a->g.fast_gain) {
+        a->g.mask[k] = a->g.gf1p5 * fast_h (a, v) / gamma;
+      } else {
+        a->g.mask[k] = a->g.gf1p5 * sqrt (v) / gamma * exp (- 0.5 * v)
+                       * ((1.0 + v) * bessI0 (0.5 * v) + v * bessI1 (0.5 * v));
+      }
+
       {
         double v2 = min (v, 700.0);
         double eta = a->g.mask[k] * a->g.mask[k] * a->g.lambda_y[k] / a->g.lambda_d[k];
@@ -1196,7 +1268,13 @@ void calc_gain (EMNR a) {
       ehr = eps_hat / (1.0 + eps_hat);
       v = ehr * gamma;
 
-      if ((a->g.mask[k] = ehr * exp (min (700.0, 0.5 * e1xb(v)))) > a->g.gmax) { a->g.mask[k] = a->g.gmax; }
+      if (a->g.fast_gain) {
+        a->g.mask[k] = ehr * exp (min (700.0, fast_half_e1 (a, v)));
+      } else {
+        a->g.mask[k] = ehr * exp (min (700.0, 0.5 * e1xb(v)));
+      }
+
+      if (a->g.mask[k] > a->g.gmax) { a->g.mask[k] = a->g.gmax; }
 
       if (a->g.mask[k] != a->g.mask[k]) { a->g.mask[k] = 0.01; }
 
@@ -1232,8 +1310,13 @@ void calc_gain (EMNR a) {
                + (1.0 - a->g.alpha) * max(gamma - 1.0, a->g.eps_floor);
       xi_hat = max(xi_hat, a->g.xi_min);
       v = (xi_hat / (1.0 + xi_hat)) * gamma;
-      a->g.mask[k] = a->g.gf1p5 * sqrt(v) / gamma * exp(-0.5 * v)
-                     * ((1.0 + v) * bessI0(0.5 * v) + v * bessI1(0.5 * v));
+      if (a->g.fast_gain) {
+        a->g.mask[k] = a->g.gf1p5 * fast_h(a, v) / gamma;
+      } else {
+        a->g.mask[k] = a->g.gf1p5 * sqrt(v) / gamma * exp(-0.5 * v)
+                       * ((1.0 + v) * bessI0(0.5 * v) + v * bessI1(0.5 * v));
+      }
+
       {
         double v2 = min(v, 700.0);
         double eta = a->g.mask[k] * a->g.mask[k] * a->g.lambda_y[k] / a->g.lambda_d[k];
@@ -1252,8 +1335,14 @@ void calc_gain (EMNR a) {
         double xi_ts = a->g.mask[k] * a->g.mask[k] * gamma;
         xi_ts = max(xi_ts, a->g.xi_min);
         double v_ts = (xi_ts / (1.0 + xi_ts)) * gamma;
-        a->g.mask[k] = a->g.gf1p5 * sqrt(v_ts) / gamma * exp(-0.5 * v_ts)
-                       * ((1.0 + v_ts) * bessI0(0.5 * v_ts) + v_ts * bessI1(0.5 * v_ts));
+
+        if (a->g.fast_gain) {
+          a->g.mask[k] = a->g.gf1p5 * fast_h(a, v_ts) / gamma;
+        } else {
+          a->g.mask[k] = a->g.gf1p5 * sqrt(v_ts) / gamma * exp(-0.5 * v_ts)
+                         * ((1.0 + v_ts) * bessI0(0.5 * v_ts) + v_ts * bessI1(0.5 * v_ts));
+        }
+
         double v2 = min(v_ts, 700.0);
         double eta = a->g.mask[k] * a->g.mask[k] * a->g.lambda_y[k] / a->g.lambda_d[k];
         double eps = eta / (1.0 - a->g.q);
@@ -1385,6 +1474,13 @@ void SetRXAEMNRgainMethod (int channel, int method) {
   LeaveCriticalSection (&ch[channel].csDSP);
 }
 
+PORT
+void SetRXAEMNRfastGain (int channel, int run) {
+  EnterCriticalSection (&ch[channel].csDSP);
+  rxa[channel].emnr.p->g.fast_gain = run;
+  LeaveCriticalSection (&ch[channel].csDSP);
+}
+
 PORT
 void SetRXAEMNRnpeMethod (int channel, int method) {
   EnterCriticalSection (&ch[channel].csDSP);
@@ -92,6 +92,12 @@ typedef struct _emnr {
     double z_xihat_min;
     double z_xihat_max;
     double zeta_thresh;
+    //
+    int fast_gain;
+    double* fg_h;
+    double* fg_e1;
+    double fg_e1_t0;
+    double fg_e1_scale;
   } g;
   struct _npest {
     int incr;
@@ -211,4 +217,6 @@ extern void setSamplerate_emnr (EMNR a, int rate);
 
 extern void setSize_emnr (EMNR a, int size);
 
+extern void calc_gain (EMNR a);
+
 #endif
@@ -136,13 +136,14 @@ void plan_firopt (FIROPT a) {
     a->fftout[i] = (double *) malloc0 (2 * a->size * sizeof (complex));
     a->fmask[i] = (double *) malloc0 (2 * a->size * sizeof (complex));
     a->pcfor[i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->fftin, (fftw_complex *)a->fftout[i], FFTW_FORWARD,
-                                   FFTW_PATIENT);
+                                   wisdom_planflags);
     a->maskplan[i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->maskgen, (fftw_complex *)a->fmask[i], FFTW_FORWARD,
-                                      FFTW_PATIENT);
+                                      wisdom_planflags);
   }
 
   a->accum = (double *) malloc0 (2 * a->size * sizeof (complex));
-  a->crev = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->accum, (fftw_complex *)a->out, FFTW_BACKWARD, FFTW_PATIENT);
+  a->crev = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->accum, (fftw_complex *)a->out, FFTW_BACKWARD,
+                             wisdom_planflags);
 }
 
 void calc_firopt (FIROPT a) {
@@ -276,10 +277,42 @@ void setFreqs_firopt (FIROPT a, double f_low, double f_high) {
 *                                                   *
 ********************************************************************************************************/
 
+// With WDSP_FLOAT, the FFTs and the multiply-accumulate of new filters are done
+// in single precision (fftwf), see the section "Single Precision Filter Kernel".
+// Input and output buffers are double in either case.
+#ifdef WDSP_FLOAT
+static int fircore_single = 1;
+
+static void plan_fircoref (FIRCORE a);
+static void deplan_fircoref (FIRCORE a);
+static void xfircoref (FIRCORE a);
+#else
+static int fircore_single = 0;
+#endif
+
+static void fircore_list_add (FIRCORE a);
+static void fircore_list_remove (FIRCORE a);
+
+// selects the precision of filters created hereafter (only effective with WDSP_FLOAT)
+void fircore_precision (int single) {
+#ifdef WDSP_FLOAT
+  fircore_single = single;
+#else
+  (void) single;
+#endif
+}
 
 void plan_fircore (FIRCORE a) {
   // must call for change in 'nc', 'size', 'out'
   int i;
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    plan_fircoref (a);
+    return;
+  }
+
+#endif
   a->nfor = a->nc / a->size;
   a->cset = 0;
   a->buffidx = 0;
@@ -300,16 +333,18 @@ void plan_fircore (FIRCORE a) {
     a->fmask[0][i] = (double *) malloc0 (2 * a->size * sizeof (complex));
     a->fmask[1][i] = (double *) malloc0 (2 * a->size * sizeof (complex));
     a->pcfor[i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->fftin, (fftw_complex *)a->fftout[i], FFTW_FORWARD,
-                                   FFTW_PATIENT);
+                                   wisdom_planflags);
     a->maskplan[0][i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->maskgen, (fftw_complex *)a->fmask[0][i],
-                                         FFTW_FORWARD, FFTW_PATIENT);
+                                         FFTW_FORWARD, wisdom_planflags);
     a->maskplan[1][i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->maskgen, (fftw_complex *)a->fmask[1][i],
-                                         FFTW_FORWARD, FFTW_PATIENT);
+                                         FFTW_FORWARD, wisdom_planflags);
   }
 
   a->accum = (double *) malloc0 (2 * a->size * sizeof (complex));
-  a->crev = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->accum, (fftw_complex *)a->out, FFTW_BACKWARD, FFTW_PATIENT);
+  a->crev = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->accum, (fftw_complex *)a->out, FFTW_BACKWARD,
+                             wisdom_planflags);
   a->masks_ready = 0;
+  fircore_list_add (a);
 }
 
 void calc_fircore (FIRCORE a, int flip) {
@@ -317,6 +352,12 @@ void calc_fircore (FIRCORE a, int flip) {
   // must also call after a call to plan_firopt()
   int i;
 
+  // xfircore() does not hold the lock while using a mask set, so wait
+  // until it no longer uses the set we are going to overwrite
+  while (__atomic_load_n (&a->inuse, __ATOMIC_ACQUIRE) == 2 - a->cset) {
+    Sleep (0);
+  }
+
   if (a->mp) {
     mp_imp (a->nc, a->impulse, a->imp, 16, 0);
   } else {
@@ -326,6 +367,20 @@ void calc_fircore (FIRCORE a, int flip) {
   for (i = 0; i < a->nfor; i++) {
     // I right-justified the impulse response => take output from left side of output buff, discard right side
     // Be careful about flipping an asymmetrical impulse response.
+#ifdef WDSP_FLOAT
+    if (a->single) {
+      int j;
+      float* maskgen = (float *) a->maskgen;
+
+      for (j = 0; j < 2 * a->size; j++) {
+        maskgen[2 * a->size + j] = (float) a->imp[2 * a->size * i + j];
+      }
+
+      fftwf_execute (a->maskplanf[1 - a->cset][i]);
+      continue;
+    }
+
+#endif
     memcpy (&(a->maskgen[2 * a->size]), &(a->imp[2 * a->size * i]), a->size * sizeof(complex));
     fftw_execute (a->maskplan[1 - a->cset][i]);
   }
@@ -341,12 +396,24 @@ void calc_fircore (FIRCORE a, int flip) {
 }
 
 FIRCORE create_fircore (int size, double* in, double* out, int nc, int mp, double* impulse) {
+  return create_fircore_prec (size, in, out, nc, mp, impulse, fircore_single);
+}
+
+// as create_fircore, with the precision given by the caller instead of fircore_precision();
+// for filters that are re-created by parameter changes, outside create_rxa/create_txa
+FIRCORE create_fircore_prec (int size, double* in, double* out, int nc, int mp, double* impulse, int single) {
   FIRCORE a = (FIRCORE) malloc0 (sizeof (fircore));
   a->size = size;
   a->in = in;
   a->out = out;
   a->nc = nc;
   a->mp = mp;
+#ifdef WDSP_FLOAT
+  a->single = single;
+#else
+  a->single = 0;
+  (void) single;
+#endif
   InitializeCriticalSectionAndSpinCount (&a->update, 2500);
   plan_fircore (a);
   a->impulse = (double *) malloc0 (a->nc * sizeof (complex));
@@ -358,6 +425,15 @@ FIRCORE create_fircore (int size, double* in, double* out, int nc, int mp, doubl
 
 void deplan_fircore (FIRCORE a) {
   int i;
+  fircore_list_remove (a);
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    deplan_fircoref (a);
+    return;
+  }
+
+#endif
   fftw_destroy_plan (a->crev);
   _aligned_free (a->accum);
 
@@ -392,41 +468,573 @@ void destroy_fircore (FIRCORE a) {
 
 void flush_fircore (FIRCORE a) {
   int i;
-  memset (a->fftin, 0, 2 * a->size * sizeof (complex));
+  // size of a complex value in the fft buffers
+  size_t csize = a->single ? 2 * sizeof (float) : sizeof (complex);
+  memset (a->fftin, 0, 2 * a->size * csize);
 
   for (i = 0; i < a->nfor; i++) {
-    memset (a->fftout[i], 0, 2 * a->size * sizeof (complex));
+    memset (a->fftout[i], 0, 2 * a->size * csize);
+  }
+
+  a->buffidx = 0;
+}
+
+/********************************************************************************************************
+*                                                   *
+*                     Plan Refinement                       *
+*                                                   *
+********************************************************************************************************/
+
+// While the FFTW wisdom is being built in the background (see wisdom.c), new filters are planned
+// with FFTW_ESTIMATE and put into a list. From time to time, the wisdom thread calls
+// fircore_refine(), which creates plans from the wisdom gained so far for each listed filter.
+// xfircore() picks them up at the start of its next call and hands the replaced plans back,
+// these are destroyed (by the wisdom thread) upon the next fircore_refine(). Only the plans used
+// by xfircore() are exchanged, the mask plans are only used when the filter is changed.
+// A filter that does not run between the last fircore_refine() calls (e.g. TX while receiving)
+// stays listed after the wisdom thread has finished. It picks up its refined plans upon its
+// first xfircore(); the replaced ones are destroyed when the next filter is planned (see
+// fircore_reap), or when the filter itself is destroyed.
+
+static pthread_mutex_t fircore_list_lock = PTHREAD_MUTEX_INITIALIZER;
+static FIRCORE fircore_list = NULL;
+static int fircore_refining = 0;
+
+static void fircore_reap (void);
+
+static void fircore_list_add (FIRCORE a) {
+  if (!__atomic_load_n (&fircore_refining, __ATOMIC_ACQUIRE)) {
+    fircore_reap ();
+    return;
+  }
+
+  pthread_mutex_lock (&fircore_list_lock);
+  a->next = fircore_list;
+  fircore_list = a;
+  a->listed = 1;
+  pthread_mutex_unlock (&fircore_list_lock);
+}
+
+static void fircore_release_swap (FIRCORE a) {
+  int i;
+
+  if (a->swap == 0) { return; }
+
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    for (i = 0; i < a->nfor; i++) {
+      fftwf_destroy_plan (a->pcforf_swap[i]);
+    }
+
+    fftwf_destroy_plan (a->crevf_swap);
+    _aligned_free (a->pcforf_swap);
+    a->swap = 0;
+    return;
+  }
+
+#endif
+
+  for (i = 0; i < a->nfor; i++) {
+    fftw_destroy_plan (a->pcfor_swap[i]);
+  }
+
+  fftw_destroy_plan (a->crev_swap);
+  _aligned_free (a->pcfor_swap);
+  a->swap = 0;
+}
+
+// the caller holds fircore_list_lock
+static void fircore_unlink (FIRCORE a) {
+  FIRCORE* p = &fircore_list;
+
+  while (*p != a) { p = &(*p)->next; }
+
+  *p = a->next;
+  __atomic_store_n (&a->listed, 0, __ATOMIC_RELEASE);
+}
+
+static void fircore_list_remove (FIRCORE a) {
+  // only the wisdom thread can un-list the filter in the meantime
+  if (!__atomic_load_n (&a->listed, __ATOMIC_ACQUIRE)) { return; }
+
+  pthread_mutex_lock (&fircore_list_lock);
+
+  if (a->listed) {
+    fircore_release_swap (a);
+    fircore_unlink (a);
+  }
+
+  pthread_mutex_unlock (&fircore_list_lock);
+}
+
+// after the refinement: destroys the replaced plans of filters that have swapped since
+static void fircore_reap (void) {
+  FIRCORE a, next;
+
+  if (__atomic_load_n (&fircore_list, __ATOMIC_ACQUIRE) == NULL) { return; }
+
+  pthread_mutex_lock (&fircore_list_lock);
+
+  for (a = fircore_list; a != NULL; a = next) {
+    next = a->next;
+
+    if (__atomic_load_n (&a->swap, __ATOMIC_ACQUIRE) == 2) {
+      fircore_release_swap (a);
+      fircore_unlink (a);
+    }
+  }
+
+  pthread_mutex_unlock (&fircore_list_lock);
+}
+
+// create plans from wisdom only; the planner does not touch the buffers in this case
+static int fircore_replan (FIRCORE a) {
+  int i, ok = 1;
+  const unsigned flags = FFTW_PATIENT | FFTW_WISDOM_ONLY;
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    a->pcforf_swap = (fftwf_plan *) malloc0 (a->nfor * sizeof (fftwf_plan));
+
+    for (i = 0; i < a->nfor; i++) {
+      a->pcforf_swap[i] = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->fftin, (fftwf_complex *)a->fftout[i],
+                                            FFTW_FORWARD, flags);
+      ok = ok && a->pcforf_swap[i];
+    }
+
+    a->crevf_swap = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->accum, (fftwf_complex *)a->outf, FFTW_BACKWARD,
+                                      flags);
+    ok = ok && a->crevf_swap;
+
+    if (!ok) {
+      for (i = 0; i < a->nfor; i++) {
+        if (a->pcforf_swap[i]) { fftwf_destroy_plan (a->pcforf_swap[i]); }
+      }
+
+      if (a->crevf_swap) { fftwf_destroy_plan (a->crevf_swap); }
+
+      _aligned_free (a->pcforf_swap);
+      return 0;
+    }
+
+    __atomic_store_n (&a->swap, 1, __ATOMIC_RELEASE);
+    return 1;
+  }
+
+#endif
+  a->pcfor_swap = (fftw_plan *) malloc0 (a->nfor * sizeof (fftw_plan));
+
+  for (i = 0; i < a->nfor; i++) {
+    a->pcfor_swap[i] = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->fftin, (fftw_complex *)a->fftout[i],
+                                        FFTW_FORWARD, flags);
+    ok = ok && a->pcfor_swap[i];
+  }
+
+  a->crev_swap = fftw_plan_dft_1d(2 * a->size, (fftw_complex *)a->accum, (fftw_complex *)a->out, FFTW_BACKWARD, flags);
+  ok = ok && a->crev_swap;
+
+  if (!ok) {
+    for (i = 0; i < a->nfor; i++) {
+      if (a->pcfor_swap[i]) { fftw_destroy_plan (a->pcfor_swap[i]); }
+    }
+
+    if (a->crev_swap) { fftw_destroy_plan (a->crev_swap); }
+
+    _aligned_free (a->pcfor_swap);
+    return 0;
+  }
+
+  __atomic_store_n (&a->swap, 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+// called by xfircore() if refined plans are ready
+static void fircore_swap (FIRCORE a) {
+  fftw_plan* pcfor = a->pcfor;
+  fftw_plan crev = a->crev;
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    fftwf_plan* pcforf = a->pcforf;
+    fftwf_plan crevf = a->crevf;
+    a->pcforf = a->pcforf_swap;
+    a->crevf = a->crevf_swap;
+    a->pcforf_swap = pcforf;
+    a->crevf_swap = crevf;
+    __atomic_store_n (&a->swap, 2, __ATOMIC_RELEASE);
+    return;
+  }
+
+#endif
+  a->pcfor = a->pcfor_swap;
+  a->crev = a->crev_swap;
+  a->pcfor_swap = pcfor;
+  a->crev_swap = crev;
+  __atomic_store_n (&a->swap, 2, __ATOMIC_RELEASE);
+}
+
+// filters created from now on are listed for refinement
+void fircore_refine_start (void) {
+  __atomic_store_n (&fircore_refining, 1, __ATOMIC_RELEASE);
+}
+
+// the fft sizes used by the listed filters (these are planned first)
+int fircore_refine_sizes (int* sizes, int max) {
+  int i, n = 0;
+  FIRCORE a;
+  pthread_mutex_lock (&fircore_list_lock);
+
+  for (a = fircore_list; a != NULL; a = a->next) {
+    for (i = 0; i < n; i++) {
+      if (sizes[i] == 2 * a->size) { break; }
+    }
+
+    if (i == n && n < max) { sizes[n++] = 2 * a->size; }
+  }
+
+  pthread_mutex_unlock (&fircore_list_lock);
+  return n;
+}
+
+// 'last' is set once the wisdom is complete: filters created hereafter use it directly
+void fircore_refine (int last) {
+  FIRCORE a, next;
+
+  if (last) { __atomic_store_n (&fircore_refining, 0, __ATOMIC_RELEASE); }
+
+  pthread_mutex_lock (&fircore_list_lock);
+
+  for (a = fircore_list; a != NULL; a = next) {
+    next = a->next;
+    int swap = __atomic_load_n (&a->swap, __ATOMIC_ACQUIRE);
+
+    if (swap == 2) {
+      // refined plans are in use, the replaced ones can go
+      fircore_release_swap (a);
+      fircore_unlink (a);
+    } else if (swap == 0) {
+      fircore_replan (a);
+    }
+  }
+
+  pthread_mutex_unlock (&fircore_list_lock);
+}
+
+/********************************************************************************************************
+*                                                   *
+*                 Complex Multiply-Accumulate Kernels               *
+*                                                   *
+********************************************************************************************************/
+
+// accum[i] += x[i] * m[i] for n complex values, all arrays interleaved re/im
+
+static void cmac_scalar (double* accum, const double* x, const double* m, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    accum[2 * i + 0] += x[2 * i + 0] * m[2 * i + 0] - x[2 * i + 1] * m[2 * i + 1];
+    accum[2 * i + 1] += x[2 * i + 0] * m[2 * i + 1] + x[2 * i + 1] * m[2 * i + 0];
+  }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CMAC_X86
+
+// two complex values per vector: with m = (mr, mi), the product is
+// x * mr -/+ swap(x) * mi, which is exactly what fmaddsub computes
+__attribute__((target("avx2,fma")))
+static void cmac_avx2 (double* accum, const double* x, const double* m, int n) {
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m256d x0 = _mm256_loadu_pd (x + 2 * i);
+    __m256d x1 = _mm256_loadu_pd (x + 2 * i + 4);
+    __m256d m0 = _mm256_loadu_pd (m + 2 * i);
+    __m256d m1 = _mm256_loadu_pd (m + 2 * i + 4);
+    __m256d t0 = _mm256_mul_pd (_mm256_permute_pd (x0, 0x5), _mm256_permute_pd (m0, 0xF));
+    __m256d t1 = _mm256_mul_pd (_mm256_permute_pd (x1, 0x5), _mm256_permute_pd (m1, 0xF));
+    t0 = _mm256_fmaddsub_pd (x0, _mm256_movedup_pd (m0), t0);
+    t1 = _mm256_fmaddsub_pd (x1, _mm256_movedup_pd (m1), t1);
+    _mm256_storeu_pd (accum + 2 * i,     _mm256_add_pd (_mm256_loadu_pd (accum + 2 * i),     t0));
+    _mm256_storeu_pd (accum + 2 * i + 4, _mm256_add_pd (_mm256_loadu_pd (accum + 2 * i + 4), t1));
   }
 
+  cmac_scalar (accum + 2 * i, x + 2 * i, m + 2 * i, n - i);
+}
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define CMAC_NEON
+
+// one complex value per vector: accum += x * (mr, mr) + swap(x) * (-mi, mi)
+static void cmac_neon (double* accum, const double* x, const double* m, int n) {
+  int i;
+  const float64x2_t sign = { -1.0, 1.0 };
+
+  for (i = 0; i < n; i++) {
+    float64x2_t xv = vld1q_f64 (x + 2 * i);
+    float64x2_t mv = vld1q_f64 (m + 2 * i);
+    float64x2_t acc = vld1q_f64 (accum + 2 * i);
+    acc = vfmaq_laneq_f64 (acc, xv, mv, 0);
+    acc = vfmaq_f64 (acc, vextq_f64 (xv, xv, 1), vmulq_f64 (vdupq_laneq_f64 (mv, 1), sign));
+    vst1q_f64 (accum + 2 * i, acc);
+  }
+}
+#endif
+
+typedef void (*cmac_fn) (double*, const double*, const double*, int);
+
+static cmac_fn cmac_kernel = NULL;
+
+// run-time selection upon first use; a race between two threads
+// doing this simultaneously is harmless since both get the same result
+static cmac_fn cmac_select (void) {
+#ifdef CMAC_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    return cmac_avx2;
+  }
+
+#endif
+#ifdef CMAC_NEON
+  return cmac_neon;
+#endif
+  return cmac_scalar;
+}
+
+#ifdef WDSP_FLOAT
+/********************************************************************************************************
+*                                                   *
+*                 Single Precision Filter Kernel                *
+*                                                   *
+********************************************************************************************************/
+
+// Same partitioned overlap-save scheme as above, but with the fft buffers, masks and
+// plans in single precision: half the memory traffic and twice the SIMD width in
+// the multiply-accumulate, which dominates for long filters. The conversion from and
+// to double happens when loading 'in' and storing 'out'.
+
+static void cmacf_scalar (float* accum, const float* x, const float* m, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    accum[2 * i + 0] += x[2 * i + 0] * m[2 * i + 0] - x[2 * i + 1] * m[2 * i + 1];
+    accum[2 * i + 1] += x[2 * i + 0] * m[2 * i + 1] + x[2 * i + 1] * m[2 * i + 0];
+  }
+}
+
+#ifdef CMAC_X86
+// four complex values per vector, otherwise as cmac_avx2
+__attribute__((target("avx2,fma")))
+static void cmacf_avx2 (float* accum, const float* x, const float* m, int n) {
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256 x0 = _mm256_loadu_ps (x + 2 * i);
+    __m256 x1 = _mm256_loadu_ps (x + 2 * i + 8);
+    __m256 m0 = _mm256_loadu_ps (m + 2 * i);
+    __m256 m1 = _mm256_loadu_ps (m + 2 * i + 8);
+    __m256 t0 = _mm256_mul_ps (_mm256_permute_ps (x0, 0xB1), _mm256_movehdup_ps (m0));
+    __m256 t1 = _mm256_mul_ps (_mm256_permute_ps (x1, 0xB1), _mm256_movehdup_ps (m1));
+    t0 = _mm256_fmaddsub_ps (x0, _mm256_moveldup_ps (m0), t0);
+    t1 = _mm256_fmaddsub_ps (x1, _mm256_moveldup_ps (m1), t1);
+    _mm256_storeu_ps (accum + 2 * i,     _mm256_add_ps (_mm256_loadu_ps (accum + 2 * i),     t0));
+    _mm256_storeu_ps (accum + 2 * i + 8, _mm256_add_ps (_mm256_loadu_ps (accum + 2 * i + 8), t1));
+  }
+
+  cmacf_scalar (accum + 2 * i, x + 2 * i, m + 2 * i, n - i);
+}
+#endif
+
+#ifdef CMAC_NEON
+// two complex values per vector: accum += x * (mr, mr) + swap(x) * (-mi, mi)
+static void cmacf_neon (float* accum, const float* x, const float* m, int n) {
+  int i = 0;
+  const float32x4_t sign = { -1.0f, 1.0f, -1.0f, 1.0f };
+
+  for (; i + 2 <= n; i += 2) {
+    float32x4_t xv = vld1q_f32 (x + 2 * i);
+    float32x4_t mv = vld1q_f32 (m + 2 * i);
+    float32x4_t acc = vld1q_f32 (accum + 2 * i);
+    acc = vfmaq_f32 (acc, xv, vtrn1q_f32 (mv, mv));
+    acc = vfmaq_f32 (acc, vrev64q_f32 (xv), vmulq_f32 (vtrn2q_f32 (mv, mv), sign));
+    vst1q_f32 (accum + 2 * i, acc);
+  }
+
+  cmacf_scalar (accum + 2 * i, x + 2 * i, m + 2 * i, n - i);
+}
+#endif
+
+typedef void (*cmacf_fn) (float*, const float*, const float*, int);
+
+static cmacf_fn cmacf_kernel = NULL;
+
+static cmacf_fn cmacf_select (void) {
+#ifdef CMAC_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    return cmacf_avx2;
+  }
+
+#endif
+#ifdef CMAC_NEON
+  return cmacf_neon;
+#endif
+  return cmacf_scalar;
+}
+
+static void plan_fircoref (FIRCORE a) {
+  int i;
+  const size_t csize = 2 * sizeof (float);
+  a->nfor = a->nc / a->size;
+  a->cset = 0;
   a->buffidx = 0;
+  a->idxmask = a->nfor - 1;
+  a->fftin = (double *) malloc0 (2 * a->size * csize);
+  a->fftout   = (double **) malloc0 (a->nfor * sizeof (double *));
+  a->fmask    = (double ***) malloc0 (2 * sizeof (double **));
+  a->fmask[0] = (double **) malloc0 (a->nfor * sizeof (double *));
+  a->fmask[1] = (double **) malloc0 (a->nfor * sizeof (double *));
+  a->maskgen = (double *) malloc0 (2 * a->size * csize);
+  a->pcforf = (fftwf_plan *) malloc0 (a->nfor * sizeof (fftwf_plan));
+  a->maskplanf    = (fftwf_plan **) malloc0 (2 * sizeof (fftwf_plan *));
+  a->maskplanf[0] = (fftwf_plan *) malloc0 (a->nfor * sizeof (fftwf_plan));
+  a->maskplanf[1] = (fftwf_plan *) malloc0 (a->nfor * sizeof (fftwf_plan));
+
+  for (i = 0; i < a->nfor; i++) {
+    a->fftout[i]   = (double *) malloc0 (2 * a->size * csize);
+    a->fmask[0][i] = (double *) malloc0 (2 * a->size * csize);
+    a->fmask[1][i] = (double *) malloc0 (2 * a->size * csize);
+    a->pcforf[i] = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->fftin, (fftwf_complex *)a->fftout[i],
+                                     FFTW_FORWARD, wisdom_planflags);
+    a->maskplanf[0][i] = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->maskgen, (fftwf_complex *)a->fmask[0][i],
+                                           FFTW_FORWARD, wisdom_planflags);
+    a->maskplanf[1][i] = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->maskgen, (fftwf_complex *)a->fmask[1][i],
+                                           FFTW_FORWARD, wisdom_planflags);
+  }
+
+  a->accum = (double *) malloc0 (2 * a->size * csize);
+  a->outf = (float *) malloc0 (2 * a->size * csize);
+  a->crevf = fftwf_plan_dft_1d(2 * a->size, (fftwf_complex *)a->accum, (fftwf_complex *)a->outf, FFTW_BACKWARD,
+                               wisdom_planflags);
+  a->masks_ready = 0;
+  fircore_list_add (a);
 }
 
+static void deplan_fircoref (FIRCORE a) {
+  int i;
+  fftwf_destroy_plan (a->crevf);
+  _aligned_free (a->outf);
+  _aligned_free (a->accum);
+
+  for (i = 0; i < a->nfor; i++) {
+    _aligned_free (a->fftout[i]);
+    _aligned_free (a->fmask[0][i]);
+    _aligned_free (a->fmask[1][i]);
+    fftwf_destroy_plan (a->pcforf[i]);
+    fftwf_destroy_plan (a->maskplanf[0][i]);
+    fftwf_destroy_plan (a->maskplanf[1][i]);
+  }
+
+  _aligned_free (a->maskplanf[0]);
+  _aligned_free (a->maskplanf[1]);
+  _aligned_free (a->maskplanf);
+  _aligned_free (a->pcforf);
+  _aligned_free (a->maskgen);
+  _aligned_free (a->fmask[0]);
+  _aligned_free (a->fmask[1]);
+  _aligned_free (a->fmask);
+  _aligned_free (a->fftout);
+  _aligned_free (a->fftin);
+}
+
+static void xfircoref (FIRCORE a) {
+  int i, j, k;
+  int sz = a->size;
+  int nfor = a->nfor;
+  int idxmask = a->idxmask;
+  float* fftin = (float *) a->fftin;
+  float* accum = (float *) a->accum;
+  float* outf = a->outf;
+
+  for (i = 0; i < 2 * sz; i++) {
+    fftin[2 * sz + i] = (float) a->in[i];
+  }
+
+  fftwf_execute (a->pcforf[a->buffidx]);
+  k = a->buffidx;
+  memset (accum, 0, 2 * sz * 2 * sizeof (float));
+  EnterCriticalSection (&a->update);
+  int cset = a->cset;
+  __atomic_store_n (&a->inuse, 1 + cset, __ATOMIC_RELAXED);
+  LeaveCriticalSection (&a->update);
+  double** fftout = a->fftout;
+  double** fmask = a->fmask[cset];
+
+  if (cmacf_kernel == NULL) { cmacf_kernel = cmacf_select (); }
+
+  for (j = 0; j < nfor; j++) {
+    cmacf_kernel (accum, (const float *) fftout[k], (const float *) fmask[j], 2 * sz);
+    k = (k + idxmask) & idxmask;
+  }
+
+  __atomic_store_n (&a->inuse, 0, __ATOMIC_RELEASE);
+  a->buffidx = (a->buffidx + 1) & idxmask;
+  fftwf_execute (a->crevf);
+
+  for (i = 0; i < 2 * sz; i++) {
+    a->out[i] = (double) outf[i];
+  }
+
+  memcpy (fftin, &fftin[2 * sz], sz * 2 * sizeof (float));
+}
+#endif
+
 void xfircore (FIRCORE a) {
   //[2.10.3.9]MW0LGE refactor to remove pointer chase in the loops
-  int i, j, k;
+  int j, k;
+
+  if (__atomic_load_n (&a->swap, __ATOMIC_ACQUIRE) == 1) { fircore_swap (a); }
+
+#ifdef WDSP_FLOAT
+
+  if (a->single) {
+    xfircoref (a);
+    return;
+  }
+
+#endif
   memcpy (&(a->fftin[2 * a->size]), a->in, a->size * sizeof (complex));
   fftw_execute (a->pcfor[a->buffidx]);
   k = a->buffidx;
   memset (a->accum, 0, 2 * a->size * sizeof (complex));
+  // The lock is only needed to pick up the current mask set, which is
+  // then marked "in use" so calc_fircore() will not overwrite it while
+  // the multiply-accumulate is running.
   EnterCriticalSection (&a->update);
+  int cset = a->cset;
+  __atomic_store_n (&a->inuse, 1 + cset, __ATOMIC_RELAXED);
+  LeaveCriticalSection (&a->update);
   double* accum = a->accum;
   double** fftout = a->fftout;
-  double*** fmask = a->fmask;
-  int cset = a->cset;
+  double** fmask = a->fmask[cset];
   int idxmask = a->idxmask;
   int sz = a->size;
   int nfor = a->nfor;
 
-  for (j = 0; j < nfor; j++) {
-    for (i = 0; i < 2 * sz; i++) {
-      accum[2 * i + 0] += fftout[k][2 * i + 0] * fmask[cset][j][2 * i + 0] - fftout[k][2 * i + 1] * fmask[cset][j][2 * i + 1];
-      accum[2 * i + 1] += fftout[k][2 * i + 0] * fmask[cset][j][2 * i + 1] + fftout[k][2 * i + 1] * fmask[cset][j][2 * i + 0];
-    }
+  if (cmac_kernel == NULL) { cmac_kernel = cmac_select (); }
 
+  for (j = 0; j < nfor; j++) {
+    cmac_kernel (accum, fftout[k], fmask[j], 2 * sz);
     k = (k + idxmask) & idxmask;
   }
 
-  LeaveCriticalSection (&a->update);
+  __atomic_store_n (&a->inuse, 0, __ATOMIC_RELEASE);
   a->buffidx = (a->buffidx + 1) & idxmask;
   fftw_execute (a->crev);
   memcpy (a->fftin, &(a->fftin[2 * a->size]), a->size * sizeof(complex));
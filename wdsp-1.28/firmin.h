@@ -155,11 +155,32 @@ typedef struct _fircore {
   int cset;
   int mp;
   int masks_ready;
+  int inuse;          // 1 + mask set currently used by xfircore, 0 if idle
+  int single;         // 1: fftin, fftout, fmask, maskgen, accum hold float data
+#ifdef WDSP_FLOAT
+  fftwf_plan* pcforf;   // single precision counterparts of pcfor, crev, maskplan
+  fftwf_plan crevf;
+  fftwf_plan** maskplanf;
+  float* outf;        // reverse fft output, converted to 'out'
+#endif
+  // refinement of the plans while the wisdom is being built, see wisdom.c
+  struct _fircore* next;  // list of filters to be refined
+  int listed;         // filter is in that list
+  int swap;         // 1: refined plans ready for xfircore(), 2: replaced plans to be destroyed
+  fftw_plan* pcfor_swap;  // refined resp. replaced plans
+  fftw_plan crev_swap;
+#ifdef WDSP_FLOAT
+  fftwf_plan* pcforf_swap;
+  fftwf_plan crevf_swap;
+#endif
 } fircore, *FIRCORE;
 
 extern FIRCORE create_fircore (int size, double* in, double* out,
                                int nc, int mp, double* impulse);
 
+extern FIRCORE create_fircore_prec (int size, double* in, double* out,
+                                    int nc, int mp, double* impulse, int single);
+
 extern void xfircore (FIRCORE a);
 
 extern void destroy_fircore (FIRCORE a);
@@ -178,4 +199,12 @@ extern void setMp_fircore (FIRCORE a, int mp);
 
 extern void setUpdate_fircore (FIRCORE a);
 
+extern void fircore_precision (int single);
+
+extern void fircore_refine_start (void);
+
+extern int fircore_refine_sizes (int* sizes, int max);
+
+extern void fircore_refine (int last);
+
 #endif
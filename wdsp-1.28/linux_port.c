@@ -26,6 +26,7 @@ john.d.melton@googlemail.com
 */
 
 #include <errno.h>
+#include <time.h>
 
 #include "linux_port.h"
 #include "comm.h"
@@ -38,10 +39,186 @@ john.d.melton@googlemail.com
 
 #if defined(linux) || defined(__APPLE__)
 
-void QueueUserWorkItem(void *function, void *context, int flags) {
+//
+// Thread pool for QueueUserWorkItem
+//
+// On Windows, work items are executed by a system thread pool. Here, a fixed
+// number of worker threads (one per core, named WDSPpool<n>) is started upon
+// first use and fed through a circular work queue. This replaces creating and
+// joining a new thread for each item, which the analyzer dispatcher did for
+// every sub-FFT of every display frame.
+//
+// By default, QueueUserWorkItem waits until the item has been executed (this
+// is what the create/join implementation did). After SetWDSPPoolAsync(1) it
+// returns immediately, so the num_fft x num_stitch sub-FFTs queued by sendbuf()
+// run concurrently, as on Windows. spectra() and Cspectra() are designed for
+// that: they do their own locking and count active items in pnum_threads.
+//
+// The worker threads live as long as the program.
+//
+#define POOL_QUEUE_SIZE  256
+#define POOL_MAX_THREADS 16
+
+typedef struct _pool_item {
+  DWORD (*function)(void *);
+  void *context;
+  struct timespec queued;
+  volatile int *done;
+} POOL_ITEM;
+
+static pthread_once_t  pool_once  = PTHREAD_ONCE_INIT;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_work  = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  pool_done  = PTHREAD_COND_INITIALIZER;
+static POOL_ITEM pool_queue[POOL_QUEUE_SIZE];
+static int pool_inidx = 0;
+static int pool_outidx = 0;
+static int pool_depth = 0;
+static int pool_threads = 0;
+static volatile int pool_async = 0;
+
+//
+// statistics, protected by pool_mutex. Times are in seconds.
+//
+static int pool_max_depth = 0;
+static long pool_items = 0;
+static long pool_inline = 0;
+static double pool_wait_sum = 0.0;
+static double pool_wait_max = 0.0;
+static double pool_run_sum = 0.0;
+
+static double pool_elapsed(const struct timespec *t0, const struct timespec *t1) {
+  return (double)(t1->tv_sec - t0->tv_sec) + 1.0E-9 * (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+static void *pool_worker(void *arg) {
+  POOL_ITEM item;
+  struct timespec start, end;
+  double wait;
+  char tname[16];
+  snprintf(tname, sizeof(tname), "WDSPpool%d", (int)(uintptr_t)arg);
+#ifdef __APPLE__
+  (void) pthread_setname_np(tname);
+#else
+  (void) pthread_setname_np(pthread_self(), tname);
+#endif
+
+  for (;;) {
+    pthread_mutex_lock(&pool_mutex);
+
+    while (pool_depth == 0) {
+      pthread_cond_wait(&pool_work, &pool_mutex);
+    }
+
+    item = pool_queue[pool_outidx];
+
+    if (++pool_outidx == POOL_QUEUE_SIZE) { pool_outidx = 0; }
+
+    pool_depth--;
+    pthread_mutex_unlock(&pool_mutex);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    item.function(item.context);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    wait = pool_elapsed(&item.queued, &start);
+    pthread_mutex_lock(&pool_mutex);
+    pool_items++;
+    pool_wait_sum += wait;
+    pool_run_sum += pool_elapsed(&start, &end);
+
+    if (wait > pool_wait_max) { pool_wait_max = wait; }
+
+    if (item.done) {
+      *item.done = 1;
+      pthread_cond_broadcast(&pool_done);
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+  }
+
+  return NULL;
+}
+
+static void pool_start() {
   pthread_t t;
-  pthread_create(&t, NULL, function, context);
-  pthread_join(t, NULL);
+  pthread_attr_t attr;
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (ncpu < 2) { ncpu = 2; }
+
+  if (ncpu > POOL_MAX_THREADS) { ncpu = POOL_MAX_THREADS; }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  for (int i = 0; i < ncpu; i++) {
+    if (pthread_create(&t, &attr, pool_worker, (void *)(uintptr_t)i) == 0) {
+      pool_threads++;
+    }
+  }
+
+  pthread_attr_destroy(&attr);
+}
+
+void QueueUserWorkItem(void *function, void *context, int flags) {
+  volatile int done = 0;
+  DWORD (*fn)(void *) = (DWORD (*)(void *))function;
+  pthread_once(&pool_once, pool_start);
+  pthread_mutex_lock(&pool_mutex);
+
+  if (pool_threads == 0 || pool_depth == POOL_QUEUE_SIZE) {
+    //
+    // No workers, or queue full: execute in the calling thread
+    //
+    pool_inline++;
+    pthread_mutex_unlock(&pool_mutex);
+    fn(context);
+    return;
+  }
+
+  POOL_ITEM *item = &pool_queue[pool_inidx];
+  item->function = fn;
+  item->context = context;
+  item->done = pool_async ? NULL : &done;
+  clock_gettime(CLOCK_MONOTONIC, &item->queued);
+
+  if (++pool_inidx == POOL_QUEUE_SIZE) { pool_inidx = 0; }
+
+  if (++pool_depth > pool_max_depth) { pool_max_depth = pool_depth; }
+
+  pthread_cond_signal(&pool_work);
+
+  if (!pool_async) {
+    while (!done) {
+      pthread_cond_wait(&pool_done, &pool_mutex);
+    }
+  }
+
+  pthread_mutex_unlock(&pool_mutex);
+}
+
+PORT
+void SetWDSPPoolAsync(int async) {
+  pool_async = async;
+}
+
+PORT
+void GetWDSPPoolStats(int *threads, int *depth, int *max_depth, long *items, long *inline_items,
+                      double *avg_wait, double *max_wait, double *avg_run) {
+  //
+  // avg_wait: average time (usecs) from queueing an item until its execution starts
+  // max_wait: maximum of this time
+  // avg_run:  average execution time (usecs) of an item
+  //
+  pthread_mutex_lock(&pool_mutex);
+  *threads = pool_threads;
+  *depth = pool_depth;
+  *max_depth = pool_max_depth;
+  *items = pool_items;
+  *inline_items = pool_inline;
+  *avg_wait = pool_items > 0 ? 1.0E6 * pool_wait_sum / (double)pool_items : 0.0;
+  *max_wait = 1.0E6 * pool_wait_max;
+  *avg_run = pool_items > 0 ? 1.0E6 * pool_run_sum / (double)pool_items : 0.0;
+  pthread_mutex_unlock(&pool_mutex);
 }
 
 void InitializeCriticalSectionAndSpinCount(pthread_mutex_t *mutex, int count) {
@@ -205,6 +382,7 @@ HANDLE _beginthread( void( __cdecl *start_address )( void * ), unsigned stack_si
   // function.
   //
   void sendbuf(void *arg); // declared in analyzer.c but not in header file
+  void wisdom_refine(void *arg); // declared in wisdom.c but not in header file
   char tname[64];
 
   if (start_address == &wdspmain) {
@@ -220,6 +398,8 @@ HANDLE _beginthread( void( __cdecl *start_address )( void * ), unsigned stack_si
               || start_address == &PSSaveCorrection
               || start_address == &PSRestoreCorrection) {
     snprintf(tname, sizeof(tname), "PURESIGNAL");
+  } else if (start_address == &wisdom_refine) {
+    snprintf(tname, sizeof(tname), "Wwisdom");
   } else {
     // in case there are more worker types
     snprintf(tname, sizeof(tname), "WDSP");
@@ -86,6 +86,9 @@ john.d.melton@googlemail.com
   #define INFINITE -1
 
   void QueueUserWorkItem(void *function, void *context, int flags);
+  void SetWDSPPoolAsync(int async);
+  void GetWDSPPoolStats(int *threads, int *depth, int *max_depth, long *items, long *inline_items,
+                        double *avg_wait, double *max_wait, double *avg_run);
 
   void InitializeCriticalSectionAndSpinCount(pthread_mutex_t *mutex, int count);
 
@@ -75,7 +75,15 @@ void create_main (int channel) {
     break;
 
   case 1:
+#ifdef WDSP_FLOAT
+    // single precision filters are for RX only, TX stays in double (dexp and cfir,
+    // which are re-created outside create_txa, ask for double with create_fircore_prec)
+    fircore_precision (0);
     create_txa (channel);
+    fircore_precision (1);
+#else
+    create_txa (channel);
+#endif
     break;
 
   case 31:  //
@@ -26,14 +26,36 @@ warren@wpratt.com
 
 #include "comm.h"
 
+// metering is suspended if none of the results has been read for this time (seconds)
+#define METER_IDLE_TIME 1.0
+
+// Averaging and peak decay are done block-wise, in closed form:
+//   avg  <- mult_average^size * avg + sum (wavg[i] * |x[i]|^2),  wavg[i] = (1 - mult_average) * mult_average^(size - 1 - i)
+//   peak <- max (mult_peak^size * peak, max (|x[i]|^2))
+// which gives the same result as the per-sample recursion, but the inner loop is a
+// dot product and a maximum and can be vectorized.
 void calc_meter (METER a) {
+  int i;
   a->mult_average = exp(-1.0 / (a->rate * a->tau_average));
   a->mult_peak = exp(-1.0 / (a->rate * a->tau_peak_decay));
+  a->mult_average_block = pow (a->mult_average, a->size);
+  a->mult_peak_block = pow (a->mult_peak, a->size);
+  a->wavg = (double *) malloc0 (a->size * sizeof (double));
+
+  for (i = 0; i < a->size; i++) {
+    a->wavg[i] = (1.0 - a->mult_average) * pow (a->mult_average, a->size - 1 - i);
+  }
+
+  a->idle_limit = (int)(METER_IDLE_TIME * a->rate / a->size) + 1;
   flush_meter(a);
 }
 
+void decalc_meter (METER a) {
+  _aligned_free (a->wavg);
+}
+
 METER create_meter (int run, int* prun, int size, double* buff, int rate, double tau_av, double tau_decay,
-                    double* result, CRITICAL_SECTION** pmtupdate, int enum_av, int enum_pk, int enum_gain, double* pgain) {
+                    double* result, METER* pmeter, int enum_av, int enum_pk, int enum_gain, double* pgain) {
   METER a = (METER) malloc0 (sizeof (meter));
   a->run = run;
   a->prun = prun;
@@ -48,32 +70,169 @@ METER create_meter (int run, int* prun, int size, double* buff, int rate, double
   a->enum_gain = enum_gain;
   a->pgain = pgain;
   calc_meter(a);
-  InitializeCriticalSectionAndSpinCount (&a->mtupdate, 2500);
-  pmtupdate[enum_av]   = &a->mtupdate;
-  pmtupdate[enum_pk]   = &a->mtupdate;
-  pmtupdate[enum_gain] = &a->mtupdate;
+  pmeter[enum_av] = a;
+  pmeter[enum_pk] = a;
+
+  if (enum_gain >= 0) { pmeter[enum_gain] = a; }
+
   return a;
 }
 
 void destroy_meter (METER a) {
-  DeleteCriticalSection (&a->mtupdate);
+  decalc_meter (a);
   _aligned_free (a);
 }
 
+/********************************************************************************************************
+*                                                   *
+*                   Publishing the Results                      *
+*                                                   *
+********************************************************************************************************/
+
+// The results are written by the DSP thread only, and read by GetRXAMeter()/GetTXAMeter()
+// without a lock: the sequence counter is odd while the results are being written, and a
+// reader retries if it was odd or has changed while reading.
+
+static inline void meter_write_begin (METER a) {
+  __atomic_store_n (&a->seq, a->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static inline void meter_write_end (METER a) {
+  __atomic_store_n (&a->seq, a->seq + 1, __ATOMIC_RELEASE);
+}
+
+static double meter_read (METER a, double* result) {
+  unsigned int seq;
+  double val;
+
+  do {
+    seq = __atomic_load_n (&a->seq, __ATOMIC_ACQUIRE);
+    val = *result;
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  } while ((seq & 1) || seq != __atomic_load_n (&a->seq, __ATOMIC_RELAXED));
+
+  // any read keeps the meter running
+  __atomic_store_n (&a->idle, 0, __ATOMIC_RELAXED);
+  return val;
+}
+
 void flush_meter (METER a) {
   a->avg  = 0.0;
   a->peak = 0.0;
+  a->stale = 0;
+  meter_write_begin (a);
   a->result[a->enum_av] = -400.0;
   a->result[a->enum_pk] = -400.0;
 
   if ((a->pgain != 0) && (a->enum_gain >= 0)) {
     a->result[a->enum_gain] = -400.0;
   }
+
+  meter_write_end (a);
+}
+
+/********************************************************************************************************
+*                                                   *
+*                     Metering Kernels                      *
+*                                                   *
+********************************************************************************************************/
+
+// one pass over n complex samples: *wsum = sum (w[i] * |x[i]|^2), *pk = max (|x[i]|^2)
+
+static void meter_scalar (const double* x, const double* w, int n, double* wsum, double* pk) {
+  int i;
+  double sum = 0.0;
+  double np = 0.0;
+
+  for (i = 0; i < n; i++) {
+    double smag = x[2 * i + 0] * x[2 * i + 0] + x[2 * i + 1] * x[2 * i + 1];
+    sum += w[i] * smag;
+
+    if (smag > np) { np = smag; }
+  }
+
+  *wsum += sum;
+
+  if (np > *pk) { *pk = np; }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define METER_X86
+
+// four complex values per iteration: hadd gives the magnitudes in the
+// order 0, 2, 1, 3 which permute4x64 puts back in place
+__attribute__((target("avx2,fma")))
+static void meter_avx2 (const double* x, const double* w, int n, double* wsum, double* pk) {
+  int i = 0;
+  double t[4];
+  __m256d acc = _mm256_setzero_pd ();
+  __m256d mx = _mm256_setzero_pd ();
+
+  for (; i + 4 <= n; i += 4) {
+    __m256d x0 = _mm256_loadu_pd (x + 2 * i);
+    __m256d x1 = _mm256_loadu_pd (x + 2 * i + 4);
+    __m256d smag = _mm256_hadd_pd (_mm256_mul_pd (x0, x0), _mm256_mul_pd (x1, x1));
+    smag = _mm256_permute4x64_pd (smag, 0xD8);
+    acc = _mm256_fmadd_pd (smag, _mm256_loadu_pd (w + i), acc);
+    mx = _mm256_max_pd (mx, smag);
+  }
+
+  _mm256_storeu_pd (t, acc);
+  *wsum += (t[0] + t[1]) + (t[2] + t[3]);
+  _mm256_storeu_pd (t, mx);
+  *pk = max (*pk, max (max (t[0], t[1]), max (t[2], t[3])));
+  meter_scalar (x + 2 * i, w + i, n - i, wsum, pk);
+}
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define METER_NEON
+
+// two complex values per iteration, vld2q separates real and imaginary parts
+static void meter_neon (const double* x, const double* w, int n, double* wsum, double* pk) {
+  int i = 0;
+  float64x2_t acc = vdupq_n_f64 (0.0);
+  float64x2_t mx = vdupq_n_f64 (0.0);
+
+  for (; i + 2 <= n; i += 2) {
+    float64x2x2_t v = vld2q_f64 (x + 2 * i);
+    float64x2_t smag = vfmaq_f64 (vmulq_f64 (v.val[0], v.val[0]), v.val[1], v.val[1]);
+    acc = vfmaq_f64 (acc, smag, vld1q_f64 (w + i));
+    mx = vmaxq_f64 (mx, smag);
+  }
+
+  *wsum += vaddvq_f64 (acc);
+  *pk = max (*pk, vmaxvq_f64 (mx));
+  meter_scalar (x + 2 * i, w + i, n - i, wsum, pk);
+}
+#endif
+
+typedef void (*meter_fn) (const double*, const double*, int, double*, double*);
+
+static meter_fn meter_kernel = NULL;
+
+// run-time selection upon first use; a race between two threads
+// doing this simultaneously is harmless since both get the same result
+static meter_fn meter_select (void) {
+#ifdef METER_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    return meter_avx2;
+  }
+
+#endif
+#ifdef METER_NEON
+  return meter_neon;
+#endif
+  return meter_scalar;
 }
 
 void xmeter (METER a) {
   int srun;
-  EnterCriticalSection (&a->mtupdate);
 
   if (a->prun != 0) {
     srun = *(a->prun);
@@ -82,35 +241,74 @@ void xmeter (METER a) {
   }
 
   if (a->run && srun) {
-    int i;
-    double smag;
+    // lazy metering: skip the computation if nobody has read the results recently.
+    // Upon suspending, "no data" is published, such that the first read after a
+    // long pause (e.g. a TX meter read upon the next transmission) does not
+    // report an old level.
+    if (__atomic_load_n (&a->idle, __ATOMIC_RELAXED) >= a->idle_limit) {
+      if (!a->stale) {
+        a->stale = 1;
+        meter_write_begin (a);
+        a->result[a->enum_av] = -400.0;
+        a->result[a->enum_pk] = -400.0;
+
+        if ((a->pgain != 0) && (a->enum_gain >= 0)) {
+          a->result[a->enum_gain] = -400.0;
+        }
+
+        meter_write_end (a);
+      }
+
+      return;
+    }
+
+    __atomic_fetch_add (&a->idle, 1, __ATOMIC_RELAXED);
+    double wsum = 0.0;
     double np = 0.0;
 
-    for (i = 0; i < a->size; i++) {
-      smag = a->buff[2 * i + 0] * a->buff[2 * i + 0] + a->buff[2 * i + 1] * a->buff[2 * i + 1];
-      a->avg = a->avg * a->mult_average + (1.0 - a->mult_average) * smag;
-      a->peak *= a->mult_peak;
+    if (meter_kernel == NULL) { meter_kernel = meter_select (); }
 
-      if (smag > np) { np = smag; }
-    }
+    meter_kernel (a->buff, a->wavg, a->size, &wsum, &np);
+
+    if (a->stale) {
+      // resuming: start from this buffer instead of the out-of-date values
+      int i;
+      double sum = 0.0;
+
+      for (i = 0; i < 2 * a->size; i++) {
+        sum += a->buff[i] * a->buff[i];
+      }
 
-    if (np > a->peak) { a->peak = np; }
+      a->avg = sum / a->size;
+      a->peak = np;
+      a->stale = 0;
+    } else {
+      a->avg = a->mult_average_block * a->avg + wsum;
+      a->peak *= a->mult_peak_block;
+
+      if (np > a->peak) { a->peak = np; }
+    }
 
+    meter_write_begin (a);
     a->result[a->enum_av] = 10.0 * mlog10 (a->avg + 1.0e-40);
     a->result[a->enum_pk] = 10.0 * mlog10 (a->peak + 1.0e-40);
 
     if ((a->pgain != 0) && (a->enum_gain >= 0)) {
       a->result[a->enum_gain] = 20.0 * mlog10 (*a->pgain + 1.0e-40);
     }
+
+    meter_write_end (a);
   } else {
+    meter_write_begin (a);
+
     if (a->enum_av   >= 0) { a->result[a->enum_av]   = - 400.0; }
 
     if (a->enum_pk   >= 0) { a->result[a->enum_pk]   = - 400.0; }
 
     if (a->enum_gain >= 0) { a->result[a->enum_gain] = +   0.0; }
-  }
 
-  LeaveCriticalSection (&a->mtupdate);
+    meter_write_end (a);
+  }
 }
 
 void setBuffers_meter (METER a, double* in) {
@@ -119,12 +317,14 @@ void setBuffers_meter (METER a, double* in) {
 
 void setSamplerate_meter (METER a, int rate) {
   a->rate = rate;
+  decalc_meter (a);
   calc_meter(a);
 }
 
 void setSize_meter (METER a, int size) {
   a->size = size;
-  flush_meter (a);
+  decalc_meter (a);
+  calc_meter (a);
 }
 
 /********************************************************************************************************
@@ -135,12 +335,11 @@ void setSize_meter (METER a, int size) {
 
 PORT
 double GetRXAMeter (int channel, int mt) {
-  double val;
-  CRITICAL_SECTION* a = rxa[channel].pmtupdate[mt];
-  EnterCriticalSection (a);
-  val = rxa[channel].meter[mt];
-  LeaveCriticalSection (a);
-  return val;
+  METER a = rxa[channel].pmeter[mt];
+
+  if (a == 0) { return rxa[channel].meter[mt]; }
+
+  return meter_read (a, &rxa[channel].meter[mt]);
 }
 
 /********************************************************************************************************
@@ -151,10 +350,9 @@ double GetRXAMeter (int channel, int mt) {
 
 PORT
 double GetTXAMeter (int channel, int mt) {
-  double val;
-  CRITICAL_SECTION* a = txa[channel].pmtupdate[mt];
-  EnterCriticalSection (a);
-  val = txa[channel].meter[mt];
-  LeaveCriticalSection (a);
-  return val;
+  METER a = txa[channel].pmeter[mt];
+
+  if (a == 0) { return txa[channel].meter[mt]; }
+
+  return meter_read (a, &txa[channel].meter[mt]);
 }
\ No newline at end of file
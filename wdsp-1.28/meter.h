@@ -44,11 +44,17 @@ typedef struct _meter {
   double* pgain;
   double avg;
   double peak;
-  CRITICAL_SECTION mtupdate;
+  double* wavg;         // weights for block-wise averaging, see calc_meter()
+  double mult_average_block;
+  double mult_peak_block;
+  int idle;           // number of buffers since the last read of a result
+  int idle_limit;       // number of buffers after which metering is suspended
+  int stale;          // metering has been suspended, avg and peak are out of date
+  unsigned int seq;     // sequence counter, odd while the results are being written
 } meter, *METER;
 
 extern METER create_meter (int run, int* prun, int size, double* buff, int rate, double tau_av, double tau_decay,
-                           double* result, CRITICAL_SECTION** pmtupdate, int enum_av, int enum_pk, int enum_gain, double* pgain);
+                           double* result, METER* pmeter, int enum_av, int enum_pk, int enum_gain, double* pgain);
 
 extern void destroy_meter (METER a);
 
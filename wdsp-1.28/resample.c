@@ -26,6 +26,162 @@ warren@wpratt.com
 
 #include "comm.h"
 
+/************************************************************************************************
+*                                               *
+*                   Dot-Product Kernels                     *
+*                                               *
+************************************************************************************************/
+
+// The resamplers keep their history in a "mirrored" ring: each sample is stored
+// twice, at idx and idx + ringsize, so the ringsize samples starting at any idx
+// are contiguous and the tap loop needs no wrap-around test. The dot products
+// of the (real) polyphase coefficients with such a window are done by the
+// kernels below, selected at run time as in firmin.c.
+
+// I + jQ = sum h[j] * x[j] over n taps, x interleaved re/im
+
+static void cdot_scalar (const double* h, const double* x, int n, double* I, double* Q) {
+  int j;
+  double sI = 0.0, sQ = 0.0;
+
+  for (j = 0; j < n; j++) {
+    sI += h[j] * x[2 * j + 0];
+    sQ += h[j] * x[2 * j + 1];
+  }
+
+  *I = sI;
+  *Q = sQ;
+}
+
+// sum h[j] * x[j] over n taps, x real
+
+static double rdot_scalar (const double* h, const double* x, int n) {
+  int j;
+  double s = 0.0;
+
+  for (j = 0; j < n; j++) {
+    s += h[j] * x[j];
+  }
+
+  return s;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RDOT_X86
+
+// four taps per iteration: (h0, h0, h1, h1) and (h2, h2, h3, h3) are
+// multiplied with the interleaved samples, even lanes accumulate I, odd lanes Q
+__attribute__((target("avx2,fma")))
+static void cdot_avx2 (const double* h, const double* x, int n, double* I, double* Q) {
+  int j = 0;
+  double tI, tQ;
+  __m256d acc0 = _mm256_setzero_pd ();
+  __m256d acc1 = _mm256_setzero_pd ();
+
+  for (; j + 4 <= n; j += 4) {
+    __m256d hv = _mm256_loadu_pd (h + j);
+    acc0 = _mm256_fmadd_pd (_mm256_permute4x64_pd (hv, 0x50), _mm256_loadu_pd (x + 2 * j),     acc0);
+    acc1 = _mm256_fmadd_pd (_mm256_permute4x64_pd (hv, 0xFA), _mm256_loadu_pd (x + 2 * j + 4), acc1);
+  }
+
+  __m256d acc = _mm256_add_pd (acc0, acc1);
+  __m128d s = _mm_add_pd (_mm256_castpd256_pd128 (acc), _mm256_extractf128_pd (acc, 1));
+  cdot_scalar (h + j, x + 2 * j, n - j, &tI, &tQ);
+  *I = _mm_cvtsd_f64 (s) + tI;
+  *Q = _mm_cvtsd_f64 (_mm_unpackhi_pd (s, s)) + tQ;
+}
+
+__attribute__((target("avx2,fma")))
+static double rdot_avx2 (const double* h, const double* x, int n) {
+  int j = 0;
+  __m256d acc0 = _mm256_setzero_pd ();
+  __m256d acc1 = _mm256_setzero_pd ();
+
+  for (; j + 8 <= n; j += 8) {
+    acc0 = _mm256_fmadd_pd (_mm256_loadu_pd (h + j),     _mm256_loadu_pd (x + j),     acc0);
+    acc1 = _mm256_fmadd_pd (_mm256_loadu_pd (h + j + 4), _mm256_loadu_pd (x + j + 4), acc1);
+  }
+
+  __m256d acc = _mm256_add_pd (acc0, acc1);
+  __m128d s = _mm_add_pd (_mm256_castpd256_pd128 (acc), _mm256_extractf128_pd (acc, 1));
+  s = _mm_add_sd (s, _mm_unpackhi_pd (s, s));
+  return _mm_cvtsd_f64 (s) + rdot_scalar (h + j, x + j, n - j);
+}
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define RDOT_NEON
+
+// one tap per vector (I, Q), two accumulators to hide the FMA latency
+static void cdot_neon (const double* h, const double* x, int n, double* I, double* Q) {
+  int j = 0;
+  float64x2_t acc0 = vdupq_n_f64 (0.0);
+  float64x2_t acc1 = vdupq_n_f64 (0.0);
+
+  for (; j + 2 <= n; j += 2) {
+    acc0 = vfmaq_n_f64 (acc0, vld1q_f64 (x + 2 * j),     h[j]);
+    acc1 = vfmaq_n_f64 (acc1, vld1q_f64 (x + 2 * j + 2), h[j + 1]);
+  }
+
+  if (j < n) {
+    acc0 = vfmaq_n_f64 (acc0, vld1q_f64 (x + 2 * j), h[j]);
+  }
+
+  acc0 = vaddq_f64 (acc0, acc1);
+  *I = vgetq_lane_f64 (acc0, 0);
+  *Q = vgetq_lane_f64 (acc0, 1);
+}
+
+static double rdot_neon (const double* h, const double* x, int n) {
+  int j = 0;
+  float64x2_t acc0 = vdupq_n_f64 (0.0);
+  float64x2_t acc1 = vdupq_n_f64 (0.0);
+
+  for (; j + 4 <= n; j += 4) {
+    acc0 = vfmaq_f64 (acc0, vld1q_f64 (h + j),     vld1q_f64 (x + j));
+    acc1 = vfmaq_f64 (acc1, vld1q_f64 (h + j + 2), vld1q_f64 (x + j + 2));
+  }
+
+  return vaddvq_f64 (vaddq_f64 (acc0, acc1)) + rdot_scalar (h + j, x + j, n - j);
+}
+#endif
+
+typedef void (*cdot_fn) (const double*, const double*, int, double*, double*);
+typedef double (*rdot_fn) (const double*, const double*, int);
+
+static cdot_fn cdot_kernel = NULL;
+static rdot_fn rdot_kernel = NULL;
+
+// run-time selection upon first use; a race between two threads
+// doing this simultaneously is harmless since both get the same result
+static void rdot_select (void) {
+  cdot_fn c = cdot_scalar;
+  rdot_fn r = rdot_scalar;
+#ifdef RDOT_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+    c = cdot_avx2;
+    r = rdot_avx2;
+  }
+
+#endif
+#ifdef RDOT_NEON
+  c = cdot_neon;
+  r = rdot_neon;
+#endif
+  rdot_kernel = r;
+  cdot_kernel = c;
+}
+
+void cdot_resample (const double* h, const double* x, int n, double* I, double* Q) {
+  if (cdot_kernel == NULL) { rdot_select (); }
+
+  cdot_kernel (h, x, n, I, Q);
+}
+
 /************************************************************************************************
 *                                               *
 *               VERSION FOR COMPLEX DOUBLE-PRECISION                *
@@ -83,7 +239,7 @@ void calc_resample (RESAMPLE a) {
     }
 
   a->ringsize = a->cpp;
-  a->ring = (double *)malloc0(a->ringsize * sizeof(complex));
+  a->ring = (double *)malloc0(2 * a->ringsize * sizeof(complex));   // mirrored
   a->idx_in = a->ringsize - 1;
   a->phnum = 0;
   _aligned_free(impulse);
@@ -120,7 +276,7 @@ void destroy_resample (RESAMPLE a) {
 
 PORT
 void flush_resample (RESAMPLE a) {
-  memset (a->ring, 0, a->ringsize * sizeof (complex));
+  memset (a->ring, 0, 2 * a->ringsize * sizeof (complex));
   a->idx_in = a->ringsize - 1;
   a->phnum = 0;
 }
@@ -130,8 +286,7 @@ int xresample (RESAMPLE a) {
   int outsamps = 0;
 
   if (a->run) {
-    int i, j, n;
-    int idx_out;
+    int i;
     double I, Q;
     int cpp = a->cpp;
     int idx_in = a->idx_in;
@@ -139,22 +294,16 @@ int xresample (RESAMPLE a) {
     double* h = a->h;
     double* ring = a->ring;
 
-    for (i = 0; i < a->size; i++) {
-      ring[2 * idx_in + 0] = a->in[2 * i + 0];
-      ring[2 * idx_in + 1] = a->in[2 * i + 1];
-
-      while (a->phnum < a->L) {
-        I = 0.0;
-        Q = 0.0;
-        n = cpp * a->phnum;
+    if (cdot_kernel == NULL) { rdot_select (); }
 
-        for (j = 0; j < cpp; j++) {
-          if ((idx_out = idx_in + j) >= ringsize) { idx_out -= ringsize; }
+    cdot_fn dot = cdot_kernel;
 
-          I += h[n + j] * ring[2 * idx_out + 0];
-          Q += h[n + j] * ring[2 * idx_out + 1];
-        }
+    for (i = 0; i < a->size; i++) {
+      ring[2 * idx_in + 0] = ring[2 * (idx_in + ringsize) + 0] = a->in[2 * i + 0];
+      ring[2 * idx_in + 1] = ring[2 * (idx_in + ringsize) + 1] = a->in[2 * i + 1];
 
+      while (a->phnum < a->L) {
+        dot (h + cpp * a->phnum, ring + 2 * idx_in, cpp, &I, &Q);
         a->out[2 * outsamps + 0] = I;
         a->out[2 * outsamps + 1] = Q;
         outsamps++;
@@ -286,7 +435,7 @@ RESAMPLEF create_resampleF ( int run, int size, float* in, float* out, int in_ra
     }
 
   a->ringsize = a->cpp;
-  a->ring = (double *) malloc0 (a->ringsize * sizeof (double));
+  a->ring = (double *) malloc0 (2 * a->ringsize * sizeof (double));   // mirrored
   a->idx_in = a->ringsize - 1;
   a->phnum = 0;
   _aligned_free (impulse);
@@ -300,7 +449,7 @@ void destroy_resampleF (RESAMPLEF a) {
 }
 
 void flush_resampleF (RESAMPLEF a) {
-  memset (a->ring, 0, a->ringsize * sizeof (double));
+  memset (a->ring, 0, 2 * a->ringsize * sizeof (double));
   a->idx_in = a->ringsize - 1;
   a->phnum = 0;
 }
@@ -309,24 +458,17 @@ int xresampleF (RESAMPLEF a) {
   int outsamps = 0;
 
   if (a->run) {
-    int i, j, n;
-    int idx_out;
-    double I;
+    int i;
 
-    for (i = 0; i < a->size; i++) {
-      a->ring[a->idx_in] = (double)a->in[i];
+    if (rdot_kernel == NULL) { rdot_select (); }
 
-      while (a->phnum < a->L) {
-        I = 0.0;
-        n = a->cpp * a->phnum;
+    rdot_fn dot = rdot_kernel;
 
-        for (j = 0; j < a->cpp; j++) {
-          if ((idx_out = a->idx_in + j) >= a->ringsize) { idx_out -= a->ringsize; }
-
-          I += a->h[n + j] * a->ring[idx_out];
-        }
+    for (i = 0; i < a->size; i++) {
+      a->ring[a->idx_in] = a->ring[a->idx_in + a->ringsize] = (double)a->in[i];
 
-        a->out[outsamps] = (float)I;
+      while (a->phnum < a->L) {
+        a->out[outsamps] = (float)dot (a->h + a->cpp * a->phnum, a->ring + a->idx_in, a->cpp);
         outsamps++;
         a->phnum += a->M;
       }
@@ -51,7 +51,7 @@ typedef struct _resample {
   int M;        // decimation factor
   double* h;      // coefficients
   int ringsize;   // number of complex pairs the ring buffer holds
-  double* ring;   // ring buffer
+  double* ring;   // ring buffer, mirrored (2 * ringsize complex pairs)
   int cpp;      // coefficients of the phase
   int phnum;      // phase number
 } resample, *RESAMPLE;
@@ -81,6 +81,8 @@ extern void setFCLow_resample (RESAMPLE a, double fc_low);
 
 extern void setBandwidth_resample (RESAMPLE a, double fc_low, double fc_high);
 
+extern void cdot_resample (const double* h, const double* x, int n, double* I, double* Q);
+
 #endif
 
 /************************************************************************************************
@@ -103,7 +105,7 @@ typedef struct _resampleF {
   int M;        // decimation factor
   double* h;      // coefficients
   int ringsize;   // number of values the ring buffer holds
-  double* ring;   // ring buffer
+  double* ring;   // ring buffer, mirrored (2 * ringsize values)
   int cpp;      // coefficients of the phase
   int phnum;      // phase number
 } resampleF, *RESAMPLEF;
@@ -431,6 +431,7 @@ extern void SetRXAEMNRpost2Taper(int channel, int taper);
 extern void SetRXAEMNRpost2Rate(int channel, double tc);
 extern void SetRXAEMNRRun (int channel, int run);
 extern void SetRXAEMNRgainMethod (int channel, int method);
+extern void SetRXAEMNRfastGain (int channel, int run);
 extern void SetRXAEMNRnpeMethod (int channel, int method);
 extern void SetRXAEMNRaeRun (int channel, int run);
 extern void SetRXAEMNRPosition (int channel, int position);
@@ -626,6 +627,14 @@ extern void SetTXAiqcSwap (int channel, double* cm, double* cc, double* cs);
 extern void SetTXAiqcStart (int channel, double* cm, double* cc, double* cs);
 extern void SetTXAiqcEnd (int channel);
 
+//
+// Interfaces from linux_port.c
+//
+
+extern void SetWDSPPoolAsync(int async);
+extern void GetWDSPPoolStats(int *threads, int *depth, int *max_depth, long *items, long *inline_items,
+                             double *avg_wait, double *max_wait, double *avg_run);
+
 //
 // Interfaces from meter.c
 //
@@ -957,3 +966,6 @@ extern  void SetTXALevelerTop (int channel, double maxgain);
 
 extern char* wisdom_get_status();
 extern int WDSPwisdom (char* directory);
+extern int WDSPwisdom_tiered (char* directory);
+extern void WDSPwisdom_refine_start (void);
+extern int WDSPwisdom_refining (void);
@@ -26,9 +26,19 @@ warren@wpratt.com
 
 #define _CRT_SECURE_NO_WARNINGS
 #include "comm.h"
+#if defined(__APPLE__)
+  #include <sys/sysctl.h>
+#endif
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
 
 static char status[128];
 
+unsigned int wisdom_planflags = FFTW_PATIENT;
+
 PORT
 char* wisdom_get_status() {
   return status;
@@ -116,5 +126,407 @@ int WDSPwisdom (char* directory) {
     wisdom_return = 1;
   }
 
+#ifdef WDSP_FLOAT
+  // single precision plans for the filters (see fircore), kept in a file of their own
+  strcpy (wisdom_file, directory);
+  strncat (wisdom_file, "wdspWisdomF00", 16);
+
+  if (!fftwf_import_wisdom_from_filename(wisdom_file)) {
+    fftwf_plan tplanf;
+    float* fftinf =  (float *) malloc0 (2 * MAX_WISDOM_SIZE_FILTER * sizeof (float));
+    float* fftoutf = (float *) malloc0 (2 * MAX_WISDOM_SIZE_FILTER * sizeof (float));
+    psize = 64;
+
+    while (psize <= MAX_WISDOM_SIZE_FILTER) {
+      fprintf(stdout, "Planning COMPLEX FORWARD  FFT size %d (single precision)\n", psize);
+      fflush(stdout);
+      sprintf(status, "Planning COMPLEX FORWARD  FFT size %d (single precision)\n", psize);
+      tplanf = fftwf_plan_dft_1d(psize, (fftwf_complex *)fftinf, (fftwf_complex *)fftoutf, FFTW_FORWARD, FFTW_PATIENT);
+      fftwf_execute (tplanf);
+      fftwf_destroy_plan (tplanf);
+      fprintf(stdout, "Planning COMPLEX BACKWARD FFT size %d (single precision)\n", psize);
+      fflush(stdout);
+      sprintf(status, "Planning COMPLEX BACKWARD FFT size %d (single precision)\n", psize);
+      tplanf = fftwf_plan_dft_1d(psize, (fftwf_complex *)fftinf, (fftwf_complex *)fftoutf, FFTW_BACKWARD, FFTW_PATIENT);
+      fftwf_execute (tplanf);
+      fftwf_destroy_plan (tplanf);
+      psize *= 2;
+    }
+
+    fftwf_export_wisdom_to_filename(wisdom_file);
+    _aligned_free (fftoutf);
+    _aligned_free (fftinf);
+    wisdom_return = 1;
+  }
+
+#endif
   return wisdom_return;
 }
+
+/********************************************************************************************************
+*                                                   *
+*                     Tiered Wisdom                         *
+*                                                   *
+********************************************************************************************************/
+
+// WDSPwisdom() builds the complete wisdom before it returns, which takes many minutes on
+// small ARM boards. WDSPwisdom_tiered() returns at once:
+//
+// - The wisdom files for this CPU model (wdspWisdom00-<model>) and the generic one
+//   (wdspWisdom00, e.g. from WDSPwisdom()) are imported, FFTW merges them. If there
+//   is wisdom, 0 is returned and everything is as with WDSPwisdom().
+// - Otherwise, what an interrupted refinement has left (the ".part" file) is imported, and
+//   FFTW_ESTIMATE is used for all plans such that the radio can start immediately.
+//
+// The wisdom is built by a child process, forked right away (before anything else plans), with
+// FFTW_PATIENT and without a time limit, such that it is the same as from WDSPwisdom(). Since
+// the child has a planner of its own, plans made by the radio in the meantime never wait for
+// it. The child waits until the channels are open: WDSPwisdom_refine_start() starts a thread
+// that sends it the fft sizes of the filters in use, these are planned first, then all sizes
+// planned by WDSPwisdom(). Filters opened later have their sizes sent and planned before the
+// next size of the sweep. After each size the child saves its wisdom to the ".part" file and
+// reports it; the thread imports the file and refines the plans of the running filters (see
+// fircore_refine), the analyzers pick up the wisdom with their next SetAnalyzer(). Only the
+// complete wisdom is saved for this CPU model, then WDSPwisdom_refining() returns 0.
+
+static char wisdom_dir[1024];
+static char wisdom_cpu[64];
+static int wisdom_refining = 0;
+static int wisdom_in_use[32];
+static int wisdom_in_use_count = 0;
+static pid_t wisdom_pid = -1;
+static int wisdom_sizes_fd = -1;    // thread -> child: fft sizes in use
+static int wisdom_report_fd = -1;   // child -> thread: WISDOM_PART, WISDOM_DONE
+
+#define WISDOM_PART 'p'
+#define WISDOM_DONE 'd'
+
+static void wisdom_cpu_model (void) {
+  char model[128] = "";
+  int i, n = 0;
+#if defined(__APPLE__)
+  size_t len = sizeof (model);
+
+  if (sysctlbyname ("machdep.cpu.brand_string", model, &len, NULL, 0) != 0) { model[0] = 0; }
+
+#else
+  char line[256];
+  FILE* fp = fopen ("/proc/cpuinfo", "r");
+
+  if (fp != NULL) {
+    // x86 has "model name", ARM boards have "Model" (e.g. "Raspberry Pi 5 Model B Rev 1.0")
+    while (fgets (line, sizeof (line), fp)) {
+      char* value = strchr (line, ':');
+
+      if (value == NULL) { continue; }
+
+      if ((!strncmp (line, "model name", 10) && !model[0]) || !strncmp (line, "Model", 5)) {
+        snprintf (model, sizeof (model), "%s", value + 1);
+      }
+    }
+
+    fclose (fp);
+  }
+
+#endif
+
+  // file name: letters and digits only, everything else becomes a single '_'
+  for (i = 0; model[i] && n < (int)sizeof (wisdom_cpu) - 1; i++) {
+    char c = model[i];
+
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+      wisdom_cpu[n++] = c;
+    } else if (n > 0 && wisdom_cpu[n - 1] != '_') {
+      wisdom_cpu[n++] = '_';
+    }
+  }
+
+  if (n > 0 && wisdom_cpu[n - 1] == '_') { n--; }
+
+  wisdom_cpu[n] = 0;
+
+  if (n == 0) { strcpy (wisdom_cpu, "generic"); }
+}
+
+static void wisdom_filename (char* name, size_t len, const char* base, const char* suffix) {
+  snprintf (name, len, "%s%s-%s%s", wisdom_dir, base, wisdom_cpu, suffix);
+}
+
+static void wisdom_save (const char* suffix) {
+  char name[1200];
+  wisdom_filename (name, sizeof (name), "wdspWisdom00", suffix);
+  fftw_export_wisdom_to_filename (name);
+#ifdef WDSP_FLOAT
+  wisdom_filename (name, sizeof (name), "wdspWisdomF00", suffix);
+  fftwf_export_wisdom_to_filename (name);
+#endif
+}
+
+static void wisdom_plan_c2c (int psize, int sign, double* fftin, double* fftout) {
+  fftw_plan tplan = fftw_plan_dft_1d(psize, (fftw_complex *)fftin, (fftw_complex *)fftout, sign, FFTW_PATIENT);
+  fftw_execute (tplan);
+  fftw_destroy_plan (tplan);
+#ifdef WDSP_FLOAT
+
+  if (psize <= MAX_WISDOM_SIZE_FILTER) {
+    fftwf_plan tplanf = fftwf_plan_dft_1d(psize, (fftwf_complex *)fftin, (fftwf_complex *)fftout, sign, FFTW_PATIENT);
+    fftwf_execute (tplanf);
+    fftwf_destroy_plan (tplanf);
+  }
+
+#endif
+}
+
+// true if 'size' has not been planned yet (and is marked as planned now)
+static int wisdom_in_use_new (int size) {
+  int j;
+
+  for (j = 0; j < wisdom_in_use_count; j++) {
+    if (wisdom_in_use[j] == size) { return 0; }
+  }
+
+  if (wisdom_in_use_count >= 32 || size > MAX_WISDOM_SIZE_FILTER + 1) { return 0; }
+
+  wisdom_in_use[wisdom_in_use_count++] = size;
+  return 1;
+}
+
+// child: plans the fft sizes of the filters in use that have been sent so far
+static void wisdom_child_in_use (double* fftin, double* fftout) {
+  int sizes[64];
+  int i, n;
+  struct pollfd pfd = { wisdom_sizes_fd, POLLIN, 0 };
+
+  while (poll (&pfd, 1, 0) > 0) {
+    n = read (wisdom_sizes_fd, sizes, sizeof (sizes));
+
+    // the radio has terminated
+    if (n <= 0) { _exit (1); }
+
+    for (i = 0; i < n / (int)sizeof (int); i++) {
+      if (sizes[i] > 0 && wisdom_in_use_new (sizes[i])) {
+        wisdom_plan_c2c (sizes[i], FFTW_FORWARD, fftin, fftout);
+        wisdom_plan_c2c (sizes[i], FFTW_BACKWARD, fftin, fftout);
+      }
+    }
+  }
+}
+
+static void wisdom_child_report (char what) {
+  if (write (wisdom_report_fd, &what, 1) != 1) { _exit (1); }
+}
+
+// child: saves the partial wisdom and reports it
+static void wisdom_child_part (void) {
+  wisdom_save (".part");
+  wisdom_child_report (WISDOM_PART);
+}
+
+static void wisdom_child (void) {
+  int psize;
+  char name[1200];
+  const int maxsize = max (MAX_WISDOM_SIZE_DISPLAY, MAX_WISDOM_SIZE_FILTER + 1);
+  double* fftin =  (double *) malloc0 (maxsize * sizeof (complex));
+  double* fftout = (double *) malloc0 (maxsize * sizeof (complex));
+  fftw_plan tplan;
+  struct pollfd pfd = { 0, POLLIN, 0 };
+  signal (SIGPIPE, SIG_IGN);
+  setpriority (PRIO_PROCESS, 0, 19);
+  // wait until the channels are open and the sizes in use are known
+  pfd.fd = wisdom_sizes_fd;
+
+  while (poll (&pfd, 1, -1) < 0) {}
+
+  // first tier: the fft sizes of the filters in use
+  wisdom_child_in_use (fftin, fftout);
+  wisdom_child_part ();
+  // second tier: everything planned by WDSPwisdom(), the partial wisdom
+  // is saved after each size, so an interrupted refinement can resume
+  psize = 64;
+
+  while (psize <= MAX_WISDOM_SIZE_FILTER) {
+    wisdom_child_in_use (fftin, fftout);
+    wisdom_plan_c2c (psize, FFTW_FORWARD, fftin, fftout);
+    wisdom_plan_c2c (psize, FFTW_BACKWARD, fftin, fftout);
+    tplan = fftw_plan_dft_1d(psize + 1, (fftw_complex *)fftin, (fftw_complex *)fftout, FFTW_BACKWARD, FFTW_PATIENT);
+    fftw_execute (tplan);
+    fftw_destroy_plan (tplan);
+    wisdom_child_part ();
+    psize *= 2;
+  }
+
+  psize = 64;
+
+  while (psize <= MAX_WISDOM_SIZE_DISPLAY) {
+    wisdom_child_in_use (fftin, fftout);
+
+    if (psize > MAX_WISDOM_SIZE_FILTER) {
+      wisdom_plan_c2c (psize, FFTW_FORWARD, fftin, fftout);
+    }
+
+    tplan = fftw_plan_dft_r2c_1d(psize, fftin, (fftw_complex *)fftout, FFTW_PATIENT);
+    fftw_execute (tplan);
+    fftw_destroy_plan (tplan);
+    wisdom_child_part ();
+    psize *= 2;
+  }
+
+  wisdom_save ("");
+  wisdom_filename (name, sizeof (name), "wdspWisdom00", ".part");
+  remove (name);
+#ifdef WDSP_FLOAT
+  wisdom_filename (name, sizeof (name), "wdspWisdomF00", ".part");
+  remove (name);
+#endif
+  wisdom_child_report (WISDOM_DONE);
+  _exit (0);
+}
+
+static void wisdom_import (const char* suffix) {
+  char name[1200];
+  wisdom_filename (name, sizeof (name), "wdspWisdom00", suffix);
+  fftw_import_wisdom_from_filename (name);
+#ifdef WDSP_FLOAT
+  wisdom_filename (name, sizeof (name), "wdspWisdomF00", suffix);
+  fftwf_import_wisdom_from_filename (name);
+#endif
+}
+
+// sends the fft sizes of the filters in use that have not been sent yet to the child,
+// upon the first call something is sent in any case, since the child waits for it
+static void wisdom_send_in_use (int first) {
+  int sizes[32];
+  int send[32];
+  int i, m = 0, n = fircore_refine_sizes (sizes, 32);
+
+  for (i = 0; i < n; i++) {
+    if (wisdom_in_use_new (sizes[i])) { send[m++] = sizes[i]; }
+  }
+
+  // a zero means "nothing to plan"
+  if (m == 0 && first) { send[m++] = 0; }
+
+  if (m > 0 && write (wisdom_sizes_fd, send, m * sizeof (int))) {}
+}
+
+void wisdom_refine (void* arg) {
+  char what = 0;
+  struct pollfd pfd = { wisdom_report_fd, POLLIN, 0 };
+  (void) arg;
+  sprintf (status, "Building FFTW wisdom for %s in the background", wisdom_cpu);
+  wisdom_send_in_use (1);
+
+  for (;;) {
+    if (poll (&pfd, 1, 1000) > 0) {
+      if (read (wisdom_report_fd, &what, 1) != 1 || what == WISDOM_DONE) { break; }
+
+      // new partial wisdom: refine the plans of the running filters
+      wisdom_import (".part");
+      fircore_refine (0);
+    }
+
+    wisdom_send_in_use (0);
+  }
+
+  waitpid (wisdom_pid, NULL, 0);
+  close (wisdom_report_fd);
+  close (wisdom_sizes_fd);
+
+  if (what == WISDOM_DONE) {
+    wisdom_import ("");
+    __atomic_store_n (&wisdom_planflags, FFTW_PATIENT, __ATOMIC_RELEASE);
+    sprintf (status, "FFTW wisdom for %s complete", wisdom_cpu);
+  } else {
+    // the plans keep what has been gained so far, the rest is done upon the next start
+    sprintf (status, "FFTW wisdom for %s incomplete", wisdom_cpu);
+  }
+
+  fircore_refine (1);
+  // a second pass destroys the plans that have been replaced in the meantime
+  Sleep (1000);
+  fircore_refine (1);
+  __atomic_store_n (&wisdom_refining, 0, __ATOMIC_RELEASE);
+}
+
+PORT
+int WDSPwisdom_tiered (char* directory) {
+  char name[1200];
+  int have;
+  int sizes_pipe[2], report_pipe[2];
+  snprintf (wisdom_dir, sizeof (wisdom_dir), "%s", directory);
+  wisdom_cpu_model ();
+  snprintf (name, sizeof (name), "%swdspWisdom00", wisdom_dir);
+  have = fftw_import_wisdom_from_filename (name);
+  wisdom_filename (name, sizeof (name), "wdspWisdom00", "");
+  have |= fftw_import_wisdom_from_filename (name);
+#ifdef WDSP_FLOAT
+  int havef;
+  snprintf (name, sizeof (name), "%swdspWisdomF00", wisdom_dir);
+  havef = fftwf_import_wisdom_from_filename (name);
+  wisdom_filename (name, sizeof (name), "wdspWisdomF00", "");
+  havef |= fftwf_import_wisdom_from_filename (name);
+  have = have && havef;
+#endif
+
+  if (have) {
+    sprintf (status, "FFTW wisdom imported (%s)", wisdom_cpu);
+    return 0;
+  }
+
+  wisdom_import (".part");
+
+  if (pipe (sizes_pipe) != 0) { return 0; }
+
+  if (pipe (report_pipe) != 0) {
+    close (sizes_pipe[0]);
+    close (sizes_pipe[1]);
+    return 0;
+  }
+
+  wisdom_pid = fork ();
+
+  if (wisdom_pid == 0) {
+    close (sizes_pipe[1]);
+    close (report_pipe[0]);
+    wisdom_sizes_fd = sizes_pipe[0];
+    wisdom_report_fd = report_pipe[1];
+    wisdom_child ();
+  }
+
+  close (sizes_pipe[0]);
+  close (report_pipe[1]);
+
+  if (wisdom_pid < 0) {
+    close (sizes_pipe[1]);
+    close (report_pipe[0]);
+    return 0;
+  }
+
+  wisdom_sizes_fd = sizes_pipe[1];
+  wisdom_report_fd = report_pipe[0];
+  // the refinement thread replans while the radio plans
+  fftw_make_planner_thread_safe ();
+#ifdef WDSP_FLOAT
+  fftwf_make_planner_thread_safe ();
+#endif
+  sprintf (status, "FFTW wisdom for %s will be built in the background", wisdom_cpu);
+  wisdom_planflags = FFTW_ESTIMATE;
+  wisdom_refining = 1;
+  fircore_refine_start ();
+  return 1;
+}
+// to be called once the channels are open, does nothing if there is wisdom
+PORT
+void WDSPwisdom_refine_start (void) {
+  static int started = 0;
+
+  if (__atomic_load_n (&wisdom_refining, __ATOMIC_ACQUIRE) && !started) {
+    started = 1;
+    _beginthread (wisdom_refine, 0, NULL);
+  }
+}
+
+PORT
+int WDSPwisdom_refining (void) {
+  return __atomic_load_n (&wisdom_refining, __ATOMIC_ACQUIRE);
+}